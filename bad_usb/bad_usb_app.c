@@ -103,6 +103,7 @@ BadUsbApp* bad_usb_app_alloc(char* arg) {
     BadUsbApp* app = malloc(sizeof(BadUsbApp));
 
     app->bad_usb_script = NULL;
+    app->hid_session = bad_usb_hid_session_alloc();
 
     app->file_path = furi_string_alloc();
     app->keyboard_layout = furi_string_alloc();
@@ -174,6 +175,7 @@ void bad_usb_app_free(BadUsbApp* app) {
         bad_usb_script_close(app->bad_usb_script);
         app->bad_usb_script = NULL;
     }
+    bad_usb_hid_session_free(app->hid_session);
 
     // Views
     view_dispatcher_remove_view(app->view_dispatcher, BadUsbAppViewWork);
@@ -42,6 +42,7 @@ struct BadUsbApp {
     FuriString* keyboard_layout;
     BadUsb* bad_usb_view;
     BadUsbScript* bad_usb_script;
+    BadUsbHidSession* hid_session;
 
     BadUsbHidInterface interface;
     FuriHalUsbInterface* usb_if_prev;
@@ -1,4 +1,5 @@
 #include "bad_usb_hid.h"
+#include <furi_hal.h>
 #include <extra_profiles/hid_profile.h>
 #include <bt/bt_service/bt.h>
 #include <storage/storage.h>
@@ -7,14 +8,43 @@
 
 #define HID_BT_KEYS_STORAGE_NAME ".bt_hid.keys"
 
+typedef struct {
+    FuriThread* probe_thread; // Blocks on the interrupt IN endpoint until the host polls it
+    bool probe_ready;
+} UsbHidInstance;
+
+static int32_t hid_usb_probe(void* context) {
+    UsbHidInstance* usb_inst = context;
+    // Interrupt IN holds one report, so the second one is queued only after the host polled
+    usb_inst->probe_ready = furi_hal_hid_kb_release_all() && furi_hal_hid_kb_release_all();
+    return 0;
+}
+
+// A probe report still waiting for the host would go out between script reports and clear
+// held keys, so every report first lets the probe finish
+static void hid_usb_probe_join(void* inst) {
+    UsbHidInstance* usb_inst = inst;
+    furi_assert(usb_inst);
+    if(furi_thread_get_state(usb_inst->probe_thread) != FuriThreadStateStopped) {
+        furi_thread_join(usb_inst->probe_thread);
+    }
+}
+
 void* hid_usb_init(FuriHalUsbHidConfig* hid_cfg) {
+    UsbHidInstance* usb_inst = malloc(sizeof(UsbHidInstance));
+    usb_inst->probe_thread = furi_thread_alloc_ex("BadUsbProbe", 512, hid_usb_probe, usb_inst);
     furi_check(furi_hal_usb_set_config(&usb_hid, hid_cfg));
-    return NULL;
+    return usb_inst;
 }
 
 void hid_usb_deinit(void* inst) {
-    UNUSED(inst);
+    UsbHidInstance* usb_inst = inst;
+    furi_assert(usb_inst);
+    // Leaving the config suspends the interface, which fails a report still waiting for a poll
     furi_check(furi_hal_usb_set_config(NULL, NULL));
+    furi_thread_join(usb_inst->probe_thread);
+    furi_thread_free(usb_inst->probe_thread);
+    free(usb_inst);
 }
 
 void hid_usb_set_state_callback(void* inst, HidStateCallback cb, void* context) {
@@ -27,54 +57,76 @@ bool hid_usb_is_connected(void* inst) {
     return furi_hal_hid_is_connected();
 }
 
+bool hid_usb_is_ready(void* inst) {
+    UsbHidInstance* usb_inst = inst;
+    furi_assert(usb_inst);
+    if(furi_thread_get_state(usb_inst->probe_thread) != FuriThreadStateStopped) {
+        return false; // Host hasn't polled yet
+    }
+    if(usb_inst->probe_ready) {
+        usb_inst->probe_ready = false; // Next connection is probed again
+        return true;
+    }
+    if(furi_hal_hid_is_connected()) {
+        furi_thread_join(usb_inst->probe_thread);
+        furi_thread_start(usb_inst->probe_thread);
+    }
+    return false;
+}
+
 bool hid_usb_kb_press(void* inst, uint16_t button) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_kb_press(button);
 }
 
 bool hid_usb_kb_release(void* inst, uint16_t button) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_kb_release(button);
 }
 
+bool hid_usb_kb_release_all(void* inst) {
+    hid_usb_probe_join(inst);
+    return furi_hal_hid_kb_release_all();
+}
+
 bool hid_usb_mouse_press(void* inst, uint8_t button) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_mouse_press(button);
 }
 
 bool hid_usb_mouse_release(void* inst, uint8_t button) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_mouse_release(button);
 }
 
 bool hid_usb_mouse_scroll(void* inst, int8_t delta) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_mouse_scroll(delta);
 }
 
 bool hid_usb_mouse_move(void* inst, int8_t dx, int8_t dy) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_mouse_move(dx, dy);
 }
 
 bool hid_usb_mouse_release_all(void* inst) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_mouse_release(0);
 }
 
 bool hid_usb_consumer_press(void* inst, uint16_t button) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_consumer_key_press(button);
 }
 
 bool hid_usb_consumer_release(void* inst, uint16_t button) {
-    UNUSED(inst);
+    hid_usb_probe_join(inst);
     return furi_hal_hid_consumer_key_release(button);
 }
 
 bool hid_usb_release_all(void* inst) {
     UNUSED(inst);
-    bool state = furi_hal_hid_kb_release_all();
+    bool state = hid_usb_kb_release_all(inst);
     state &= furi_hal_hid_consumer_key_release_all();
     state &= hid_usb_mouse_release_all(inst);
     return state;
@@ -90,9 +142,11 @@ static const BadUsbHidApi hid_api_usb = {
     .deinit = hid_usb_deinit,
     .set_state_callback = hid_usb_set_state_callback,
     .is_connected = hid_usb_is_connected,
+    .is_ready = hid_usb_is_ready,
 
     .kb_press = hid_usb_kb_press,
     .kb_release = hid_usb_kb_release,
+    .kb_release_all = hid_usb_kb_release_all,
     .mouse_press = hid_usb_mouse_press,
     .mouse_release = hid_usb_mouse_release,
     .mouse_scroll = hid_usb_mouse_scroll,
@@ -175,6 +229,11 @@ bool hid_ble_is_connected(void* inst) {
     return ble_hid->is_connected;
 }
 
+bool hid_ble_is_ready(void* inst) {
+    UNUSED(inst);
+    return false; // Profile doesn't report when the host subscribes to input reports
+}
+
 bool hid_ble_kb_press(void* inst, uint16_t button) {
     BleHidInstance* ble_hid = inst;
     furi_assert(ble_hid);
@@ -187,6 +246,12 @@ bool hid_ble_kb_release(void* inst, uint16_t button) {
     return ble_profile_hid_kb_release(ble_hid->profile, button);
 }
 
+bool hid_ble_kb_release_all(void* inst) {
+    BleHidInstance* ble_hid = inst;
+    furi_assert(ble_hid);
+    return ble_profile_hid_kb_release_all(ble_hid->profile);
+}
+
 bool hid_ble_mouse_press(void* inst, uint8_t button) {
     BleHidInstance* ble_hid = inst;
     furi_assert(ble_hid);
@@ -223,7 +288,7 @@ bool hid_ble_consumer_release(void* inst, uint16_t button) {
 bool hid_ble_release_all(void* inst) {
     BleHidInstance* ble_hid = inst;
     furi_assert(ble_hid);
-    bool state = ble_profile_hid_kb_release_all(ble_hid->profile);
+    bool state = hid_ble_kb_release_all(inst);
     state &= ble_profile_hid_consumer_key_release_all(ble_hid->profile);
     state &= ble_profile_hid_mouse_release_all(ble_hid->profile);
     return state;
@@ -240,9 +305,11 @@ static const BadUsbHidApi hid_api_ble = {
     .deinit = hid_ble_deinit,
     .set_state_callback = hid_ble_set_state_callback,
     .is_connected = hid_ble_is_connected,
+    .is_ready = hid_ble_is_ready,
 
     .kb_press = hid_ble_kb_press,
     .kb_release = hid_ble_kb_release,
+    .kb_release_all = hid_ble_kb_release_all,
     .mouse_press = hid_ble_mouse_press,
     .mouse_release = hid_ble_mouse_release,
     .mouse_scroll = hid_ble_mouse_scroll,
@@ -261,6 +328,66 @@ const BadUsbHidApi* bad_usb_hid_get_interface(BadUsbHidInterface interface) {
     }
 }
 
+struct BadUsbHidSession {
+    const BadUsbHidApi* api; // NULL while stopped
+    void* inst;
+    BadUsbHidInterface interface;
+    bool cfg_set;
+    FuriHalUsbHidConfig cfg; // Kept here, the USB stack may refer to it until deinit
+};
+
+BadUsbHidSession* bad_usb_hid_session_alloc(void) {
+    return malloc(sizeof(BadUsbHidSession));
+}
+
+void bad_usb_hid_session_free(BadUsbHidSession* session) {
+    furi_assert(session);
+    bad_usb_hid_session_stop(session);
+    free(session);
+}
+
+static bool bad_usb_hid_session_is_same(
+    BadUsbHidSession* session,
+    BadUsbHidInterface interface,
+    FuriHalUsbHidConfig* hid_cfg) {
+    if((session->api == NULL) || (session->interface != interface)) return false;
+    if(interface == BadUsbHidInterfaceBle) return true; // BLE doesn't use the USB ID
+    if(hid_cfg == NULL) return !session->cfg_set;
+    return session->cfg_set && (memcmp(&session->cfg, hid_cfg, sizeof(session->cfg)) == 0);
+}
+
+void* bad_usb_hid_session_start(
+    BadUsbHidSession* session,
+    BadUsbHidInterface interface,
+    FuriHalUsbHidConfig* hid_cfg) {
+    furi_assert(session);
+
+    if(bad_usb_hid_session_is_same(session, interface, hid_cfg)) {
+        // Host keeps the device as it is, no enumeration or BLE restart
+        FURI_LOG_D(TAG, "Session kept");
+        return session->inst;
+    }
+
+    bad_usb_hid_session_stop(session);
+    session->api = bad_usb_hid_get_interface(interface);
+    session->interface = interface;
+    session->cfg_set = (hid_cfg != NULL);
+    if(session->cfg_set) {
+        memcpy(&session->cfg, hid_cfg, sizeof(session->cfg));
+    }
+    session->inst = session->api->init(session->cfg_set ? &session->cfg : NULL);
+    return session->inst;
+}
+
+void bad_usb_hid_session_stop(BadUsbHidSession* session) {
+    furi_assert(session);
+    if(session->api == NULL) return;
+
+    session->api->deinit(session->inst);
+    session->api = NULL;
+    session->inst = NULL;
+}
+
 void bad_usb_hid_ble_remove_pairing(void) {
     Bt* bt = furi_record_open(RECORD_BT);
     bt_disconnect(bt);
@@ -5,7 +5,7 @@ extern "C" {
 #endif
 
 #include <furi.h>
-#include <furi_hal.h>
+#include <furi_hal_usb_hid.h>
 
 typedef enum {
     BadUsbHidInterfaceUsb,
@@ -17,9 +17,13 @@ typedef struct {
     void (*deinit)(void* inst);
     void (*set_state_callback)(void* inst, HidStateCallback cb, void* context);
     bool (*is_connected)(void* inst);
+    // Polls whether the host read input reports since connecting, false while it hasn't or if
+    // the link can't tell. The first call after a connection starts the probe, it never blocks
+    bool (*is_ready)(void* inst);
 
     bool (*kb_press)(void* inst, uint16_t button);
     bool (*kb_release)(void* inst, uint16_t button);
+    bool (*kb_release_all)(void* inst);
     bool (*mouse_press)(void* inst, uint8_t button);
     bool (*mouse_release)(void* inst, uint8_t button);
     bool (*mouse_scroll)(void* inst, int8_t delta);
@@ -30,8 +34,22 @@ typedef struct {
     uint8_t (*get_led_state)(void* inst);
 } BadUsbHidApi;
 
+typedef struct BadUsbHidSession BadUsbHidSession;
+
 const BadUsbHidApi* bad_usb_hid_get_interface(BadUsbHidInterface interface);
 
+BadUsbHidSession* bad_usb_hid_session_alloc(void);
+
+void bad_usb_hid_session_free(BadUsbHidSession* session);
+
+// Keeps the running HID instance when the interface and USB ID (NULL for default) match
+void* bad_usb_hid_session_start(
+    BadUsbHidSession* session,
+    BadUsbHidInterface interface,
+    FuriHalUsbHidConfig* hid_cfg);
+
+void bad_usb_hid_session_stop(BadUsbHidSession* session);
+
 void bad_usb_hid_ble_remove_pairing(void);
 
 #ifdef __cplusplus
@@ -1,10 +1,7 @@
 #include <furi.h>
-#include <furi_hal.h>
-#include <gui/gui.h>
-#include <input/input.h>
-#include <lib/toolbox/args.h>
 #include <lib/toolbox/strint.h>
 #include <storage/storage.h>
+#include <toolbox/path.h>
 #include "ducky_script.h"
 #include "ducky_script_i.h"
 #include <dolphin/dolphin.h>
@@ -13,8 +10,14 @@
 
 #define WORKER_TAG TAG "Worker"
 
-#define BADUSB_ASCII_TO_KEY(script, x) \
-    (((uint8_t)x < 128) ? (script->layout[(uint8_t)x]) : HID_KEYBOARD_NONE)
+#define DUCKY_COMPILE_STEP_LINES 32 // Lines compiled per worker loop pass while waiting
+
+#ifndef WORKER_CONNECT_WAIT
+// ms given to the host to set up the keyboard when the link can't tell it is ready
+#define WORKER_CONNECT_WAIT 1500
+#endif
+#define WORKER_READY_POLL 10 // ms between host readiness probes while waiting after connect
+#define WORKER_DELAY_SLICE 1000 // Longest wait before the remaining delay is refreshed, ms
 
 typedef enum {
     WorkerEvtStartStop = (1 << 0),
@@ -24,8 +27,6 @@ typedef enum {
     WorkerEvtDisconnect = (1 << 4),
 } WorkerEvtFlags;
 
-static const char ducky_cmd_id[] = {"ID"};
-
 static const uint8_t numpad_keys[10] = {
     HID_KEYPAD_0,
     HID_KEYPAD_1,
@@ -48,23 +49,31 @@ bool ducky_is_line_end(const char chr) {
     return (chr == ' ') || (chr == '\0') || (chr == '\r') || (chr == '\n');
 }
 
-uint16_t ducky_get_keycode(BadUsbScript* bad_usb, const char* param, bool accept_modifiers) {
+void ducky_parse_keycode(const char* param, bool accept_modifiers, DuckyOp* op) {
     uint16_t keycode = ducky_get_keycode_by_name(param);
     if(keycode != HID_KEYBOARD_NONE) {
-        return keycode;
+        op->key |= keycode;
+        return;
     }
 
     if(accept_modifiers) {
         uint16_t keycode = ducky_get_modifier_keycode_by_name(param);
         if(keycode != HID_KEYBOARD_NONE) {
-            return keycode;
+            op->key |= keycode;
+            return;
         }
     }
 
-    if(strlen(param) > 0) {
-        return BADUSB_ASCII_TO_KEY(bad_usb, param[0]) & 0xFF;
+    // Single characters depend on the keyboard layout, which can change after parsing
+    op->key_char = param[0];
+}
+
+uint16_t ducky_get_keycode(BadUsbScript* bad_usb, const DuckyOp* op) {
+    uint16_t keycode = op->key;
+    if(op->key_char != '\0') {
+        keycode |= BADUSB_ASCII_TO_KEY(bad_usb, op->key_char) & 0xFF;
     }
-    return 0;
+    return keycode;
 }
 
 bool ducky_get_number(const char* param, uint32_t* val) {
@@ -77,6 +86,8 @@ bool ducky_get_number(const char* param, uint32_t* val) {
 }
 
 void ducky_numlock_on(BadUsbScript* bad_usb) {
+    // Both backends return the state the host last set, so a query per command is cheap and
+    // sees NumLock toggled on the host mid-run. The HAL has no LED change callback.
     if((bad_usb->hid->get_led_state(bad_usb->hid_inst) & HID_KB_LED_NUM) == 0) {
         bad_usb->hid->kb_press(bad_usb->hid_inst, HID_KEYBOARD_LOCK_NUM_LOCK);
         bad_usb->hid->kb_release(bad_usb->hid_inst, HID_KEYBOARD_LOCK_NUM_LOCK);
@@ -109,22 +120,59 @@ bool ducky_altchar(BadUsbScript* bad_usb, const char* charcode) {
     return state;
 }
 
+typedef struct {
+    uint8_t key_nb;
+    uint8_t keys[3];
+} DuckyAltCode;
+
+#define DUCKY_NUMPAD_KEY(d) ((d) == 0 ? HID_KEYPAD_0 : (HID_KEYPAD_1 + (d) - 1))
+#define DUCKY_ALTCODE2(c) {2, {DUCKY_NUMPAD_KEY((c) / 10), DUCKY_NUMPAD_KEY((c) % 10)}}
+#define DUCKY_ALTCODE3(c) \
+    {3, {DUCKY_NUMPAD_KEY((c) / 100), DUCKY_NUMPAD_KEY((c) / 10 % 10), DUCKY_NUMPAD_KEY((c) % 10)}}
+
+// Numpad keys of the decimal code of every printable char, indexed from ' '
+static const DuckyAltCode ducky_altcodes['~' - ' ' + 1] = {
+    DUCKY_ALTCODE2(32), DUCKY_ALTCODE2(33), DUCKY_ALTCODE2(34), DUCKY_ALTCODE2(35),
+    DUCKY_ALTCODE2(36), DUCKY_ALTCODE2(37), DUCKY_ALTCODE2(38), DUCKY_ALTCODE2(39),
+    DUCKY_ALTCODE2(40), DUCKY_ALTCODE2(41), DUCKY_ALTCODE2(42), DUCKY_ALTCODE2(43),
+    DUCKY_ALTCODE2(44), DUCKY_ALTCODE2(45), DUCKY_ALTCODE2(46), DUCKY_ALTCODE2(47),
+    DUCKY_ALTCODE2(48), DUCKY_ALTCODE2(49), DUCKY_ALTCODE2(50), DUCKY_ALTCODE2(51),
+    DUCKY_ALTCODE2(52), DUCKY_ALTCODE2(53), DUCKY_ALTCODE2(54), DUCKY_ALTCODE2(55),
+    DUCKY_ALTCODE2(56), DUCKY_ALTCODE2(57), DUCKY_ALTCODE2(58), DUCKY_ALTCODE2(59),
+    DUCKY_ALTCODE2(60), DUCKY_ALTCODE2(61), DUCKY_ALTCODE2(62), DUCKY_ALTCODE2(63),
+    DUCKY_ALTCODE2(64), DUCKY_ALTCODE2(65), DUCKY_ALTCODE2(66), DUCKY_ALTCODE2(67),
+    DUCKY_ALTCODE2(68), DUCKY_ALTCODE2(69), DUCKY_ALTCODE2(70), DUCKY_ALTCODE2(71),
+    DUCKY_ALTCODE2(72), DUCKY_ALTCODE2(73), DUCKY_ALTCODE2(74), DUCKY_ALTCODE2(75),
+    DUCKY_ALTCODE2(76), DUCKY_ALTCODE2(77), DUCKY_ALTCODE2(78), DUCKY_ALTCODE2(79),
+    DUCKY_ALTCODE2(80), DUCKY_ALTCODE2(81), DUCKY_ALTCODE2(82), DUCKY_ALTCODE2(83),
+    DUCKY_ALTCODE2(84), DUCKY_ALTCODE2(85), DUCKY_ALTCODE2(86), DUCKY_ALTCODE2(87),
+    DUCKY_ALTCODE2(88), DUCKY_ALTCODE2(89), DUCKY_ALTCODE2(90), DUCKY_ALTCODE2(91),
+    DUCKY_ALTCODE2(92), DUCKY_ALTCODE2(93), DUCKY_ALTCODE2(94), DUCKY_ALTCODE2(95),
+    DUCKY_ALTCODE2(96), DUCKY_ALTCODE2(97), DUCKY_ALTCODE2(98), DUCKY_ALTCODE2(99),
+    DUCKY_ALTCODE3(100), DUCKY_ALTCODE3(101), DUCKY_ALTCODE3(102), DUCKY_ALTCODE3(103),
+    DUCKY_ALTCODE3(104), DUCKY_ALTCODE3(105), DUCKY_ALTCODE3(106), DUCKY_ALTCODE3(107),
+    DUCKY_ALTCODE3(108), DUCKY_ALTCODE3(109), DUCKY_ALTCODE3(110), DUCKY_ALTCODE3(111),
+    DUCKY_ALTCODE3(112), DUCKY_ALTCODE3(113), DUCKY_ALTCODE3(114), DUCKY_ALTCODE3(115),
+    DUCKY_ALTCODE3(116), DUCKY_ALTCODE3(117), DUCKY_ALTCODE3(118), DUCKY_ALTCODE3(119),
+    DUCKY_ALTCODE3(120), DUCKY_ALTCODE3(121), DUCKY_ALTCODE3(122), DUCKY_ALTCODE3(123),
+    DUCKY_ALTCODE3(124), DUCKY_ALTCODE3(125), DUCKY_ALTCODE3(126),
+};
+
 bool ducky_altstring(BadUsbScript* bad_usb, const char* param) {
-    uint32_t i = 0;
     bool state = false;
 
-    while(param[i] != '\0') {
-        if((param[i] < ' ') || (param[i] > '~')) {
-            i++;
-            continue; // Skip non-printable chars
-        }
-
-        char temp_str[4];
-        snprintf(temp_str, 4, "%u", param[i]);
+    for(; *param != '\0'; param++) {
+        uint8_t chr = *param;
+        if((chr < ' ') || (chr > '~')) continue; // Skip non-printable chars
 
-        state = ducky_altchar(bad_usb, temp_str);
-        if(state == false) break;
-        i++;
+        const DuckyAltCode* code = &ducky_altcodes[chr - ' '];
+        bad_usb->hid->kb_press(bad_usb->hid_inst, KEY_MOD_LEFT_ALT);
+        for(size_t i = 0; i < code->key_nb; i++) {
+            bad_usb->hid->kb_press(bad_usb->hid_inst, code->keys[i]);
+            bad_usb->hid->kb_release(bad_usb->hid_inst, code->keys[i]);
+        }
+        bad_usb->hid->kb_release(bad_usb->hid_inst, KEY_MOD_LEFT_ALT);
+        state = true;
     }
     return state;
 }
@@ -139,32 +187,140 @@ int32_t ducky_error(BadUsbScript* bad_usb, const char* text, ...) {
     return SCRIPT_STATE_ERROR;
 }
 
-bool ducky_string(BadUsbScript* bad_usb, const char* param) {
-    uint32_t i = 0;
+static uint16_t ducky_string_get_keycode(BadUsbScript* bad_usb, char chr) {
+    if(chr == '\n') return HID_KEYBOARD_RETURN;
+    return BADUSB_ASCII_TO_KEY(bad_usb, chr);
+}
+
+// STRING payloads are typed in place, the STRINGLN newline follows the last character
+static char ducky_string_get_char(const char* param, size_t len, size_t pos) {
+    return (pos < len) ? param[pos] : '\n';
+}
+
+// Collect the characters that can be typed from a single keyboard report:
+// distinct keys sharing the same modifiers. Returns the number of characters consumed,
+// key_end[k] is the number consumed up to and including key k
+static size_t ducky_string_plan_report(
+    BadUsbScript* bad_usb,
+    const char* param,
+    size_t param_len,
+    size_t print_len,
+    uint16_t keys[HID_KB_MAX_KEYS],
+    size_t key_end[HID_KB_MAX_KEYS],
+    size_t* key_nb) {
+    size_t len = 0;
+    *key_nb = 0;
+
+    for(; (len < print_len) && (*key_nb < HID_KB_MAX_KEYS); len++) {
+        char chr = ducky_string_get_char(param, param_len, len);
+        uint16_t keycode = ducky_string_get_keycode(bad_usb, chr);
+        if(keycode == HID_KEYBOARD_NONE) continue;
+
+        if(*key_nb > 0) {
+            if((keycode & 0xFF00) != (keys[0] & 0xFF00)) break; // Modifiers change
+            bool key_repeat = false;
+            for(size_t i = 0; i < *key_nb; i++) {
+                if((keys[i] & 0xFF) == (keycode & 0xFF)) key_repeat = true;
+            }
+            if(key_repeat) break;
+        }
+        key_end[*key_nb] = len + 1;
+        keys[(*key_nb)++] = keycode;
+    }
 
-    while(param[i] != '\0') {
-        if(param[i] != '\n') {
-            uint16_t keycode = BADUSB_ASCII_TO_KEY(bad_usb, param[i]);
+    return len;
+}
+
+// Types from pos up to print_len, stopping once time_max ms have passed. Time is checked
+// before every report, a slow host can't stretch the step by a whole group. Returns the
+// position reached
+static size_t ducky_string_type(
+    BadUsbScript* bad_usb,
+    const char* param,
+    size_t len,
+    size_t pos,
+    size_t print_len,
+    uint32_t time_max) {
+    uint32_t time_start = furi_get_tick();
+    size_t i = pos;
+
+    while((i < print_len) && ((furi_get_tick() - time_start) < time_max)) {
+        if(bad_usb->key_hold_nb > 0) { // Held keys take report slots, type one key at a time
+            char chr = ducky_string_get_char(param, len, i);
+            uint16_t keycode = ducky_string_get_keycode(bad_usb, chr);
             if(keycode != HID_KEYBOARD_NONE) {
                 bad_usb->hid->kb_press(bad_usb->hid_inst, keycode);
                 bad_usb->hid->kb_release(bad_usb->hid_inst, keycode);
             }
-        } else {
-            bad_usb->hid->kb_press(bad_usb->hid_inst, HID_KEYBOARD_RETURN);
-            bad_usb->hid->kb_release(bad_usb->hid_inst, HID_KEYBOARD_RETURN);
+            i++;
+            continue;
         }
-        i++;
+
+        // Keys are added one by one so the host sees them in order, then released together
+        uint16_t keys[HID_KB_MAX_KEYS];
+        size_t key_end[HID_KB_MAX_KEYS];
+        size_t key_nb = 0;
+        size_t plan_len = ducky_string_plan_report(
+            bad_usb, &param[i], len - MIN(i, len), print_len - i, keys, key_end, &key_nb);
+        size_t press_nb = 0;
+        for(; press_nb < key_nb; press_nb++) {
+            // Out of time: the group ends early, the rest goes into the next report
+            if((press_nb > 0) && ((furi_get_tick() - time_start) >= time_max)) break;
+            bad_usb->hid->kb_press(bad_usb->hid_inst, keys[press_nb]);
+        }
+        if(press_nb > 0) {
+            bad_usb->hid->kb_release_all(bad_usb->hid_inst);
+        }
+        i += (press_nb < key_nb) ? key_end[press_nb - 1] : plan_len;
+    }
+    return i;
+}
+
+size_t ducky_string(BadUsbScript* bad_usb, const char* param, size_t len, bool newline) {
+    return ducky_string_type(
+        bad_usb, param, len, 0, len + (newline ? 1 : 0), DUCKY_STRING_STEP_TIME);
+}
+
+static uint32_t ducky_script_get_string_delay(BadUsbScript* bad_usb) {
+    return (bad_usb->stringdelay == 0) ? bad_usb->defstringdelay : bad_usb->stringdelay;
+}
+
+static bool ducky_string_file_read(BadUsbScript* bad_usb) {
+    if(!storage_file_is_open(bad_usb->string_file)) return false;
+
+    size_t read_len = storage_file_read(
+        bad_usb->string_file, bad_usb->string_file_buf, sizeof(bad_usb->string_file_buf));
+    if(read_len == 0) {
+        storage_file_close(bad_usb->string_file);
+        return false;
     }
-    bad_usb->stringdelay = 0;
+
+    bad_usb->string_print = bad_usb->string_file_buf;
+    bad_usb->string_print_len = read_len;
+    bad_usb->string_print_pos = 0;
     return true;
 }
 
 static bool ducky_string_next(BadUsbScript* bad_usb) {
-    if(bad_usb->string_print_pos >= furi_string_size(bad_usb->string_print)) {
-        return true;
+    size_t print_len = bad_usb->string_print_len + (bad_usb->string_print_newline ? 1 : 0);
+    if(bad_usb->string_print_pos >= print_len) {
+        if(!ducky_string_file_read(bad_usb)) return true;
+        print_len = bad_usb->string_print_len;
+    }
+
+    if(ducky_script_get_string_delay(bad_usb) == 0) { // Type for a bounded time in one step
+        bad_usb->string_print_pos = ducky_string_type(
+            bad_usb,
+            bad_usb->string_print,
+            bad_usb->string_print_len,
+            bad_usb->string_print_pos,
+            print_len,
+            DUCKY_STRING_STEP_TIME);
+        return false;
     }
 
-    char print_char = furi_string_get_char(bad_usb->string_print, bad_usb->string_print_pos);
+    char print_char = ducky_string_get_char(
+        bad_usb->string_print, bad_usb->string_print_len, bad_usb->string_print_pos);
 
     if(print_char != '\n') {
         uint16_t keycode = BADUSB_ASCII_TO_KEY(bad_usb, print_char);
@@ -182,17 +338,25 @@ static bool ducky_string_next(BadUsbScript* bad_usb) {
     return false;
 }
 
-static int32_t ducky_parse_line(BadUsbScript* bad_usb, FuriString* line) {
-    uint32_t line_len = furi_string_size(line);
-    const char* line_cstr = furi_string_get_cstr(line);
+int32_t ducky_parse_line(BadUsbScript* bad_usb, const char* line_cstr, DuckyOp* op) {
+    memset(op, 0, sizeof(DuckyOp));
 
-    if(line_len == 0) {
+    if(line_cstr[0] == '\0') {
         return SCRIPT_STATE_NEXT_LINE; // Skip empty lines
     }
     FURI_LOG_D(WORKER_TAG, "line:%s", line_cstr);
+    if(bad_usb->line_overflow) {
+        return ducky_error(bad_usb, "Line longer than %d chars", DUCKY_LINE_LEN_MAX);
+    }
 
     // Ducky Lang Functions
-    int32_t cmd_result = ducky_execute_cmd(bad_usb, line_cstr);
+    int32_t cmd_result = ducky_parse_cmd(bad_usb, line_cstr, op);
+    if(cmd_result != SCRIPT_STATE_CMD_UNKNOWN) {
+        return cmd_result;
+    }
+
+    // Variable assignments and function calls
+    cmd_result = ducky_vm_parse_line(bad_usb, line_cstr, op);
     if(cmd_result != SCRIPT_STATE_CMD_UNKNOWN) {
         return cmd_result;
     }
@@ -200,8 +364,8 @@ static int32_t ducky_parse_line(BadUsbScript* bad_usb, FuriString* line) {
     // Mouse Keys
     uint16_t key = ducky_get_mouse_keycode_by_name(line_cstr);
     if(key != HID_MOUSE_INVALID) {
-        bad_usb->hid->mouse_press(bad_usb->hid_inst, key);
-        bad_usb->hid->mouse_release(bad_usb->hid_inst, key);
+        op->type = DuckyOpMouseClick;
+        op->key = key;
         return 0;
     }
 
@@ -217,17 +381,13 @@ static int32_t ducky_parse_line(BadUsbScript* bad_usb, FuriString* line) {
     }
 
     // Main key
-    char next_char = *line_cstr;
-    key = modifiers | ducky_get_keycode(bad_usb, line_cstr, false);
-
-    if(key == 0 && next_char) ducky_error(bad_usb, "No keycode defined for %s", line_cstr);
-
-    bad_usb->hid->kb_press(bad_usb->hid_inst, key);
-    bad_usb->hid->kb_release(bad_usb->hid_inst, key);
+    op->type = DuckyOpKey;
+    op->key = modifiers;
+    ducky_parse_keycode(line_cstr, false, op);
     return 0;
 }
 
-static bool ducky_set_usb_id(BadUsbScript* bad_usb, const char* line) {
+bool ducky_set_usb_id(BadUsbScript* bad_usb, const char* line) {
     if(sscanf(line, "%lX:%lX", &bad_usb->hid_cfg.vid, &bad_usb->hid_cfg.pid) == 2) {
         bad_usb->hid_cfg.manuf[0] = '\0';
         bad_usb->hid_cfg.product[0] = '\0';
@@ -263,81 +423,155 @@ static void bad_usb_hid_state_callback(bool state, void* context) {
     }
 }
 
-static bool ducky_script_preload(BadUsbScript* bad_usb, File* script_file) {
-    uint8_t ret = 0;
-    uint32_t line_len = 0;
+// Relative STRINGFILE paths are resolved without allocating while the script runs
+static void ducky_script_set_string_file_dir(BadUsbScript* bad_usb) {
+    FuriString* dir = furi_string_alloc();
+    path_extract_dirname(furi_string_get_cstr(bad_usb->file_path), dir);
+    strlcpy(bad_usb->string_file_path, furi_string_get_cstr(dir), DUCKY_PATH_LEN_MAX);
+    bad_usb->string_file_dir_len = strlen(bad_usb->string_file_path);
+    furi_string_free(dir);
+}
 
-    furi_string_reset(bad_usb->line);
+static void ducky_script_reset_reader(BadUsbScript* bad_usb, File* script_file) {
+    storage_file_seek(script_file, 0, true);
+    bad_usb->buf_len = 0;
+    bad_usb->file_end = false;
+    bad_usb->line_len = 0;
+    bad_usb->line_cstr = "";
+}
 
-    do {
-        ret = storage_file_read(script_file, bad_usb->file_buf, FILE_BUFFER_LEN);
-        for(uint16_t i = 0; i < ret; i++) {
-            if(bad_usb->file_buf[i] == '\n' && line_len > 0) {
-                bad_usb->st.line_nb++;
-                line_len = 0;
-            } else {
-                if(bad_usb->st.line_nb == 0) { // Save first line
-                    furi_string_push_back(bad_usb->line, bad_usb->file_buf[i]);
-                }
-                line_len++;
-            }
-        }
-        if(storage_file_eof(script_file)) {
-            if(line_len > 0) {
-                bad_usb->st.line_nb++;
-                break;
-            }
-        }
-    } while(ret > 0);
+// Takes the next slice of the arena, 8 byte aligned
+static void* ducky_script_arena_take(uint8_t** arena_pos, size_t size) {
+    void* slice = *arena_pos;
+    *arena_pos += (size + 7) & ~(size_t)7;
+    return slice;
+}
 
-    const char* line_tmp = furi_string_get_cstr(bad_usb->line);
-    bool id_set = false; // Looking for ID command at first line
-    if(strncmp(line_tmp, ducky_cmd_id, strlen(ducky_cmd_id)) == 0) {
-        id_set = ducky_set_usb_id(bad_usb, &line_tmp[strlen(ducky_cmd_id) + 1]);
+// One block for every buffer the script needs, sized from the script itself. A script with a
+// valid bytecode cache gets room for its exact op stream, one being compiled for the largest
+// op stream kept in RAM and for the compiler state
+static void ducky_script_arena_alloc(BadUsbScript* bad_usb, uint64_t script_size, bool compile) {
+    free(bad_usb->arena);
+    bad_usb->code = NULL;
+
+    size_t file_buf_len = MIN(script_size, (uint64_t)FILE_BUFFER_LEN);
+    size_t line_len_max = MIN(script_size, (uint64_t)DUCKY_LINE_LEN_MAX);
+    size_t code_buf_size = compile ? ducky_bytecode_get_code_max(script_size) :
+                           bad_usb->code_jumps ? bad_usb->code_size :
+                                                 0;
+    code_buf_size = MIN(code_buf_size, ducky_bytecode_get_code_max(script_size));
+    size_t compiler_buf_size = compile ? ducky_bytecode_get_compiler_size(script_size) : 0;
+    // Cached scripts never run from text and know their longest payload
+    size_t line_prev_len = compile ? line_len_max : 0;
+    size_t str_buf_len = compile ? line_len_max : MIN(bad_usb->bytecode_str_max, line_len_max);
+
+    size_t sizes[] = {
+        file_buf_len + 1,
+        line_len_max + 1,
+        line_prev_len + 1,
+        str_buf_len + 1,
+        code_buf_size,
+        compiler_buf_size,
+    };
+    size_t arena_size = 0;
+    for(size_t i = 0; i < COUNT_OF(sizes); i++) {
+        arena_size += (sizes[i] + 7) & ~(size_t)7;
     }
+    bad_usb->arena = malloc(arena_size);
+    bad_usb->arena_size = arena_size;
+
+    uint8_t* arena_pos = bad_usb->arena;
+    bad_usb->file_buf = ducky_script_arena_take(&arena_pos, sizes[0]);
+    bad_usb->file_buf_len = file_buf_len;
+    bad_usb->line = ducky_script_arena_take(&arena_pos, sizes[1]);
+    bad_usb->line_prev = ducky_script_arena_take(&arena_pos, sizes[2]);
+    bad_usb->bytecode_str_buf = ducky_script_arena_take(&arena_pos, sizes[3]);
+    bad_usb->line_len_max = line_len_max;
+    bad_usb->code_buf = ducky_script_arena_take(&arena_pos, sizes[4]);
+    bad_usb->code_buf_size = code_buf_size;
+    bad_usb->compiler_buf = ducky_script_arena_take(&arena_pos, sizes[5]);
+    bad_usb->compiler_buf_size = compiler_buf_size;
+    FURI_LOG_D(WORKER_TAG, "Arena: %zu bytes", arena_size);
+}
 
-    if(id_set) {
-        bad_usb->hid_inst = bad_usb->hid->init(&bad_usb->hid_cfg);
-    } else {
-        bad_usb->hid_inst = bad_usb->hid->init(NULL);
+static bool ducky_script_preload(BadUsbScript* bad_usb, File* script_file) {
+    bool id_set = false;
+    uint64_t script_size = storage_file_size(script_file);
+    ducky_bytecode_get_path(bad_usb->file_path, bad_usb->bytecode_path);
+
+    bad_usb->use_bytecode = ducky_bytecode_open(bad_usb, &id_set);
+    ducky_script_arena_alloc(bad_usb, script_size, !bad_usb->use_bytecode);
+    if(bad_usb->use_bytecode && !ducky_bytecode_load_code(bad_usb)) {
+        // Cache can't be read after all, the script is compiled again
+        bad_usb->use_bytecode = false;
+        ducky_script_arena_alloc(bad_usb, script_size, true);
     }
+    if(!bad_usb->use_bytecode) {
+        // Script is opened right away and compiled in the background while waiting for start
+        ducky_bytecode_compile_begin(bad_usb, script_file, &id_set);
+    }
+
+    bad_usb->hid_inst = bad_usb_hid_session_start(
+        bad_usb->hid_session, bad_usb->interface, id_set ? &bad_usb->hid_cfg : NULL);
     bad_usb->hid->set_state_callback(bad_usb->hid_inst, bad_usb_hid_state_callback, bad_usb);
 
-    storage_file_seek(script_file, 0, true);
-    furi_string_reset(bad_usb->line);
+    return (bad_usb->bytecode_compiler != NULL) || (bad_usb->st.line_nb > 0);
+}
 
-    return true;
+// Returns false once compilation finds the script invalid
+static bool ducky_script_compile_next(BadUsbScript* bad_usb, File* script_file, size_t line_nb) {
+    if(bad_usb->bytecode_compiler == NULL) return true;
+    if(ducky_bytecode_compile_step(bad_usb, script_file, line_nb) == 0) return true;
+
+    bool id_set = false;
+    bool script_valid = (ducky_bytecode_compile_end(bad_usb, &id_set) == 0) &&
+                        (bad_usb->st.line_nb > 0);
+    if(script_valid) {
+        bad_usb->use_bytecode = ducky_bytecode_open(bad_usb, &id_set);
+    }
+    ducky_script_reset_reader(bad_usb, script_file);
+    return script_valid;
 }
 
-static int32_t ducky_script_execute_next(BadUsbScript* bad_usb, File* script_file) {
-    int32_t delay_val = 0;
+static const char* ducky_script_trim_line(char* line, size_t len) {
+    while((len > 0) && (line[len - 1] != '\0') && strchr(" \r\t", line[len - 1])) {
+        len--;
+    }
+    line[len] = '\0';
+    while((*line != '\0') && strchr(" \r\t", *line)) {
+        line++;
+    }
+    return line;
+}
 
-    if(bad_usb->repeat_cnt > 0) {
-        bad_usb->repeat_cnt--;
-        delay_val = ducky_parse_line(bad_usb, bad_usb->line_prev);
-        if(delay_val == SCRIPT_STATE_NEXT_LINE) { // Empty line
-            return 0;
-        } else if(delay_val == SCRIPT_STATE_STRING_START) { // Print string with delays
-            return delay_val;
-        } else if(delay_val == SCRIPT_STATE_WAIT_FOR_BTN) { // wait for button
-            return delay_val;
-        } else if(delay_val < 0) { // Script error
-            bad_usb->st.error_line = bad_usb->st.line_cur - 1;
-            FURI_LOG_E(WORKER_TAG, "Unknown command at line %zu", bad_usb->st.line_cur - 1U);
-            return SCRIPT_STATE_ERROR;
-        } else {
-            return delay_val + bad_usb->defdelay;
-        }
+// Parts past DUCKY_LINE_LEN_MAX are dropped, the line is then rejected by the parser
+static void ducky_script_line_cat(BadUsbScript* bad_usb, const char* part, size_t len) {
+    size_t copy_len = MIN(len, bad_usb->line_len_max - bad_usb->line_len);
+    memcpy(&bad_usb->line[bad_usb->line_len], part, copy_len);
+    bad_usb->line_len += copy_len;
+    if(copy_len < len) {
+        bad_usb->line_overflow = true;
     }
+}
 
-    furi_string_set(bad_usb->line_prev, bad_usb->line);
-    furi_string_reset(bad_usb->line);
+const char* ducky_script_read_line(BadUsbScript* bad_usb, File* script_file) {
+    bad_usb->line_len = 0;
+    bad_usb->line_overflow = false;
+    bool line_started = false;
+
+    if(bad_usb->buf_len == 0) {
+        bad_usb->line_offset = storage_file_tell(script_file);
+    } else {
+        bad_usb->line_offset = bad_usb->buf_offset + bad_usb->buf_start;
+    }
 
     while(1) {
         if(bad_usb->buf_len == 0) {
-            bad_usb->buf_len = storage_file_read(script_file, bad_usb->file_buf, FILE_BUFFER_LEN);
+            bad_usb->buf_offset = storage_file_tell(script_file);
+            bad_usb->buf_len =
+                storage_file_read(script_file, bad_usb->file_buf, bad_usb->file_buf_len);
             if(storage_file_eof(script_file)) {
-                if((bad_usb->buf_len < FILE_BUFFER_LEN) && (bad_usb->file_end == false)) {
+                if((bad_usb->buf_len < bad_usb->file_buf_len) && (bad_usb->file_end == false)) {
                     bad_usb->file_buf[bad_usb->buf_len] = '\n';
                     bad_usb->buf_len++;
                     bad_usb->file_end = true;
@@ -345,37 +579,152 @@ static int32_t ducky_script_execute_next(BadUsbScript* bad_usb, File* script_fil
             }
 
             bad_usb->buf_start = 0;
-            if(bad_usb->buf_len == 0) return SCRIPT_STATE_END;
+            if(bad_usb->buf_len == 0) return NULL;
         }
-        for(uint8_t i = bad_usb->buf_start; i < (bad_usb->buf_start + bad_usb->buf_len); i++) {
-            if(bad_usb->file_buf[i] == '\n' && furi_string_size(bad_usb->line) > 0) {
-                bad_usb->st.line_cur++;
-                bad_usb->buf_len = bad_usb->buf_len + bad_usb->buf_start - (i + 1);
-                bad_usb->buf_start = i + 1;
-                furi_string_trim(bad_usb->line);
-                delay_val = ducky_parse_line(bad_usb, bad_usb->line);
-                if(delay_val == SCRIPT_STATE_NEXT_LINE) { // Empty line
-                    return 0;
-                } else if(delay_val == SCRIPT_STATE_STRING_START) { // Print string with delays
-                    return delay_val;
-                } else if(delay_val == SCRIPT_STATE_WAIT_FOR_BTN) { // wait for button
-                    return delay_val;
-                } else if(delay_val < 0) {
-                    bad_usb->st.error_line = bad_usb->st.line_cur;
-                    FURI_LOG_E(WORKER_TAG, "Unknown command at line %zu", bad_usb->st.line_cur);
-                    return SCRIPT_STATE_ERROR;
-                } else {
-                    return delay_val + bad_usb->defdelay;
-                }
-            } else {
-                furi_string_push_back(bad_usb->line, bad_usb->file_buf[i]);
-            }
+
+        char* line_start = &bad_usb->file_buf[bad_usb->buf_start];
+        char* line_end = memchr(line_start, '\n', bad_usb->buf_len);
+        if(line_end == NULL) { // Line continues in the next block
+            ducky_script_line_cat(bad_usb, line_start, bad_usb->buf_len);
+            line_started = true;
+            bad_usb->buf_len = 0;
+            if(bad_usb->file_end) return NULL;
+            continue;
         }
-        bad_usb->buf_len = 0;
-        if(bad_usb->file_end) return SCRIPT_STATE_END;
+
+        size_t line_len = line_end - line_start;
+        bad_usb->buf_start += line_len + 1;
+        bad_usb->buf_len -= line_len + 1;
+        if((line_len == 0) && !line_started) { // Empty lines are merged into the next one
+            line_started = true;
+            continue;
+        }
+
+        bad_usb->st.line_cur++;
+        if(bad_usb->line_len == 0) { // Whole line is in the block, no copy
+            bad_usb->line_overflow = (line_len > DUCKY_LINE_LEN_MAX);
+            bad_usb->line_cstr = ducky_script_trim_line(line_start, line_len);
+        } else {
+            ducky_script_line_cat(bad_usb, line_start, line_len);
+            bad_usb->line_cstr = ducky_script_trim_line(bad_usb->line, bad_usb->line_len);
+        }
+        return bad_usb->line_cstr;
     }
 
-    return 0;
+    return NULL;
+}
+
+bool ducky_script_seek_line(BadUsbScript* bad_usb, File* script_file, size_t line) {
+    if(line == 0) return false;
+    size_t line_indexed = line;
+    uint32_t offset = 0;
+    if(!ducky_bytecode_get_line_offset(bad_usb, &line_indexed, &offset)) {
+        line_indexed = 1; // No index, the script is scanned from its start
+        offset = 0;
+    }
+    if(!storage_file_seek(script_file, offset, true)) return false;
+
+    bad_usb->buf_len = 0;
+    bad_usb->file_end = false;
+    bad_usb->st.line_cur = line_indexed - 1;
+    // Index is sparse, skip the lines between the indexed one and the requested one
+    while(bad_usb->st.line_cur < (line - 1)) {
+        if(ducky_script_read_line(bad_usb, script_file) == NULL) return false;
+    }
+    return true;
+}
+
+// Compiled scripts only know the line number of a failing op, its text is found through the
+// line index
+static void ducky_script_set_error_text(BadUsbScript* bad_usb, File* script_file) {
+    size_t line_cur = bad_usb->st.line_cur;
+    const char* line_cstr = NULL;
+    if(ducky_script_seek_line(bad_usb, script_file, bad_usb->st.error_line)) {
+        line_cstr = ducky_script_read_line(bad_usb, script_file);
+    }
+    strlcpy(
+        bad_usb->st.error_text, line_cstr ? line_cstr : "", sizeof(bad_usb->st.error_text));
+    bad_usb->st.line_cur = line_cur;
+}
+
+static void ducky_script_rewind(BadUsbScript* bad_usb, File* script_file) {
+    bad_usb->buf_len = 0;
+    bad_usb->file_end = false;
+    bad_usb->line_cstr = "";
+    storage_file_close(bad_usb->string_file);
+    memset(&bad_usb->op, 0, sizeof(DuckyOp));
+    memset(&bad_usb->op_prev, 0, sizeof(DuckyOp));
+    ducky_vm_reset(bad_usb);
+    bad_usb->st.byte_cur = 0;
+    if(bad_usb->use_bytecode) {
+        ducky_bytecode_rewind(bad_usb);
+        bad_usb->st.byte_nb = bad_usb->code_size;
+    } else {
+        storage_file_seek(script_file, 0, true);
+        bad_usb->st.byte_nb = storage_file_size(script_file);
+    }
+}
+
+static int32_t ducky_script_line_result(BadUsbScript* bad_usb, int32_t delay_val, size_t line_nb) {
+    if(delay_val == SCRIPT_STATE_NEXT_LINE) { // Empty line, comment or control flow
+        return 0;
+    } else if(delay_val == SCRIPT_STATE_STRING_START) { // Print string with delays
+        return delay_val;
+    } else if(delay_val == SCRIPT_STATE_WAIT_FOR_BTN) { // wait for button
+        return delay_val;
+    } else if(delay_val < 0) { // Script error
+        bad_usb->st.error_line = line_nb;
+        FURI_LOG_E(WORKER_TAG, "Unknown command at line %zu", line_nb);
+        return SCRIPT_STATE_ERROR;
+    } else {
+        return delay_val + bad_usb->defdelay;
+    }
+}
+
+// Keep the decoded op for REPEAT, so repetitions skip parsing
+static void ducky_script_keep_op(BadUsbScript* bad_usb) {
+    // REPEAT replays the last command, not a jump, a skipped line or another REPEAT
+    if(ducky_vm_is_jump(&bad_usb->op) || (bad_usb->op.type == DuckyOpRepeat) ||
+       (bad_usb->op.type == DuckyOpNone))
+        return;
+
+    bad_usb->op_prev = bad_usb->op;
+    if((!bad_usb->use_bytecode) && (bad_usb->op.str != NULL)) {
+        // Payload points into the line buffer, which is reused by the next line
+        size_t str_len = MIN(bad_usb->op.str_len, bad_usb->line_len_max);
+        memcpy(bad_usb->line_prev, bad_usb->op.str, str_len);
+        bad_usb->line_prev[str_len] = '\0';
+        bad_usb->op_prev.str = bad_usb->line_prev;
+        bad_usb->op_prev.str_len = str_len;
+    }
+}
+
+static int32_t ducky_script_execute_next(BadUsbScript* bad_usb, File* script_file) {
+    int32_t delay_val = 0;
+
+    if(bad_usb->repeat_cnt > 0) {
+        bad_usb->repeat_cnt--;
+        ducky_profile_step_parsed(bad_usb->profile);
+        delay_val = ducky_execute_op(bad_usb, &bad_usb->op_prev);
+        return ducky_script_line_result(bad_usb, delay_val, bad_usb->st.line_cur - 1);
+    }
+
+    ducky_script_keep_op(bad_usb);
+    if(bad_usb->use_bytecode) {
+        bad_usb->st.byte_cur = bad_usb->code_pc;
+        delay_val = ducky_bytecode_read_op(bad_usb, &bad_usb->op);
+        if(delay_val == SCRIPT_STATE_END) return SCRIPT_STATE_END;
+    } else {
+        const char* line_cstr = ducky_script_read_line(bad_usb, script_file);
+        if(line_cstr == NULL) return SCRIPT_STATE_END;
+        bad_usb->st.byte_cur = bad_usb->line_offset;
+        delay_val = ducky_parse_line(bad_usb, line_cstr, &bad_usb->op);
+    }
+    ducky_profile_step_parsed(bad_usb->profile);
+    if(delay_val == 0) {
+        delay_val = ducky_execute_op(bad_usb, &bad_usb->op);
+    }
+    return ducky_script_line_result(bad_usb, delay_val, bad_usb->st.line_cur);
 }
 
 static uint32_t bad_usb_flags_get(uint32_t flags_mask, uint32_t timeout) {
@@ -383,7 +732,9 @@ static uint32_t bad_usb_flags_get(uint32_t flags_mask, uint32_t timeout) {
     furi_check((flags & FuriFlagError) == 0);
     if(flags == 0) {
         flags = furi_thread_flags_wait(flags_mask, FuriFlagWaitAny, timeout);
-        furi_check(((flags & FuriFlagError) == 0) || (flags == (unsigned)FuriFlagErrorTimeout));
+        furi_check(
+            ((flags & FuriFlagError) == 0) || (flags == (unsigned)FuriFlagErrorTimeout) ||
+            (flags == (unsigned)FuriFlagErrorResource));
     } else {
         uint32_t state = furi_thread_flags_clear(flags);
         furi_check((state & FuriFlagError) == 0);
@@ -391,27 +742,81 @@ static uint32_t bad_usb_flags_get(uint32_t flags_mask, uint32_t timeout) {
     return flags;
 }
 
+static uint32_t ducky_script_delay_left(uint32_t deadline) {
+    int32_t delay_left = (int32_t)(deadline - furi_get_tick());
+    return (delay_left > 0) ? (uint32_t)delay_left : 0;
+}
+
+// A delay starts once the step before it is done, so a DELAY after a long STRING still runs in
+// full. This deviates from a fixed schedule on purpose: the run lasts the sum of delays plus the
+// time spent sending output. Waking up late from the previous wait is taken off this delay, so
+// wake up latency doesn't add up over the run.
+static uint32_t ducky_script_delay_add(uint32_t* delay_late, uint32_t delay) {
+    uint32_t deadline = furi_get_tick() + delay - *delay_late;
+    *delay_late = 0;
+    return deadline;
+}
+
+// Returns how late the wait ended, made up for by the next delay
+static uint32_t ducky_script_delay_stats(BadUsbScript* bad_usb, uint32_t deadline) {
+    int32_t delay_late = (int32_t)(furi_get_tick() - deadline);
+    if(delay_late <= 0) return 0;
+
+    bad_usb->st.delay_overrun_nb++;
+    bad_usb->st.delay_jitter_max = MAX(bad_usb->st.delay_jitter_max, (uint32_t)delay_late);
+    return (uint32_t)delay_late;
+}
+
+static void ducky_script_delay_reset(BadUsbScript* bad_usb) {
+    bad_usb->st.delay_jitter_max = 0;
+    bad_usb->st.delay_overrun_nb = 0;
+}
+
+// Every state change goes through here, so a run can be followed as a timeline in the log
+static void bad_usb_worker_set_state(BadUsbScript* bad_usb, BadUsbWorkerState state) {
+    if(bad_usb->st.state == state) return;
+    // High water mark, the deepest calls of a run are behind it by the time its state changes
+    bad_usb->st.stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+    FURI_LOG_D(WORKER_TAG, "State %d -> %d at %lu", bad_usb->st.state, state, furi_get_tick());
+    bad_usb->st.state = state;
+}
+
 static int32_t bad_usb_worker(void* context) {
     BadUsbScript* bad_usb = context;
 
     BadUsbWorkerState worker_state = BadUsbStateInit;
     BadUsbWorkerState pause_state = BadUsbStateRunning;
     int32_t delay_val = 0;
+    // Delays end at absolute deadlines, waiting in slices or pausing doesn't shift them
+    uint32_t delay_deadline = 0;
+    uint32_t delay_pause_left = 0;
+    uint32_t delay_late = 0; // How late the last wait ended, not yet made up for
+    bool delay_scheduled = false;
 
     FURI_LOG_I(WORKER_TAG, "Init");
     File* script_file = storage_file_alloc(furi_record_open(RECORD_STORAGE));
-    bad_usb->line = furi_string_alloc();
-    bad_usb->line_prev = furi_string_alloc();
-    bad_usb->string_print = furi_string_alloc();
+    bad_usb->bytecode_file = storage_file_alloc(furi_record_open(RECORD_STORAGE));
+    bad_usb->string_file = storage_file_alloc(furi_record_open(RECORD_STORAGE));
+    ducky_script_set_string_file_dir(bad_usb);
 
     while(1) {
+        if((bad_usb->bytecode_compiler != NULL) && (furi_thread_flags_get() == 0)) {
+            // Nothing to handle yet, carry on with the background compilation
+            if(!ducky_script_compile_next(bad_usb, script_file, DUCKY_COMPILE_STEP_LINES)) {
+                ducky_script_set_error_text(bad_usb, script_file);
+                worker_state = BadUsbStateScriptError;
+                bad_usb_worker_set_state(bad_usb, worker_state);
+            }
+            continue;
+        }
+
         if(worker_state == BadUsbStateInit) { // State: initialization
             if(storage_file_open(
                    script_file,
                    furi_string_get_cstr(bad_usb->file_path),
                    FSAM_READ,
                    FSOM_OPEN_EXISTING)) {
-                if((ducky_script_preload(bad_usb, script_file)) && (bad_usb->st.line_nb > 0)) {
+                if(ducky_script_preload(bad_usb, script_file)) {
                     if(bad_usb->hid->is_connected(bad_usb->hid_inst)) {
                         worker_state = BadUsbStateIdle; // Ready to run
                     } else {
@@ -424,7 +829,7 @@ static int32_t bad_usb_worker(void* context) {
                 FURI_LOG_E(WORKER_TAG, "File open error");
                 worker_state = BadUsbStateFileError; // File open error
             }
-            bad_usb->st.state = worker_state;
+            bad_usb_worker_set_state(bad_usb, worker_state);
 
         } else if(worker_state == BadUsbStateNotConnected) { // State: USB not connected
             uint32_t flags = bad_usb_flags_get(
@@ -438,7 +843,7 @@ static int32_t bad_usb_worker(void* context) {
             } else if(flags & WorkerEvtStartStop) {
                 worker_state = BadUsbStateWillRun; // Will run when USB is connected
             }
-            bad_usb->st.state = worker_state;
+            bad_usb_worker_set_state(bad_usb, worker_state);
 
         } else if(worker_state == BadUsbStateIdle) { // State: ready to start
             uint32_t flags = bad_usb_flags_get(
@@ -447,22 +852,34 @@ static int32_t bad_usb_worker(void* context) {
             if(flags & WorkerEvtEnd) {
                 break;
             } else if(flags & WorkerEvtStartStop) { // Start executing script
+                // Whole script is validated before the first key is sent
+                if(!ducky_script_compile_next(bad_usb, script_file, SIZE_MAX)) {
+                    ducky_script_set_error_text(bad_usb, script_file);
+                    worker_state = BadUsbStateScriptError;
+                    bad_usb_worker_set_state(bad_usb, worker_state);
+                    continue;
+                }
                 dolphin_deed(DolphinDeedBadUsbPlayScript);
                 delay_val = 0;
-                bad_usb->buf_len = 0;
                 bad_usb->st.line_cur = 0;
                 bad_usb->defdelay = 0;
                 bad_usb->stringdelay = 0;
                 bad_usb->defstringdelay = 0;
                 bad_usb->repeat_cnt = 0;
                 bad_usb->key_hold_nb = 0;
-                bad_usb->file_end = false;
-                storage_file_seek(script_file, 0, true);
+                ducky_script_rewind(bad_usb, script_file);
+                ducky_script_delay_reset(bad_usb);
+                if(bad_usb->profile_enabled) {
+                    ducky_profile_start(bad_usb);
+                }
+                delay_deadline = furi_get_tick();
+                delay_late = 0;
+                delay_scheduled = false;
                 worker_state = BadUsbStateRunning;
             } else if(flags & WorkerEvtDisconnect) {
                 worker_state = BadUsbStateNotConnected; // USB disconnected
             }
-            bad_usb->st.state = worker_state;
+            bad_usb_worker_set_state(bad_usb, worker_state);
 
         } else if(worker_state == BadUsbStateWillRun) { // State: start on connection
             uint32_t flags = bad_usb_flags_get(
@@ -471,23 +888,47 @@ static int32_t bad_usb_worker(void* context) {
             if(flags & WorkerEvtEnd) {
                 break;
             } else if(flags & WorkerEvtConnect) { // Start executing script
+                if(!ducky_script_compile_next(bad_usb, script_file, SIZE_MAX)) {
+                    ducky_script_set_error_text(bad_usb, script_file);
+                    worker_state = BadUsbStateScriptError;
+                    bad_usb_worker_set_state(bad_usb, worker_state);
+                    continue;
+                }
                 dolphin_deed(DolphinDeedBadUsbPlayScript);
                 delay_val = 0;
-                bad_usb->buf_len = 0;
                 bad_usb->st.line_cur = 0;
                 bad_usb->defdelay = 0;
                 bad_usb->stringdelay = 0;
                 bad_usb->defstringdelay = 0;
                 bad_usb->repeat_cnt = 0;
-                bad_usb->file_end = false;
-                storage_file_seek(script_file, 0, true);
-                // extra time for PC to recognize Flipper as keyboard
-                flags = furi_thread_flags_wait(
-                    WorkerEvtEnd | WorkerEvtDisconnect | WorkerEvtStartStop,
-                    FuriFlagWaitAny | FuriFlagNoClear,
-                    1500);
-                if(flags == (unsigned)FuriFlagErrorTimeout) {
+                ducky_script_rewind(bad_usb, script_file);
+                // Start once the host polls the keyboard, or after extra time to recognize it.
+                // The probe is polled so stop, exit and disconnect are served while waiting
+                uint32_t connect_tick = furi_get_tick();
+                uint32_t poll_wait = 0;
+                while(true) {
+                    flags = furi_thread_flags_wait(
+                        WorkerEvtEnd | WorkerEvtDisconnect | WorkerEvtStartStop,
+                        FuriFlagWaitAny | FuriFlagNoClear,
+                        poll_wait);
+                    if(!(flags & FuriFlagError)) break;
+                    uint32_t connect_time = furi_get_tick() - connect_tick;
+                    if(bad_usb->hid->is_ready(bad_usb->hid_inst)) {
+                        FURI_LOG_D(WORKER_TAG, "host ready in %lu ms", connect_time);
+                        break;
+                    }
+                    if(connect_time >= WORKER_CONNECT_WAIT) break;
+                    poll_wait = MIN(WORKER_CONNECT_WAIT - connect_time, WORKER_READY_POLL);
+                }
+                if(flags & FuriFlagError) {
                     // If nothing happened - start script execution
+                    ducky_script_delay_reset(bad_usb);
+                    if(bad_usb->profile_enabled) {
+                        ducky_profile_start(bad_usb);
+                    }
+                    delay_deadline = furi_get_tick();
+                    delay_late = 0;
+                    delay_scheduled = false;
                     worker_state = BadUsbStateRunning;
                 } else if(flags & WorkerEvtStartStop) {
                     worker_state = BadUsbStateIdle;
@@ -496,16 +937,16 @@ static int32_t bad_usb_worker(void* context) {
             } else if(flags & WorkerEvtStartStop) { // Cancel scheduled execution
                 worker_state = BadUsbStateNotConnected;
             }
-            bad_usb->st.state = worker_state;
+            bad_usb_worker_set_state(bad_usb, worker_state);
 
         } else if(worker_state == BadUsbStateRunning) { // State: running
-            uint16_t delay_cur = (delay_val > 1000) ? (1000) : (delay_val);
+            uint32_t delay_left = ducky_script_delay_left(delay_deadline);
+            uint32_t delay_cur = MIN(delay_left, WORKER_DELAY_SLICE);
             uint32_t flags = furi_thread_flags_wait(
                 WorkerEvtEnd | WorkerEvtStartStop | WorkerEvtPauseResume | WorkerEvtDisconnect,
                 FuriFlagWaitAny,
                 delay_cur);
 
-            delay_val -= delay_cur;
             if(!(flags & FuriFlagError)) {
                 if(flags & WorkerEvtEnd) {
                     break;
@@ -516,41 +957,57 @@ static int32_t bad_usb_worker(void* context) {
                     worker_state = BadUsbStateNotConnected; // USB disconnected
                     bad_usb->hid->release_all(bad_usb->hid_inst);
                 } else if(flags & WorkerEvtPauseResume) {
+                    delay_pause_left = ducky_script_delay_left(delay_deadline);
                     pause_state = BadUsbStateRunning;
                     worker_state = BadUsbStatePaused; // Pause
                 }
-                bad_usb->st.state = worker_state;
+                bad_usb_worker_set_state(bad_usb, worker_state);
                 continue;
             } else if(
                 (flags == (unsigned)FuriFlagErrorTimeout) ||
                 (flags == (unsigned)FuriFlagErrorResource)) {
-                if(delay_val > 0) {
-                    bad_usb->st.delay_remain--;
+                delay_left = ducky_script_delay_left(delay_deadline);
+                if(delay_left > 0) {
+                    bad_usb->st.delay_remain = delay_left / 1000;
                     continue;
                 }
-                bad_usb->st.state = BadUsbStateRunning;
+                if(delay_scheduled) {
+                    delay_late = ducky_script_delay_stats(bad_usb, delay_deadline);
+                }
+                delay_scheduled = false;
+                bad_usb_worker_set_state(bad_usb, BadUsbStateRunning);
+                ducky_profile_step_start(bad_usb->profile);
                 delay_val = ducky_script_execute_next(bad_usb, script_file);
+                ducky_profile_step_end(bad_usb->profile, bad_usb->st.line_cur, delay_val);
                 if(delay_val == SCRIPT_STATE_ERROR) { // Script error
                     delay_val = 0;
+                    ducky_script_set_error_text(bad_usb, script_file);
                     worker_state = BadUsbStateScriptError;
-                    bad_usb->st.state = worker_state;
+                    bad_usb_worker_set_state(bad_usb, worker_state);
                     bad_usb->hid->release_all(bad_usb->hid_inst);
+                    ducky_profile_save(bad_usb);
                 } else if(delay_val == SCRIPT_STATE_END) { // End of script
                     delay_val = 0;
                     worker_state = BadUsbStateIdle;
-                    bad_usb->st.state = BadUsbStateDone;
+                    bad_usb_worker_set_state(bad_usb, BadUsbStateDone);
                     bad_usb->hid->release_all(bad_usb->hid_inst);
+                    ducky_profile_save(bad_usb);
                     continue;
                 } else if(delay_val == SCRIPT_STATE_STRING_START) { // Start printing string with delays
                     delay_val = bad_usb->defdelay;
-                    bad_usb->string_print_pos = 0;
+                    delay_deadline = ducky_script_delay_add(
+                        &delay_late, ducky_script_get_string_delay(bad_usb));
                     worker_state = BadUsbStateStringDelay;
                 } else if(delay_val == SCRIPT_STATE_WAIT_FOR_BTN) { // set state to wait for user input
                     worker_state = BadUsbStateWaitForBtn;
-                    bad_usb->st.state = BadUsbStateWaitForBtn; // Show long delays
-                } else if(delay_val > 1000) {
-                    bad_usb->st.state = BadUsbStateDelay; // Show long delays
-                    bad_usb->st.delay_remain = delay_val / 1000;
+                    bad_usb_worker_set_state(bad_usb, BadUsbStateWaitForBtn); // Show long delays
+                } else if(delay_val > 0) {
+                    delay_deadline = ducky_script_delay_add(&delay_late, delay_val);
+                    delay_scheduled = true;
+                    if(delay_val > 1000) {
+                        bad_usb_worker_set_state(bad_usb, BadUsbStateDelay); // Show long delays
+                        bad_usb->st.delay_remain = delay_val / 1000;
+                    }
                 }
             } else {
                 furi_check((flags & FuriFlagError) == 0);
@@ -563,13 +1020,15 @@ static int32_t bad_usb_worker(void* context) {
                 if(flags & WorkerEvtEnd) {
                     break;
                 } else if(flags & WorkerEvtStartStop) {
-                    delay_val = 0;
+                    delay_deadline = furi_get_tick();
+                    delay_late = 0;
+                    delay_scheduled = false;
                     worker_state = BadUsbStateRunning;
                 } else if(flags & WorkerEvtDisconnect) {
                     worker_state = BadUsbStateNotConnected; // USB disconnected
                     bad_usb->hid->release_all(bad_usb->hid_inst);
                 }
-                bad_usb->st.state = worker_state;
+                bad_usb_worker_set_state(bad_usb, worker_state);
                 continue;
             }
         } else if(worker_state == BadUsbStatePaused) { // State: Paused
@@ -581,35 +1040,36 @@ static int32_t bad_usb_worker(void* context) {
                     break;
                 } else if(flags & WorkerEvtStartStop) {
                     worker_state = BadUsbStateIdle; // Stop executing script
-                    bad_usb->st.state = worker_state;
+                    bad_usb_worker_set_state(bad_usb, worker_state);
                     bad_usb->hid->release_all(bad_usb->hid_inst);
                 } else if(flags & WorkerEvtDisconnect) {
                     worker_state = BadUsbStateNotConnected; // USB disconnected
-                    bad_usb->st.state = worker_state;
+                    bad_usb_worker_set_state(bad_usb, worker_state);
                     bad_usb->hid->release_all(bad_usb->hid_inst);
                 } else if(flags & WorkerEvtPauseResume) {
+                    // Time spent paused is not part of the schedule
+                    delay_deadline = furi_get_tick() + delay_pause_left;
+                    delay_late = 0;
                     if(pause_state == BadUsbStateRunning) {
-                        if(delay_val > 0) {
-                            bad_usb->st.state = BadUsbStateDelay;
-                            bad_usb->st.delay_remain = delay_val / 1000;
+                        if(delay_pause_left > 0) {
+                            bad_usb_worker_set_state(bad_usb, BadUsbStateDelay);
+                            bad_usb->st.delay_remain = delay_pause_left / 1000;
                         } else {
-                            bad_usb->st.state = BadUsbStateRunning;
-                            delay_val = 0;
+                            bad_usb_worker_set_state(bad_usb, BadUsbStateRunning);
                         }
                         worker_state = BadUsbStateRunning; // Resume
                     } else if(pause_state == BadUsbStateStringDelay) {
-                        bad_usb->st.state = BadUsbStateRunning;
+                        bad_usb_worker_set_state(bad_usb, BadUsbStateRunning);
                         worker_state = BadUsbStateStringDelay; // Resume
                     }
                 }
                 continue;
             }
         } else if(worker_state == BadUsbStateStringDelay) { // State: print string with delays
-            uint32_t delay = (bad_usb->stringdelay == 0) ? bad_usb->defstringdelay :
-                                                           bad_usb->stringdelay;
+            uint32_t delay_left = ducky_script_delay_left(delay_deadline);
             uint32_t flags = bad_usb_flags_get(
                 WorkerEvtEnd | WorkerEvtStartStop | WorkerEvtPauseResume | WorkerEvtDisconnect,
-                delay);
+                delay_left);
 
             if(!(flags & FuriFlagError)) {
                 if(flags & WorkerEvtEnd) {
@@ -621,18 +1081,28 @@ static int32_t bad_usb_worker(void* context) {
                     worker_state = BadUsbStateNotConnected; // USB disconnected
                     bad_usb->hid->release_all(bad_usb->hid_inst);
                 } else if(flags & WorkerEvtPauseResume) {
+                    delay_pause_left = ducky_script_delay_left(delay_deadline);
                     pause_state = BadUsbStateStringDelay;
                     worker_state = BadUsbStatePaused; // Pause
                 }
-                bad_usb->st.state = worker_state;
+                bad_usb_worker_set_state(bad_usb, worker_state);
                 continue;
             } else if(
                 (flags == (unsigned)FuriFlagErrorTimeout) ||
                 (flags == (unsigned)FuriFlagErrorResource)) {
+                if(ducky_script_get_string_delay(bad_usb) > 0) {
+                    delay_late = ducky_script_delay_stats(bad_usb, delay_deadline);
+                }
                 bool string_end = ducky_string_next(bad_usb);
                 if(string_end) {
                     bad_usb->stringdelay = 0;
+                    // Default delay after the string
+                    delay_deadline = ducky_script_delay_add(&delay_late, delay_val);
+                    delay_scheduled = (delay_val > 0);
                     worker_state = BadUsbStateRunning;
+                } else {
+                    delay_deadline = ducky_script_delay_add(
+                        &delay_late, ducky_script_get_string_delay(bad_usb));
                 }
             } else {
                 furi_check((flags & FuriFlagError) == 0);
@@ -649,16 +1119,25 @@ static int32_t bad_usb_worker(void* context) {
         }
     }
 
+    if(bad_usb->bytecode_compiler != NULL) { // Closed before compilation finished
+        bool id_set = false;
+        ducky_bytecode_compile_end(bad_usb, &id_set);
+    }
+    ducky_profile_stop(bad_usb);
+    // HID stays up for the next script, only leave it with no key held
+    bad_usb->hid->release_all(bad_usb->hid_inst);
     bad_usb->hid->set_state_callback(bad_usb->hid_inst, NULL, NULL);
-    bad_usb->hid->deinit(bad_usb->hid_inst);
 
     storage_file_close(script_file);
     storage_file_free(script_file);
-    furi_string_free(bad_usb->line);
-    furi_string_free(bad_usb->line_prev);
-    furi_string_free(bad_usb->string_print);
+    storage_file_close(bad_usb->bytecode_file);
+    storage_file_free(bad_usb->bytecode_file);
+    storage_file_close(bad_usb->string_file);
+    storage_file_free(bad_usb->string_file);
+    free(bad_usb->arena);
+    bad_usb->arena = NULL;
 
-    FURI_LOG_I(WORKER_TAG, "End");
+    FURI_LOG_I(WORKER_TAG, "End, stack space left: %zu", bad_usb->st.stack_free);
 
     return 0;
 }
@@ -669,19 +1148,30 @@ static void bad_usb_script_set_default_keyboard_layout(BadUsbScript* bad_usb) {
     memcpy(bad_usb->layout, hid_asciimap, MIN(sizeof(hid_asciimap), sizeof(bad_usb->layout)));
 }
 
-BadUsbScript* bad_usb_script_open(FuriString* file_path, BadUsbHidInterface interface) {
+BadUsbScript* bad_usb_script_open(
+    FuriString* file_path,
+    BadUsbHidInterface interface,
+    BadUsbHidSession* hid_session) {
     furi_assert(file_path);
+    furi_assert(hid_session);
 
     BadUsbScript* bad_usb = malloc(sizeof(BadUsbScript));
     bad_usb->file_path = furi_string_alloc();
     furi_string_set(bad_usb->file_path, file_path);
+    bad_usb->bytecode_path = furi_string_alloc();
     bad_usb_script_set_default_keyboard_layout(bad_usb);
 
     bad_usb->st.state = BadUsbStateInit;
     bad_usb->st.error[0] = '\0';
+    bad_usb->st.error_text[0] = '\0';
     bad_usb->hid = bad_usb_hid_get_interface(interface);
+    bad_usb->interface = interface;
+    bad_usb->hid_session = hid_session;
+    bad_usb->arena = NULL;
+    bad_usb->bytecode_str_max = 0;
 
-    bad_usb->thread = furi_thread_alloc_ex("BadUsbWorker", 2048, bad_usb_worker, bad_usb);
+    bad_usb->thread =
+        furi_thread_alloc_ex("BadUsbWorker", WORKER_STACK_SIZE, bad_usb_worker, bad_usb);
     furi_thread_start(bad_usb->thread);
     return bad_usb;
 } //-V773
@@ -692,9 +1182,15 @@ void bad_usb_script_close(BadUsbScript* bad_usb) {
     furi_thread_join(bad_usb->thread);
     furi_thread_free(bad_usb->thread);
     furi_string_free(bad_usb->file_path);
+    furi_string_free(bad_usb->bytecode_path);
     free(bad_usb);
 }
 
+void bad_usb_script_set_profiling(BadUsbScript* bad_usb, bool enable) {
+    furi_assert(bad_usb);
+    bad_usb->profile_enabled = enable; // Applied when the script is started
+}
+
 void bad_usb_script_set_keyboard_layout(BadUsbScript* bad_usb, FuriString* layout_path) {
     furi_assert(bad_usb);
 
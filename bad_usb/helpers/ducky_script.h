@@ -5,7 +5,7 @@ extern "C" {
 #endif
 
 #include <furi.h>
-#include <furi_hal.h>
+#include <furi_hal_usb_hid.h>
 #include "bad_usb_hid.h"
 
 typedef enum {
@@ -27,19 +27,30 @@ typedef struct {
     BadUsbWorkerState state;
     size_t line_cur;
     size_t line_nb;
+    size_t byte_cur; // Progress through the op stream, or the script file when not compiled
+    size_t byte_nb;
     uint32_t delay_remain;
+    uint32_t delay_jitter_max; // Worst wake up latency after a delay, ms
+    uint32_t delay_overrun_nb; // Waits that ended after their deadline
+    size_t stack_free; // Least worker stack space left so far, bytes
     size_t error_line;
+    char error_text[32]; // Start of the error line
     char error[64];
 } BadUsbState;
 
 typedef struct BadUsbScript BadUsbScript;
 
-BadUsbScript* bad_usb_script_open(FuriString* file_path, BadUsbHidInterface interface);
+BadUsbScript* bad_usb_script_open(
+    FuriString* file_path,
+    BadUsbHidInterface interface,
+    BadUsbHidSession* hid_session);
 
 void bad_usb_script_close(BadUsbScript* bad_usb);
 
 void bad_usb_script_set_keyboard_layout(BadUsbScript* bad_usb, FuriString* layout_path);
 
+void bad_usb_script_set_profiling(BadUsbScript* bad_usb, bool enable);
+
 void bad_usb_script_start(BadUsbScript* bad_usb);
 
 void bad_usb_script_stop(BadUsbScript* bad_usb);
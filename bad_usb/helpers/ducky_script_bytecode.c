@@ -0,0 +1,470 @@
+#include <furi.h>
+#include <storage/storage.h>
+#include <toolbox/path.h>
+#include "ducky_script.h"
+#include "ducky_script_i.h"
+
+#define TAG "BadUsb"
+
+#define WORKER_TAG TAG "Worker"
+
+#define DUCKY_BYTECODE_MAGIC   0x31434244 // "DBC1"
+#define DUCKY_BYTECODE_VERSION 7
+#define DUCKY_BYTECODE_EXT     ".dbc"
+
+#define DUCKY_BYTECODE_FLAG_JUMPS (1 << 0) // Script has blocks or function calls
+
+// Op streams of scripts with jumps are loaded in RAM up to this size
+#define DUCKY_BYTECODE_CODE_MAX 8192
+
+#define DUCKY_LINE_INDEX_STEP 64 // Script lines per line index entry
+// Index entries kept while compiling, longer scripts get a sparser index instead of more RAM
+#define DUCKY_LINE_INDEX_MAX 256
+
+static const char ducky_cmd_id[] = {"ID"};
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t id_set;
+    uint8_t flags;
+    uint32_t src_size;
+    uint32_t src_timestamp;
+    uint32_t line_nb;
+    uint32_t op_nb;
+    uint32_t str_max;
+    uint32_t code_size; // Size of the op stream following the header
+    uint32_t index_offset; // Script offsets of every index_step-th line
+    uint32_t index_nb;
+    uint32_t index_step;
+    FuriHalUsbHidConfig hid_cfg;
+} FURI_PACKED DuckyBytecodeHeader;
+
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t key;
+    char key_char;
+    uint32_t line;
+    int32_t arg[2];
+    uint8_t var;
+    uint8_t expr;
+    uint32_t jump; // Op address, relative to the start of the op stream
+    uint32_t str_len; // Payload bytes following the op, without the NUL terminator
+} FURI_PACKED DuckyBytecodeOp;
+
+void ducky_bytecode_get_path(FuriString* file_path, FuriString* bytecode_path) {
+    FuriString* file_name = furi_string_alloc();
+    path_extract_filename(file_path, file_name, false);
+    path_extract_dirname(furi_string_get_cstr(file_path), bytecode_path);
+    furi_string_cat_printf(
+        bytecode_path, "/.%s%s", furi_string_get_cstr(file_name), DUCKY_BYTECODE_EXT);
+    furi_string_free(file_name);
+}
+
+static bool ducky_bytecode_get_source_stamp(
+    Storage* storage,
+    FuriString* file_path,
+    uint32_t* size,
+    uint32_t* timestamp) {
+    FileInfo file_info;
+    const char* path = furi_string_get_cstr(file_path);
+    if(storage_common_stat(storage, path, &file_info) != FSE_OK) return false;
+    if(storage_common_timestamp(storage, path, timestamp) != FSE_OK) return false;
+    *size = (uint32_t)file_info.size;
+    return true;
+}
+
+// Each script line gives at most one op, its payload coming from the line itself
+static uint32_t ducky_bytecode_get_line_max(uint64_t script_size) {
+    return MIN(script_size, (uint64_t)UINT32_MAX) / 2 + 1; // Empty lines are merged
+}
+
+uint32_t ducky_bytecode_get_code_max(uint64_t script_size) {
+    uint64_t code_max =
+        (uint64_t)ducky_bytecode_get_line_max(script_size) * sizeof(DuckyBytecodeOp) +
+        script_size;
+    return MIN(code_max, (uint64_t)DUCKY_BYTECODE_CODE_MAX);
+}
+
+// Opens the bytecode cache and checks it against the script. The op stream is loaded in
+// code_buf when it fits, see ducky_bytecode_load_code
+bool ducky_bytecode_open(BadUsbScript* bad_usb, bool* id_set) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    const char* bytecode_path = furi_string_get_cstr(bad_usb->bytecode_path);
+    storage_file_close(bad_usb->bytecode_file);
+    bad_usb->line_index_nb = 0;
+    bad_usb->code = NULL;
+
+    bool state = false;
+    do {
+        uint32_t src_size = 0;
+        uint32_t src_timestamp = 0;
+        if(!ducky_bytecode_get_source_stamp(
+               storage, bad_usb->file_path, &src_size, &src_timestamp))
+            break;
+
+        if(!storage_file_open(
+               bad_usb->bytecode_file, bytecode_path, FSAM_READ, FSOM_OPEN_EXISTING))
+            break;
+
+        DuckyBytecodeHeader header;
+        if(storage_file_read(bad_usb->bytecode_file, &header, sizeof(header)) != sizeof(header))
+            break;
+        if((header.magic != DUCKY_BYTECODE_MAGIC) || (header.version != DUCKY_BYTECODE_VERSION))
+            break;
+        if((header.src_size != src_size) || (header.src_timestamp != src_timestamp)) {
+            FURI_LOG_D(WORKER_TAG, "Bytecode is outdated");
+            break;
+        }
+
+        // Compiled payloads fit in the line sized buffer of the arena
+        if((bad_usb->arena != NULL) && (header.str_max > bad_usb->line_len_max)) break;
+
+        bad_usb->bytecode_str_max = header.str_max;
+        bad_usb->code_size = header.code_size;
+        bad_usb->code_jumps = (header.flags & DUCKY_BYTECODE_FLAG_JUMPS) != 0;
+        if(!ducky_bytecode_load_code(bad_usb)) break;
+
+        bad_usb->st.line_nb = header.line_nb;
+        bad_usb->line_index_offset = header.index_offset;
+        bad_usb->line_index_nb = header.index_nb;
+        bad_usb->line_index_step = header.index_step;
+        *id_set = (header.id_set != 0);
+        if(*id_set) {
+            memcpy(&bad_usb->hid_cfg, &header.hid_cfg, sizeof(FuriHalUsbHidConfig));
+        }
+        FURI_LOG_D(WORKER_TAG, "Bytecode loaded: %lu ops", header.op_nb);
+        state = true;
+    } while(0);
+
+    if(!state) {
+        storage_file_close(bad_usb->bytecode_file);
+        bad_usb->code = NULL;
+    }
+
+    furi_record_close(RECORD_STORAGE);
+    return state;
+}
+
+// Loops and calls run without touching the storage when their op stream fits in code_buf.
+// Reads right after the header, false on a read error
+bool ducky_bytecode_load_code(BadUsbScript* bad_usb) {
+    if(!bad_usb->code_jumps || (bad_usb->code_size > bad_usb->code_buf_size)) return true;
+    if(bad_usb->code != NULL) return true;
+
+    if(storage_file_read(bad_usb->bytecode_file, bad_usb->code_buf, bad_usb->code_size) !=
+       bad_usb->code_size)
+        return false;
+    bad_usb->code = bad_usb->code_buf;
+    return true;
+}
+
+struct DuckyBytecodeCompiler {
+    DuckyBytecodeHeader header;
+    bool write_ok;
+    bool id_set;
+    int32_t result;
+    size_t vm_line; // First line needing the op stream, 0 if none
+    uint32_t* line_index;
+    uint32_t line_index_nb;
+    uint32_t line_index_max;
+    uint32_t line_index_step;
+};
+
+// Compiler state, line index and block compiler, all taken from compiler_buf
+size_t ducky_bytecode_get_compiler_size(uint64_t script_size) {
+    // One entry more than the script can need, so a full index can always be halved
+    uint32_t index_nb = ducky_bytecode_get_line_max(script_size) / DUCKY_LINE_INDEX_STEP + 2;
+    return sizeof(DuckyBytecodeCompiler) + ducky_vm_compiler_get_size() +
+           MIN(index_nb, (uint32_t)DUCKY_LINE_INDEX_MAX) * sizeof(uint32_t);
+}
+
+void ducky_bytecode_compile_begin(BadUsbScript* bad_usb, File* script_file, bool* id_set) {
+    furi_check(bad_usb->compiler_buf_size >= ducky_bytecode_get_compiler_size(0));
+    memset(bad_usb->compiler_buf, 0, bad_usb->compiler_buf_size);
+    DuckyBytecodeCompiler* compiler = bad_usb->compiler_buf;
+    size_t vm_size = ducky_vm_compiler_get_size();
+    uint8_t* compiler_end = (uint8_t*)compiler + sizeof(DuckyBytecodeCompiler);
+    compiler->line_index = (uint32_t*)(compiler_end + vm_size);
+    compiler->line_index_max = (bad_usb->compiler_buf_size - sizeof(DuckyBytecodeCompiler) -
+                                vm_size) /
+                               sizeof(uint32_t);
+    compiler->line_index_step = DUCKY_LINE_INDEX_STEP;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_file_close(bad_usb->bytecode_file);
+    bad_usb->code = NULL;
+
+    uint32_t src_size = 0;
+    uint32_t src_timestamp = 0;
+    bool write_ok =
+        ducky_bytecode_get_source_stamp(storage, bad_usb->file_path, &src_size, &src_timestamp);
+
+    DuckyBytecodeHeader* header = &compiler->header;
+    header->src_size = src_size;
+    header->src_timestamp = src_timestamp;
+    write_ok = write_ok && storage_file_open(
+                               bad_usb->bytecode_file,
+                               furi_string_get_cstr(bad_usb->bytecode_path),
+                               FSAM_WRITE,
+                               FSOM_CREATE_ALWAYS);
+    // Header is rewritten with a valid magic once the whole script is compiled
+    write_ok = write_ok && (storage_file_write(bad_usb->bytecode_file, header, sizeof(*header)) ==
+                            sizeof(*header));
+    compiler->write_ok = write_ok;
+    furi_record_close(RECORD_STORAGE);
+
+    bad_usb->buf_len = 0;
+    bad_usb->file_end = false;
+    bad_usb->st.line_cur = 0;
+    bad_usb->vm_compiler = (DuckyVmCompiler*)compiler_end;
+    bad_usb->bytecode_compiler = compiler;
+
+    // Only the first line can set the USB ID, so it is compiled right away
+    ducky_bytecode_compile_step(bad_usb, script_file, 1);
+    *id_set = compiler->id_set;
+}
+
+// Full index keeps every other entry and doubles its step, it never outgrows its buffer
+static void
+    ducky_bytecode_index_line(DuckyBytecodeCompiler* compiler, size_t line, uint32_t offset) {
+    if(compiler->line_index_nb == compiler->line_index_max) {
+        for(uint32_t i = 0; i < compiler->line_index_nb; i += 2) {
+            compiler->line_index[i / 2] = compiler->line_index[i];
+        }
+        compiler->line_index_nb = (compiler->line_index_nb + 1) / 2;
+        compiler->line_index_step *= 2;
+        if(((line - 1) % compiler->line_index_step) != 0) return;
+    }
+    compiler->line_index[compiler->line_index_nb++] = offset;
+}
+
+int32_t ducky_bytecode_compile_step(BadUsbScript* bad_usb, File* script_file, size_t line_nb) {
+    DuckyBytecodeCompiler* compiler = bad_usb->bytecode_compiler;
+    DuckyBytecodeHeader* header = &compiler->header;
+    if(compiler->result != 0) return compiler->result;
+
+    DuckyOp op;
+    const char* line_cstr;
+    for(; line_nb > 0; line_nb--) {
+        line_cstr = ducky_script_read_line(bad_usb, script_file);
+        if(line_cstr == NULL) {
+            compiler->result = SCRIPT_STATE_END;
+            break;
+        }
+
+        if(((bad_usb->st.line_cur - 1) % compiler->line_index_step) == 0) {
+            ducky_bytecode_index_line(compiler, bad_usb->st.line_cur, bad_usb->line_offset);
+        }
+
+        if((bad_usb->st.line_cur == 1) &&
+           (strncmp(line_cstr, ducky_cmd_id, strlen(ducky_cmd_id)) == 0)) {
+            compiler->id_set = ducky_set_usb_id(bad_usb, &line_cstr[strlen(ducky_cmd_id) + 1]);
+        }
+
+        int32_t result = ducky_parse_line(bad_usb, line_cstr, &op);
+        if(result == SCRIPT_STATE_NEXT_LINE) {
+            // Empty, REM, ID and END_IF lines leave no op, the next op keeps its own line number.
+            // A jump to END_IF lands on the op that follows it.
+            if(compiler->write_ok) {
+                compiler->write_ok = ducky_vm_compiler_advance(bad_usb, 0);
+            }
+            continue;
+        } else if(result < 0) {
+            bad_usb->st.error_line = bad_usb->st.line_cur;
+            FURI_LOG_E(WORKER_TAG, "Unknown command at line %zu", bad_usb->st.line_cur);
+            compiler->result = SCRIPT_STATE_ERROR;
+            break;
+        }
+
+        if((compiler->vm_line == 0) && ducky_vm_needs_code(&op)) {
+            compiler->vm_line = bad_usb->st.line_cur;
+        }
+        if(!compiler->write_ok) continue;
+
+        DuckyBytecodeOp op_rec = {
+            .type = op.type,
+            .flags = op.flags,
+            .key = op.key,
+            .key_char = op.key_char,
+            .line = bad_usb->st.line_cur,
+            .arg = {op.arg[0], op.arg[1]},
+            .var = op.var,
+            .expr = op.expr,
+            .jump = op.jump,
+            .str_len = op.str_len,
+        };
+        uint32_t op_size = sizeof(op_rec);
+        bool write_ok = (storage_file_write(bad_usb->bytecode_file, &op_rec, sizeof(op_rec)) ==
+                         sizeof(op_rec));
+        if(write_ok && (op.str_len > 0)) {
+            // Payload is stored with its terminator, so it can be used in place
+            op_size += op.str_len + 1;
+            write_ok = (storage_file_write(bad_usb->bytecode_file, op.str, op.str_len + 1) ==
+                        op.str_len + 1);
+        }
+        compiler->write_ok = write_ok && ducky_vm_compiler_advance(bad_usb, op_size);
+        header->op_nb++;
+        header->str_max = MAX(header->str_max, op.str_len);
+        header->code_size += op_size;
+        if(ducky_vm_is_jump(&op)) {
+            header->flags |= DUCKY_BYTECODE_FLAG_JUMPS;
+        }
+    }
+
+    return compiler->result;
+}
+
+int32_t ducky_bytecode_compile_end(BadUsbScript* bad_usb, bool* id_set) {
+    DuckyBytecodeCompiler* compiler = bad_usb->bytecode_compiler;
+    DuckyBytecodeHeader* header = &compiler->header;
+    bool write_ok = compiler->write_ok;
+
+    // Script is fully read only if the last step reached its end
+    int32_t result = (compiler->result == SCRIPT_STATE_END) ? 0 : SCRIPT_STATE_ERROR;
+    if(result == 0) {
+        result = ducky_vm_compiler_end(bad_usb);
+    }
+    if((result == 0) && !write_ok && (compiler->vm_line != 0)) {
+        // Text lines run one by one, blocks and variables only run from the saved op stream
+        bad_usb->st.error_line = compiler->vm_line;
+        ducky_error(bad_usb, "Can't save compiled script");
+        FURI_LOG_E(WORKER_TAG, "Bytecode can't be saved, blocks can't run");
+        result = SCRIPT_STATE_ERROR;
+    }
+    bad_usb->vm_compiler = NULL;
+
+    bad_usb->st.line_nb = bad_usb->st.line_cur;
+    bad_usb->st.line_cur = 0;
+    *id_set = compiler->id_set;
+
+    if(write_ok && (result == 0) && (compiler->line_index_nb > 0)) {
+        size_t index_size = compiler->line_index_nb * sizeof(uint32_t);
+        header->index_offset = storage_file_tell(bad_usb->bytecode_file);
+        header->index_nb = compiler->line_index_nb;
+        header->index_step = compiler->line_index_step;
+        write_ok = (storage_file_write(bad_usb->bytecode_file, compiler->line_index, index_size) ==
+                    index_size);
+    }
+
+    if(write_ok && (result == 0)) {
+        header->magic = DUCKY_BYTECODE_MAGIC;
+        header->version = DUCKY_BYTECODE_VERSION;
+        header->line_nb = bad_usb->st.line_nb;
+        header->id_set = *id_set;
+        if(*id_set) {
+            memcpy(&header->hid_cfg, &bad_usb->hid_cfg, sizeof(FuriHalUsbHidConfig));
+        }
+        write_ok = storage_file_seek(bad_usb->bytecode_file, 0, true) &&
+                   (storage_file_write(bad_usb->bytecode_file, header, sizeof(*header)) ==
+                    sizeof(*header));
+    }
+    storage_file_close(bad_usb->bytecode_file);
+
+    if((!write_ok) || (result != 0)) {
+        FURI_LOG_W(WORKER_TAG, "Bytecode not saved");
+        Storage* storage = furi_record_open(RECORD_STORAGE);
+        storage_common_remove(storage, furi_string_get_cstr(bad_usb->bytecode_path));
+        furi_record_close(RECORD_STORAGE);
+    }
+
+    bad_usb->bytecode_compiler = NULL;
+    return result;
+}
+
+void ducky_bytecode_rewind(BadUsbScript* bad_usb) {
+    ducky_bytecode_jump(bad_usb, 0);
+}
+
+void ducky_bytecode_jump(BadUsbScript* bad_usb, uint32_t addr) {
+    bad_usb->code_pc = addr;
+    if(bad_usb->code == NULL) {
+        storage_file_seek(bad_usb->bytecode_file, sizeof(DuckyBytecodeHeader) + addr, true);
+    }
+}
+
+bool ducky_bytecode_patch_jump(BadUsbScript* bad_usb, uint32_t addr, uint32_t target) {
+    // Jumps forward are written before their target is known, fill them in once it is
+    uint64_t write_pos = storage_file_tell(bad_usb->bytecode_file);
+    bool state = storage_file_seek(
+                     bad_usb->bytecode_file,
+                     sizeof(DuckyBytecodeHeader) + addr + offsetof(DuckyBytecodeOp, jump),
+                     true) &&
+                 (storage_file_write(bad_usb->bytecode_file, &target, sizeof(target)) ==
+                  sizeof(target));
+    return storage_file_seek(bad_usb->bytecode_file, write_pos, true) && state;
+}
+
+bool ducky_bytecode_get_line_offset(BadUsbScript* bad_usb, size_t* line, uint32_t* offset) {
+    if((*line == 0) || (*line > bad_usb->st.line_nb)) return false;
+    if(bad_usb->line_index_step == 0) return false;
+    uint32_t index_id = (*line - 1) / bad_usb->line_index_step;
+    if(index_id >= bad_usb->line_index_nb) return false;
+
+    // Keep the op stream position, the index lives after the last op
+    uint64_t op_pos = storage_file_tell(bad_usb->bytecode_file);
+    bool state = storage_file_seek(
+                     bad_usb->bytecode_file,
+                     bad_usb->line_index_offset + index_id * sizeof(uint32_t),
+                     true) &&
+                 (storage_file_read(bad_usb->bytecode_file, offset, sizeof(uint32_t)) ==
+                  sizeof(uint32_t));
+    storage_file_seek(bad_usb->bytecode_file, op_pos, true);
+
+    if(state) {
+        *line = index_id * bad_usb->line_index_step + 1;
+    }
+    return state;
+}
+
+int32_t ducky_bytecode_read_op(BadUsbScript* bad_usb, DuckyOp* op) {
+    DuckyBytecodeOp op_rec;
+    if((bad_usb->code_pc + sizeof(op_rec)) > bad_usb->code_size) {
+        return SCRIPT_STATE_END; // Line index follows the last op
+    }
+
+    if(bad_usb->code) {
+        memcpy(&op_rec, &bad_usb->code[bad_usb->code_pc], sizeof(op_rec));
+    } else if(
+        storage_file_read(bad_usb->bytecode_file, &op_rec, sizeof(op_rec)) != sizeof(op_rec)) {
+        return SCRIPT_STATE_END;
+    }
+    bad_usb->code_pc += sizeof(op_rec);
+
+    memset(op, 0, sizeof(DuckyOp));
+    op->type = op_rec.type;
+    op->flags = op_rec.flags;
+    op->key = op_rec.key;
+    op->key_char = op_rec.key_char;
+    op->arg[0] = op_rec.arg[0];
+    op->arg[1] = op_rec.arg[1];
+    op->var = op_rec.var;
+    op->expr = op_rec.expr;
+    op->jump = op_rec.jump;
+    bad_usb->st.line_cur = op_rec.line;
+
+    if(op_rec.str_len > 0) {
+        uint32_t str_size = op_rec.str_len + 1;
+        if((op_rec.str_len > bad_usb->bytecode_str_max) ||
+           ((bad_usb->code_pc + str_size) > bad_usb->code_size)) {
+            return ducky_error(bad_usb, "Bytecode read error");
+        }
+        if(bad_usb->code) {
+            op->str = (const char*)&bad_usb->code[bad_usb->code_pc];
+        } else if(
+            storage_file_read(bad_usb->bytecode_file, bad_usb->bytecode_str_buf, str_size) !=
+            str_size) {
+            return ducky_error(bad_usb, "Bytecode read error");
+        } else {
+            op->str = bad_usb->bytecode_str_buf;
+        }
+        if(op->str[op_rec.str_len] != '\0') {
+            return ducky_error(bad_usb, "Bytecode read error");
+        }
+        bad_usb->code_pc += str_size;
+        op->str_len = op_rec.str_len;
+    }
+
+    return 0;
+}
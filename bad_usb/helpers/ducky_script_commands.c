@@ -1,9 +1,13 @@
-#include <furi_hal.h>
+#include <furi_hal_usb_hid.h>
 #include <lib/toolbox/strint.h>
 #include "ducky_script.h"
 #include "ducky_script_i.h"
 
-typedef int32_t (*DuckyCmdCallback)(BadUsbScript* bad_usb, const char* line, int32_t param);
+typedef int32_t (*DuckyCmdCallback)(
+    BadUsbScript* bad_usb,
+    const char* line,
+    DuckyOp* op,
+    int32_t param);
 
 typedef struct {
     char* name;
@@ -11,175 +15,184 @@ typedef struct {
     int32_t param;
 } DuckyCmd;
 
-static int32_t ducky_fnc_delay(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_delay(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
     uint32_t delay_val = 0;
     bool state = ducky_get_number(line, &delay_val);
     if((state) && (delay_val > 0)) {
-        return (int32_t)delay_val;
+        op->type = DuckyOpDelay;
+        op->arg[0] = (int32_t)delay_val;
+        return 0;
     }
 
     return ducky_error(bad_usb, "Invalid number %s", line);
 }
 
-static int32_t ducky_fnc_defdelay(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_defdelay(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    bool state = ducky_get_number(line, &bad_usb->defdelay);
+    uint32_t delay_val = 0;
+    bool state = ducky_get_number(line, &delay_val);
     if(!state) {
         return ducky_error(bad_usb, "Invalid number %s", line);
     }
+    op->type = DuckyOpDefaultDelay;
+    op->arg[0] = (int32_t)delay_val;
     return 0;
 }
 
-static int32_t ducky_fnc_strdelay(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_strdelay(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    bool state = ducky_get_number(line, &bad_usb->stringdelay);
+    uint32_t delay_val = 0;
+    bool state = ducky_get_number(line, &delay_val);
     if(!state) {
         return ducky_error(bad_usb, "Invalid number %s", line);
     }
+    op->type = DuckyOpStringDelay;
+    op->arg[0] = (int32_t)delay_val;
     return 0;
 }
 
-static int32_t ducky_fnc_defstrdelay(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_defstrdelay(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    bool state = ducky_get_number(line, &bad_usb->defstringdelay);
+    uint32_t delay_val = 0;
+    bool state = ducky_get_number(line, &delay_val);
     if(!state) {
         return ducky_error(bad_usb, "Invalid number %s", line);
     }
+    op->type = DuckyOpDefaultStringDelay;
+    op->arg[0] = (int32_t)delay_val;
     return 0;
 }
 
-static int32_t ducky_fnc_string(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_string(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
+    UNUSED(bad_usb);
+
     line = &line[ducky_get_command_len(line) + 1];
-    furi_string_set_str(bad_usb->string_print, line);
+    op->type = DuckyOpString;
+    op->str = line;
+    op->str_len = strlen(line);
     if(param == 1) {
-        furi_string_cat(bad_usb->string_print, "\n");
+        op->flags |= DuckyOpFlagNewline;
     }
+    return 0;
+}
 
-    if(bad_usb->stringdelay == 0 &&
-       bad_usb->defstringdelay == 0) { // stringdelay not set - run command immediately
-        bool state = ducky_string(bad_usb, furi_string_get_cstr(bad_usb->string_print));
-        if(!state) {
-            return ducky_error(bad_usb, "Invalid string %s", line);
-        }
-    } else { // stringdelay is set - run command in thread to keep handling external events
-        return SCRIPT_STATE_STRING_START;
-    }
+static int32_t
+    ducky_fnc_stringfile(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
+    UNUSED(param);
 
+    uint32_t cmd_len = ducky_get_command_len(line);
+    line = (cmd_len > 0) ? &line[cmd_len + 1] : ""; // No space, no path after the command
+    if(ducky_is_line_end(line[0])) {
+        return ducky_error(bad_usb, "Invalid path %s", line);
+    }
+    op->type = DuckyOpStringFile;
+    op->str = line;
+    op->str_len = strlen(line);
     return 0;
 }
 
-static int32_t ducky_fnc_repeat(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_repeat(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    bool state = ducky_get_number(line, &bad_usb->repeat_cnt);
-    if((!state) || (bad_usb->repeat_cnt == 0)) {
+    uint32_t repeat_cnt = 0;
+    bool state = ducky_get_number(line, &repeat_cnt);
+    if((!state) || (repeat_cnt == 0)) {
         return ducky_error(bad_usb, "Invalid number %s", line);
     }
+    op->type = DuckyOpRepeat;
+    op->arg[0] = (int32_t)repeat_cnt;
     return 0;
 }
 
-static int32_t ducky_fnc_sysrq(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_sysrq(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
+    UNUSED(bad_usb);
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    uint16_t key = ducky_get_keycode(bad_usb, line, false);
-    bad_usb->hid->kb_press(bad_usb->hid_inst, KEY_MOD_LEFT_ALT | HID_KEYBOARD_PRINT_SCREEN);
-    bad_usb->hid->kb_press(bad_usb->hid_inst, key);
-    bad_usb->hid->release_all(bad_usb->hid_inst);
+    op->type = DuckyOpSysrq;
+    ducky_parse_keycode(line, false, op);
     return 0;
 }
 
-static int32_t ducky_fnc_altchar(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_altchar(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    ducky_numlock_on(bad_usb);
-    bool state = ducky_altchar(bad_usb, line);
-    if(!state) {
+    uint32_t i = 0;
+    while(!ducky_is_line_end(line[i])) {
+        if((line[i] < '0') || (line[i] > '9')) break;
+        i++;
+    }
+    if((i == 0) || (!ducky_is_line_end(line[i]))) {
         return ducky_error(bad_usb, "Invalid altchar %s", line);
     }
+    op->type = DuckyOpAltChar;
+    op->str = line;
+    op->str_len = strlen(line);
     return 0;
 }
 
-static int32_t ducky_fnc_altstring(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_altstring(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    ducky_numlock_on(bad_usb);
-    bool state = ducky_altstring(bad_usb, line);
-    if(!state) {
+    bool printable = false;
+    for(uint32_t i = 0; line[i] != '\0'; i++) {
+        if((line[i] >= ' ') && (line[i] <= '~')) {
+            printable = true;
+            break;
+        }
+    }
+    if(!printable) {
         return ducky_error(bad_usb, "Invalid altstring %s", line);
     }
+    op->type = DuckyOpAltString;
+    op->str = line;
+    op->str_len = strlen(line);
     return 0;
 }
 
-static int32_t ducky_fnc_hold(BadUsbScript* bad_usb, const char* line, int32_t param) {
-    UNUSED(param);
-    line = &line[ducky_get_command_len(line) + 1];
-
-    if(bad_usb->key_hold_nb > (HID_KB_MAX_KEYS - 1)) {
-        return ducky_error(bad_usb, "Too many keys are held");
-    }
-
-    // Handle Mouse Keys here
-    uint16_t key = ducky_get_mouse_keycode_by_name(line);
-    if(key != HID_MOUSE_NONE) {
-        bad_usb->key_hold_nb++;
-        bad_usb->hid->mouse_press(bad_usb->hid_inst, key);
-        return 0;
-    }
-
-    // Handle Keyboard keys here
-    key = ducky_get_keycode(bad_usb, line, true);
-    if(key != HID_KEYBOARD_NONE) {
-        bad_usb->key_hold_nb++;
-        bad_usb->hid->kb_press(bad_usb->hid_inst, key);
-        return 0;
-    }
-
-    // keyboard and mouse were none
-    return ducky_error(bad_usb, "Unknown keycode for %s", line);
-}
-
-static int32_t ducky_fnc_release(BadUsbScript* bad_usb, const char* line, int32_t param) {
-    UNUSED(param);
+static int32_t
+    ducky_fnc_hold(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
+    UNUSED(bad_usb);
     line = &line[ducky_get_command_len(line) + 1];
 
-    if(bad_usb->key_hold_nb == 0) {
-        return ducky_error(bad_usb, "No keys are held");
-    }
+    op->type = (param == 1) ? DuckyOpHold : DuckyOpRelease;
 
     // Handle Mouse Keys here
     uint16_t key = ducky_get_mouse_keycode_by_name(line);
     if(key != HID_MOUSE_NONE) {
-        bad_usb->key_hold_nb--;
-        bad_usb->hid->mouse_release(bad_usb->hid_inst, key);
-        return 0;
-    }
-
-    //Handle Keyboard Keys here
-    key = ducky_get_keycode(bad_usb, line, true);
-    if(key != HID_KEYBOARD_NONE) {
-        bad_usb->key_hold_nb--;
-        bad_usb->hid->kb_release(bad_usb->hid_inst, key);
+        op->flags |= DuckyOpFlagMouse;
+        op->key = key;
         return 0;
     }
 
-    // keyboard and mouse were none
-    return ducky_error(bad_usb, "No keycode defined for %s", line);
+    // Handle Keyboard keys here, layout dependent keys are checked on execution
+    ducky_parse_keycode(line, true, op);
+    return 0;
 }
 
-static int32_t ducky_fnc_media(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_media(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
@@ -187,36 +200,39 @@ static int32_t ducky_fnc_media(BadUsbScript* bad_usb, const char* line, int32_t
     if(key == HID_CONSUMER_UNASSIGNED) {
         return ducky_error(bad_usb, "No keycode defined for %s", line);
     }
-    bad_usb->hid->consumer_press(bad_usb->hid_inst, key);
-    bad_usb->hid->consumer_release(bad_usb->hid_inst, key);
+    op->type = DuckyOpMedia;
+    op->key = key;
     return 0;
 }
 
-static int32_t ducky_fnc_globe(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_globe(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
+    UNUSED(bad_usb);
     UNUSED(param);
 
     line = &line[ducky_get_command_len(line) + 1];
-    uint16_t key = ducky_get_keycode(bad_usb, line, false);
-    if(key == HID_KEYBOARD_NONE) {
-        return ducky_error(bad_usb, "No keycode defined for %s", line);
-    }
-
-    bad_usb->hid->consumer_press(bad_usb->hid_inst, HID_CONSUMER_FN_GLOBE);
-    bad_usb->hid->kb_press(bad_usb->hid_inst, key);
-    bad_usb->hid->kb_release(bad_usb->hid_inst, key);
-    bad_usb->hid->consumer_release(bad_usb->hid_inst, HID_CONSUMER_FN_GLOBE);
+    op->type = DuckyOpGlobe;
+    ducky_parse_keycode(line, false, op);
     return 0;
 }
 
-static int32_t ducky_fnc_waitforbutton(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_waitforbutton(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
     UNUSED(bad_usb);
     UNUSED(line);
 
-    return SCRIPT_STATE_WAIT_FOR_BTN;
+    op->type = DuckyOpWaitForButton;
+    return 0;
 }
 
-static int32_t ducky_fnc_mouse_scroll(BadUsbScript* bad_usb, const char* line, int32_t param) {
+#define DUCKY_MOUSE_STEP_MAX 127 // Largest delta of a single mouse report
+// Moves and scrolls are clamped when parsed, so one command sends DUCKY_MOUSE_DIST_MAX /
+// DUCKY_MOUSE_STEP_MAX reports at most. This covers an 8K screen edge to edge
+#define DUCKY_MOUSE_DIST_MAX 8192
+
+static int32_t
+    ducky_fnc_mouse_scroll(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[strcspn(line, " ") + 1];
@@ -226,12 +242,13 @@ static int32_t ducky_fnc_mouse_scroll(BadUsbScript* bad_usb, const char* line, i
         return ducky_error(bad_usb, "Invalid Number %s", line);
     }
 
-    bad_usb->hid->mouse_scroll(bad_usb->hid_inst, mouse_scroll_dist);
-
+    op->type = DuckyOpMouseScroll;
+    op->arg[0] = CLAMP(mouse_scroll_dist, DUCKY_MOUSE_DIST_MAX, -DUCKY_MOUSE_DIST_MAX);
     return 0;
 }
 
-static int32_t ducky_fnc_mouse_move(BadUsbScript* bad_usb, const char* line, int32_t param) {
+static int32_t
+    ducky_fnc_mouse_move(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
     UNUSED(param);
 
     line = &line[strcspn(line, " ") + 1];
@@ -248,8 +265,9 @@ static int32_t ducky_fnc_mouse_move(BadUsbScript* bad_usb, const char* line, int
         return ducky_error(bad_usb, "Invalid Number %s", line);
     }
 
-    bad_usb->hid->mouse_move(bad_usb->hid_inst, mouse_move_x, mouse_move_y);
-
+    op->type = DuckyOpMouseMove;
+    op->arg[0] = CLAMP(mouse_move_x, DUCKY_MOUSE_DIST_MAX, -DUCKY_MOUSE_DIST_MAX);
+    op->arg[1] = CLAMP(mouse_move_y, DUCKY_MOUSE_DIST_MAX, -DUCKY_MOUSE_DIST_MAX);
     return 0;
 }
 
@@ -259,6 +277,7 @@ static const DuckyCmd ducky_commands[] = {
     {"DELAY", ducky_fnc_delay, -1},
     {"STRING", ducky_fnc_string, 0},
     {"STRINGLN", ducky_fnc_string, 1},
+    {"STRINGFILE", ducky_fnc_stringfile, -1},
     {"DEFAULT_DELAY", ducky_fnc_defdelay, -1},
     {"DEFAULTDELAY", ducky_fnc_defdelay, -1},
     {"STRINGDELAY", ducky_fnc_strdelay, -1},
@@ -270,8 +289,8 @@ static const DuckyCmd ducky_commands[] = {
     {"ALTCHAR", ducky_fnc_altchar, -1},
     {"ALTSTRING", ducky_fnc_altstring, -1},
     {"ALTCODE", ducky_fnc_altstring, -1},
-    {"HOLD", ducky_fnc_hold, -1},
-    {"RELEASE", ducky_fnc_release, -1},
+    {"HOLD", ducky_fnc_hold, 1},
+    {"RELEASE", ducky_fnc_hold, 0},
     {"WAIT_FOR_BUTTON_PRESS", ducky_fnc_waitforbutton, -1},
     {"MEDIA", ducky_fnc_media, -1},
     {"GLOBE", ducky_fnc_globe, -1},
@@ -279,29 +298,250 @@ static const DuckyCmd ducky_commands[] = {
     {"MOUSE_MOVE", ducky_fnc_mouse_move, -1},
     {"MOUSESCROLL", ducky_fnc_mouse_scroll, -1},
     {"MOUSE_SCROLL", ducky_fnc_mouse_scroll, -1},
+    {"VAR", ducky_vm_parse_cmd, DuckyVmCmdVar},
+    {"WHILE", ducky_vm_parse_cmd, DuckyVmCmdWhile},
+    {"END_WHILE", ducky_vm_parse_cmd, DuckyVmCmdEndWhile},
+    {"IF", ducky_vm_parse_cmd, DuckyVmCmdIf},
+    {"ELSE", ducky_vm_parse_cmd, DuckyVmCmdElse},
+    {"END_IF", ducky_vm_parse_cmd, DuckyVmCmdEndIf},
+    {"FUNCTION", ducky_vm_parse_cmd, DuckyVmCmdFunction},
+    {"END_FUNCTION", ducky_vm_parse_cmd, DuckyVmCmdEndFunction},
+    {"RETURN", ducky_vm_parse_cmd, DuckyVmCmdReturn},
 };
 
 #define TAG "BadUsb"
 
 #define WORKER_TAG TAG "Worker"
 
-int32_t ducky_execute_cmd(BadUsbScript* bad_usb, const char* line) {
+int32_t ducky_parse_cmd(BadUsbScript* bad_usb, const char* line, DuckyOp* op) {
     size_t cmd_word_len = strcspn(line, " ");
-    for(size_t i = 0; i < COUNT_OF(ducky_commands); i++) {
-        size_t cmd_compare_len = strlen(ducky_commands[i].name);
+    const DuckyToken* token = ducky_get_token(line, cmd_word_len);
+    if(token && (token->cmd != DUCKY_TOKEN_NONE)) {
+        const DuckyCmd* cmd = &ducky_commands[token->cmd];
+        if(cmd->callback == NULL) {
+            return SCRIPT_STATE_NEXT_LINE; // REM and ID compile to nothing
+        } else {
+            return (cmd->callback)(bad_usb, line, op, cmd->param);
+        }
+    }
 
-        if(cmd_compare_len != cmd_word_len) {
-            continue;
+    return SCRIPT_STATE_CMD_UNKNOWN;
+}
+
+static uint32_t ducky_mouse_get_report_nb(int32_t delta) {
+    uint32_t dist = (delta < 0) ? -(uint32_t)delta : (uint32_t)delta;
+    return (dist + DUCKY_MOUSE_STEP_MAX - 1) / DUCKY_MOUSE_STEP_MAX;
+}
+
+// Mouse reports carry int8_t deltas, larger moves are split into the fewest reports, spread
+// evenly so the cursor follows a straight line. Each report waits for the host to poll the
+// previous one, which paces the stream
+static void ducky_mouse_move(BadUsbScript* bad_usb, int32_t dx, int32_t dy) {
+    uint32_t report_nb = MAX(ducky_mouse_get_report_nb(dx), ducky_mouse_get_report_nb(dy));
+    if(report_nb == 0) report_nb = 1; // A zero move still sends its report
+    int32_t pos_x = 0;
+    int32_t pos_y = 0;
+
+    for(uint32_t i = 1; i <= report_nb; i++) {
+        int32_t next_x = (int64_t)dx * i / report_nb;
+        int32_t next_y = (int64_t)dy * i / report_nb;
+        bad_usb->hid->mouse_move(bad_usb->hid_inst, next_x - pos_x, next_y - pos_y);
+        pos_x = next_x;
+        pos_y = next_y;
+    }
+}
+
+static void ducky_mouse_scroll(BadUsbScript* bad_usb, int32_t delta) {
+    do {
+        int8_t step = CLAMP(delta, DUCKY_MOUSE_STEP_MAX, -DUCKY_MOUSE_STEP_MAX);
+        bad_usb->hid->mouse_scroll(bad_usb->hid_inst, step);
+        delta -= step;
+    } while(delta != 0);
+}
+
+static int32_t ducky_op_string(BadUsbScript* bad_usb, const DuckyOp* op) {
+    const char* str = (op->str != NULL) ? op->str : "";
+    bool newline = (op->flags & DuckyOpFlagNewline);
+
+    size_t print_pos = 0;
+    if(bad_usb->stringdelay == 0 &&
+       bad_usb->defstringdelay == 0) { // stringdelay not set - run command immediately
+        print_pos = ducky_string(bad_usb, str, op->str_len, newline);
+        if(print_pos == (op->str_len + (newline ? 1 : 0))) {
+            return 0;
         }
+    }
+
+    // Delayed and long strings are typed by the worker, which keeps handling external events.
+    // Payload stays valid until the next op is read, it is typed from there
+    bad_usb->string_print = str;
+    bad_usb->string_print_len = op->str_len;
+    bad_usb->string_print_newline = newline;
+    bad_usb->string_print_pos = print_pos;
+    return SCRIPT_STATE_STRING_START;
+}
 
-        if(strncmp(line, ducky_commands[i].name, cmd_compare_len) == 0) {
-            if(ducky_commands[i].callback == NULL) {
-                return 0;
-            } else {
-                return (ducky_commands[i].callback)(bad_usb, line, ducky_commands[i].param);
-            }
+static int32_t ducky_op_string_file(BadUsbScript* bad_usb, const DuckyOp* op) {
+    const char* path = op->str;
+    if(op->str[0] != '/') { // Relative to the script folder
+        size_t dir_len = bad_usb->string_file_dir_len;
+        size_t path_len = snprintf(
+            &bad_usb->string_file_path[dir_len],
+            DUCKY_PATH_LEN_MAX - dir_len,
+            "/%s",
+            op->str);
+        if((dir_len + path_len) >= DUCKY_PATH_LEN_MAX) {
+            return ducky_error(bad_usb, "Path too long %s", op->str);
         }
+        path = bad_usb->string_file_path;
     }
 
-    return SCRIPT_STATE_CMD_UNKNOWN;
+    storage_file_close(bad_usb->string_file);
+    bool state = storage_file_open(bad_usb->string_file, path, FSAM_READ, FSOM_OPEN_EXISTING);
+    if(!state) {
+        storage_file_close(bad_usb->string_file);
+        return ducky_error(bad_usb, "Can't open %s", op->str);
+    }
+
+    // File is typed by the worker one chunk at a time, whatever the string delay
+    bad_usb->string_print = bad_usb->string_file_buf;
+    bad_usb->string_print_len = 0;
+    bad_usb->string_print_newline = false;
+    bad_usb->string_print_pos = 0;
+    return SCRIPT_STATE_STRING_START;
+}
+
+static int32_t ducky_op_hold(BadUsbScript* bad_usb, const DuckyOp* op) {
+    if(bad_usb->key_hold_nb > (HID_KB_MAX_KEYS - 1)) {
+        return ducky_error(bad_usb, "Too many keys are held");
+    }
+
+    if(op->flags & DuckyOpFlagMouse) {
+        bad_usb->key_hold_nb++;
+        bad_usb->hid->mouse_press(bad_usb->hid_inst, op->key);
+        return 0;
+    }
+
+    uint16_t key = ducky_get_keycode(bad_usb, op);
+    if(key != HID_KEYBOARD_NONE) {
+        bad_usb->key_hold_nb++;
+        bad_usb->hid->kb_press(bad_usb->hid_inst, key);
+        return 0;
+    }
+
+    // keyboard and mouse were none
+    return ducky_error(bad_usb, "Unknown keycode for %c", op->key_char);
+}
+
+static int32_t ducky_op_release(BadUsbScript* bad_usb, const DuckyOp* op) {
+    if(bad_usb->key_hold_nb == 0) {
+        return ducky_error(bad_usb, "No keys are held");
+    }
+
+    if(op->flags & DuckyOpFlagMouse) {
+        bad_usb->key_hold_nb--;
+        bad_usb->hid->mouse_release(bad_usb->hid_inst, op->key);
+        return 0;
+    }
+
+    uint16_t key = ducky_get_keycode(bad_usb, op);
+    if(key != HID_KEYBOARD_NONE) {
+        bad_usb->key_hold_nb--;
+        bad_usb->hid->kb_release(bad_usb->hid_inst, key);
+        return 0;
+    }
+
+    // keyboard and mouse were none
+    return ducky_error(bad_usb, "No keycode defined for %c", op->key_char);
+}
+
+int32_t ducky_execute_op(BadUsbScript* bad_usb, const DuckyOp* op) {
+    uint16_t key = HID_KEYBOARD_NONE;
+
+    switch(op->type) {
+    case DuckyOpNone:
+        return 0;
+    case DuckyOpDelay:
+        return op->arg[0];
+    case DuckyOpDefaultDelay:
+        bad_usb->defdelay = (uint32_t)op->arg[0];
+        return 0;
+    case DuckyOpStringDelay:
+        bad_usb->stringdelay = (uint32_t)op->arg[0];
+        return 0;
+    case DuckyOpDefaultStringDelay:
+        bad_usb->defstringdelay = (uint32_t)op->arg[0];
+        return 0;
+    case DuckyOpString:
+        return ducky_op_string(bad_usb, op);
+    case DuckyOpStringFile:
+        return ducky_op_string_file(bad_usb, op);
+    case DuckyOpRepeat:
+        bad_usb->repeat_cnt = (uint32_t)op->arg[0];
+        return 0;
+    case DuckyOpSysrq:
+        key = ducky_get_keycode(bad_usb, op);
+        bad_usb->hid->kb_press(bad_usb->hid_inst, KEY_MOD_LEFT_ALT | HID_KEYBOARD_PRINT_SCREEN);
+        bad_usb->hid->kb_press(bad_usb->hid_inst, key);
+        bad_usb->hid->release_all(bad_usb->hid_inst);
+        return 0;
+    case DuckyOpAltChar:
+        ducky_numlock_on(bad_usb);
+        if(!ducky_altchar(bad_usb, op->str)) {
+            return ducky_error(bad_usb, "Invalid altchar %s", op->str);
+        }
+        return 0;
+    case DuckyOpAltString:
+        ducky_numlock_on(bad_usb);
+        if(!ducky_altstring(bad_usb, op->str)) {
+            return ducky_error(bad_usb, "Invalid altstring %s", op->str);
+        }
+        return 0;
+    case DuckyOpHold:
+        return ducky_op_hold(bad_usb, op);
+    case DuckyOpRelease:
+        return ducky_op_release(bad_usb, op);
+    case DuckyOpWaitForButton:
+        return SCRIPT_STATE_WAIT_FOR_BTN;
+    case DuckyOpMedia:
+        bad_usb->hid->consumer_press(bad_usb->hid_inst, op->key);
+        bad_usb->hid->consumer_release(bad_usb->hid_inst, op->key);
+        return 0;
+    case DuckyOpGlobe:
+        key = ducky_get_keycode(bad_usb, op);
+        if(key == HID_KEYBOARD_NONE) {
+            return ducky_error(bad_usb, "No keycode defined for %c", op->key_char);
+        }
+        bad_usb->hid->consumer_press(bad_usb->hid_inst, HID_CONSUMER_FN_GLOBE);
+        bad_usb->hid->kb_press(bad_usb->hid_inst, key);
+        bad_usb->hid->kb_release(bad_usb->hid_inst, key);
+        bad_usb->hid->consumer_release(bad_usb->hid_inst, HID_CONSUMER_FN_GLOBE);
+        return 0;
+    case DuckyOpMouseMove:
+        ducky_mouse_move(bad_usb, op->arg[0], op->arg[1]);
+        return 0;
+    case DuckyOpMouseScroll:
+        ducky_mouse_scroll(bad_usb, op->arg[0]);
+        return 0;
+    case DuckyOpMouseClick:
+        bad_usb->hid->mouse_press(bad_usb->hid_inst, op->key);
+        bad_usb->hid->mouse_release(bad_usb->hid_inst, op->key);
+        return 0;
+    case DuckyOpKey:
+        key = ducky_get_keycode(bad_usb, op);
+        if(key == 0 && op->key_char) {
+            ducky_error(bad_usb, "No keycode defined for %c", op->key_char);
+        }
+        bad_usb->hid->kb_press(bad_usb->hid_inst, key);
+        bad_usb->hid->kb_release(bad_usb->hid_inst, key);
+        return 0;
+    case DuckyOpSet:
+    case DuckyOpJump:
+    case DuckyOpJumpIfNot:
+    case DuckyOpCall:
+    case DuckyOpReturn:
+        return ducky_vm_execute_op(bad_usb, op);
+    default:
+        return ducky_error(bad_usb, "Unknown opcode %u", op->type);
+    }
 }
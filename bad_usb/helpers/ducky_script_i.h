@@ -5,7 +5,8 @@ extern "C" {
 #endif
 
 #include <furi.h>
-#include <furi_hal.h>
+#include <furi_hal_usb_hid.h>
+#include <storage/storage.h>
 #include "ducky_script.h"
 #include "bad_usb_hid.h"
 
@@ -16,22 +17,155 @@ extern "C" {
 #define SCRIPT_STATE_STRING_START (-5)
 #define SCRIPT_STATE_WAIT_FOR_BTN (-6)
 
-#define FILE_BUFFER_LEN 16
+// Script read block size, can be overridden from the build (512 to 4096 bytes)
+#ifndef FILE_BUFFER_LEN
+#define FILE_BUFFER_LEN 512
+#endif
+
+// Longest script line. Line buffers are sized from the script up to this length and carved
+// out of the arena allocated at open, so running allocates nothing
+#ifndef DUCKY_LINE_LEN_MAX
+#define DUCKY_LINE_LEN_MAX 2048
+#endif
+
+#define DUCKY_PATH_LEN_MAX 256
+
+#define DUCKY_STRING_CHUNK_LEN 64 // STRINGFILE read size
+#define DUCKY_STRING_STEP_TIME 10 // ms spent typing before the worker checks its events
+
+// Worker stack. Its frames on the host build are taken as twice the target's: runs use at most
+// 4.4 KB there, profiler included, out of 8 KB. test_arena fails below a quarter of it left
+#define WORKER_STACK_SIZE 4096
+
+#define DUCKY_VM_VAR_NB     32 // Script variables
+#define DUCKY_VM_CALL_DEPTH 8 // Nested FUNCTION calls
 
 #define HID_MOUSE_INVALID 0
 #define HID_MOUSE_NONE    0
 
+#define BADUSB_ASCII_TO_KEY(script, x) \
+    (((uint8_t)x < 128) ? (script->layout[(uint8_t)x]) : HID_KEYBOARD_NONE)
+
+typedef enum {
+    DuckyOpNone,
+    DuckyOpDelay,
+    DuckyOpDefaultDelay,
+    DuckyOpStringDelay,
+    DuckyOpDefaultStringDelay,
+    DuckyOpString,
+    DuckyOpStringFile,
+    DuckyOpRepeat,
+    DuckyOpSysrq,
+    DuckyOpAltChar,
+    DuckyOpAltString,
+    DuckyOpHold,
+    DuckyOpRelease,
+    DuckyOpWaitForButton,
+    DuckyOpMedia,
+    DuckyOpGlobe,
+    DuckyOpMouseMove,
+    DuckyOpMouseScroll,
+    DuckyOpMouseClick,
+    DuckyOpKey,
+    DuckyOpSet,
+    DuckyOpJump,
+    DuckyOpJumpIfNot,
+    DuckyOpCall,
+    DuckyOpReturn,
+} DuckyOpType;
+
+typedef enum {
+    DuckyOpFlagNewline = (1 << 0), // STRINGLN: type Enter after the string
+    DuckyOpFlagMouse = (1 << 1), // HOLD/RELEASE: key is a mouse button
+    DuckyOpFlagArg0Var = (1 << 2), // VM: arg[0] is a variable index
+    DuckyOpFlagArg1Var = (1 << 3), // VM: arg[1] is a variable index
+} DuckyOpFlags;
+
+typedef enum {
+    DuckyVmCmdVar,
+    DuckyVmCmdWhile,
+    DuckyVmCmdEndWhile,
+    DuckyVmCmdIf,
+    DuckyVmCmdElse,
+    DuckyVmCmdEndIf,
+    DuckyVmCmdFunction,
+    DuckyVmCmdEndFunction,
+    DuckyVmCmdReturn,
+} DuckyVmCmd;
+
+/** Decoded script line, ready to be executed without touching the source text */
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t key; // Resolved keycode and modifiers
+    char key_char; // Character resolved through the keyboard layout at run time, 0 if none
+    int32_t arg[2];
+    const char* str; // NUL-terminated payload: STRING text, ALTCHAR/ALTSTRING argument
+    uint32_t str_len;
+    uint8_t var; // VM: assigned variable
+    uint8_t expr; // VM: operator applied to arg[0] and arg[1]
+    uint32_t jump; // VM: target op address
+} DuckyOp;
+
+#define DUCKY_TOKEN_NONE 0xFF
+
+// Command and key name lookup entry
+// Fields are indexes into the matching name tables, DUCKY_TOKEN_NONE if absent
+typedef struct {
+    uint16_t name_offset;
+    uint8_t name_len;
+    uint8_t cmd;
+    uint8_t modifier_key;
+    uint8_t key;
+    uint8_t media_key;
+    uint8_t mouse_key;
+} DuckyToken;
+
+typedef struct DuckyProfile DuckyProfile;
+
+typedef struct DuckyVmCompiler DuckyVmCompiler;
+
+typedef struct DuckyBytecodeCompiler DuckyBytecodeCompiler;
+
 struct BadUsbScript {
     FuriHalUsbHidConfig hid_cfg;
     const BadUsbHidApi* hid;
     void* hid_inst;
+    BadUsbHidInterface interface;
+    BadUsbHidSession* hid_session; // Owned by the app, outlives the script
     FuriThread* thread;
     BadUsbState st;
 
     FuriString* file_path;
-    uint8_t file_buf[FILE_BUFFER_LEN + 1];
-    uint8_t buf_start;
-    uint8_t buf_len;
+    FuriString* bytecode_path;
+    File* bytecode_file;
+    bool use_bytecode;
+    DuckyBytecodeCompiler* bytecode_compiler; // Only set while the script is being compiled
+    char* bytecode_str_buf; // bytecode_str_max + 1 bytes at least
+    uint32_t bytecode_str_max;
+    uint32_t line_index_offset; // Sparse line offset index in the bytecode file
+    uint32_t line_index_nb;
+    uint32_t line_index_step; // Script lines per index entry
+    uint8_t* code; // Op stream kept in RAM for scripts with jumps, code_buf when loaded
+    uint32_t code_size;
+    uint32_t code_pc; // Address of the next op
+    bool code_jumps;
+
+    // Buffers below are sized from the script and allocated at once before the worker leaves
+    // Init, running and the background compilation then allocate nothing
+    uint8_t* arena;
+    size_t arena_size;
+    uint8_t* code_buf;
+    uint32_t code_buf_size;
+    void* compiler_buf; // Bytecode compiler state, line index and block compiler
+    size_t compiler_buf_size;
+
+    char* file_buf; // file_buf_len + 1 bytes, room for the newline added at the script end
+    uint16_t file_buf_len; // Script read block size, FILE_BUFFER_LEN at most
+    uint16_t buf_start;
+    uint16_t buf_len;
+    uint32_t buf_offset; // Script offset of file_buf[0]
+    uint32_t line_offset; // Script offset the current line was read from
     bool file_end;
 
     uint32_t defdelay;
@@ -39,21 +173,47 @@ struct BadUsbScript {
     uint32_t defstringdelay;
     uint16_t layout[128];
 
-    FuriString* line;
-    FuriString* line_prev;
+    char* line; // Holds lines crossing a block boundary, line_len_max + 1 bytes
+    size_t line_len;
+    size_t line_len_max; // Script size up to DUCKY_LINE_LEN_MAX, no line can be longer
+    bool line_overflow; // Current line is longer than DUCKY_LINE_LEN_MAX
+    const char* line_cstr; // Current line, slice of file_buf or line contents
+    char* line_prev; // Payload of op_prev when running from text, line_len_max + 1 bytes then
+    DuckyOp op;
+    DuckyOp op_prev;
     uint32_t repeat_cnt;
     uint8_t key_hold_nb;
 
-    FuriString* string_print;
-    size_t string_print_pos;
+    DuckyVmCompiler* vm_compiler; // Only set while the script is compiled
+    int32_t vm_var[DUCKY_VM_VAR_NB];
+    uint32_t vm_call_stack[DUCKY_VM_CALL_DEPTH];
+    uint8_t vm_call_depth;
+
+    const char* string_print; // STRING payload typed with delays, owned by the current op
+    uint32_t string_print_len;
+    bool string_print_newline;
+    uint32_t string_print_pos;
+    File* string_file; // STRINGFILE source, typed in DUCKY_STRING_CHUNK_LEN blocks
+    char string_file_buf[DUCKY_STRING_CHUNK_LEN];
+    char string_file_path[DUCKY_PATH_LEN_MAX]; // Script folder, followed by the file name
+    size_t string_file_dir_len;
+
+    bool profile_enabled; // Diagnostic mode, allocates its table at start and its report at end
+    DuckyProfile* profile;
 };
 
-uint16_t ducky_get_keycode(BadUsbScript* bad_usb, const char* param, bool accept_modifiers);
+void ducky_parse_keycode(const char* param, bool accept_modifiers, DuckyOp* op);
+
+uint16_t ducky_get_keycode(BadUsbScript* bad_usb, const DuckyOp* op);
 
 uint32_t ducky_get_command_len(const char* line);
 
 bool ducky_is_line_end(const char chr);
 
+const DuckyToken* ducky_get_token(const char* name, size_t len);
+
+size_t ducky_get_token_len(const char* param, bool modifier);
+
 uint16_t ducky_get_next_modifier_keycode_by_name(const char** param);
 
 uint16_t ducky_get_modifier_keycode_by_name(const char* param);
@@ -68,15 +228,83 @@ bool ducky_get_number(const char* param, uint32_t* val);
 
 void ducky_numlock_on(BadUsbScript* bad_usb);
 
+// Drops the cached LED state when key toggles NumLock
 bool ducky_numpad_press(BadUsbScript* bad_usb, const char num);
 
 bool ducky_altchar(BadUsbScript* bad_usb, const char* charcode);
 
 bool ducky_altstring(BadUsbScript* bad_usb, const char* param);
 
-bool ducky_string(BadUsbScript* bad_usb, const char* param);
+size_t ducky_string(BadUsbScript* bad_usb, const char* param, size_t len, bool newline);
+
+int32_t ducky_parse_cmd(BadUsbScript* bad_usb, const char* line, DuckyOp* op);
+
+int32_t ducky_parse_line(BadUsbScript* bad_usb, const char* line, DuckyOp* op);
+
+int32_t ducky_execute_op(BadUsbScript* bad_usb, const DuckyOp* op);
+
+const char* ducky_script_read_line(BadUsbScript* bad_usb, File* script_file);
+
+bool ducky_script_seek_line(BadUsbScript* bad_usb, File* script_file, size_t line);
+
+bool ducky_set_usb_id(BadUsbScript* bad_usb, const char* line);
+
+void ducky_bytecode_get_path(FuriString* file_path, FuriString* bytecode_path);
+
+bool ducky_bytecode_open(BadUsbScript* bad_usb, bool* id_set);
+
+bool ducky_bytecode_load_code(BadUsbScript* bad_usb);
+
+uint32_t ducky_bytecode_get_code_max(uint64_t script_size);
+
+size_t ducky_bytecode_get_compiler_size(uint64_t script_size);
+
+void ducky_bytecode_compile_begin(BadUsbScript* bad_usb, File* script_file, bool* id_set);
+
+int32_t ducky_bytecode_compile_step(BadUsbScript* bad_usb, File* script_file, size_t line_nb);
+
+int32_t ducky_bytecode_compile_end(BadUsbScript* bad_usb, bool* id_set);
+
+void ducky_bytecode_rewind(BadUsbScript* bad_usb);
+
+int32_t ducky_bytecode_read_op(BadUsbScript* bad_usb, DuckyOp* op);
+
+bool ducky_bytecode_get_line_offset(BadUsbScript* bad_usb, size_t* line, uint32_t* offset);
+
+void ducky_bytecode_jump(BadUsbScript* bad_usb, uint32_t addr);
+
+bool ducky_bytecode_patch_jump(BadUsbScript* bad_usb, uint32_t addr, uint32_t target);
+
+size_t ducky_vm_compiler_get_size(void);
+
+bool ducky_vm_compiler_advance(BadUsbScript* bad_usb, uint32_t op_size);
+
+int32_t ducky_vm_compiler_end(BadUsbScript* bad_usb);
+
+int32_t ducky_vm_parse_cmd(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param);
+
+int32_t ducky_vm_parse_line(BadUsbScript* bad_usb, const char* line, DuckyOp* op);
+
+bool ducky_vm_is_jump(const DuckyOp* op);
+
+// Blocks, variables and ops reading them only run from a compiled script
+bool ducky_vm_needs_code(const DuckyOp* op);
+
+void ducky_vm_reset(BadUsbScript* bad_usb);
+
+int32_t ducky_vm_execute_op(BadUsbScript* bad_usb, const DuckyOp* op);
+
+void ducky_profile_start(BadUsbScript* bad_usb);
+
+void ducky_profile_stop(BadUsbScript* bad_usb);
+
+void ducky_profile_step_start(DuckyProfile* profile);
+
+void ducky_profile_step_parsed(DuckyProfile* profile);
+
+void ducky_profile_step_end(DuckyProfile* profile, size_t line, int32_t delay);
 
-int32_t ducky_execute_cmd(BadUsbScript* bad_usb, const char* line);
+void ducky_profile_save(BadUsbScript* bad_usb);
 
 int32_t ducky_error(BadUsbScript* bad_usb, const char* text, ...);
 
@@ -1,4 +1,4 @@
-#include <furi_hal.h>
+#include <furi_hal_usb_hid.h>
 #include "ducky_script_i.h"
 
 typedef struct {
@@ -114,66 +114,58 @@ static const DuckyKey ducky_mouse_keys[] = {
     {"WHEEL_CLICK", HID_MOUSE_BTN_WHEEL},
 };
 
+size_t ducky_get_token_len(const char* param, bool modifier) {
+    size_t len = 0;
+    while(!ducky_is_line_end(param[len]) && !(modifier && (param[len] == '-'))) {
+        len++;
+    }
+    return len;
+}
+
 uint16_t ducky_get_next_modifier_keycode_by_name(const char** param) {
     const char* input_str = *param;
+    size_t key_cmd_len = ducky_get_token_len(input_str, true);
 
-    for(size_t i = 0; i < COUNT_OF(ducky_modifier_keys); i++) {
-        size_t key_cmd_len = strlen(ducky_modifier_keys[i].name);
-        if((strncmp(input_str, ducky_modifier_keys[i].name, key_cmd_len) == 0)) {
-            char next_char_after_key = input_str[key_cmd_len];
-            if(ducky_is_line_end(next_char_after_key) || (next_char_after_key == '-')) {
-                *param = &input_str[key_cmd_len];
-                return ducky_modifier_keys[i].keycode;
-            }
-        }
+    const DuckyToken* token = ducky_get_token(input_str, key_cmd_len);
+    if(token && (token->modifier_key != DUCKY_TOKEN_NONE)) {
+        *param = &input_str[key_cmd_len];
+        return ducky_modifier_keys[token->modifier_key].keycode;
     }
 
     return HID_KEYBOARD_NONE;
 }
 
 uint16_t ducky_get_modifier_keycode_by_name(const char* param) {
-    for(size_t i = 0; i < COUNT_OF(ducky_modifier_keys); i++) {
-        size_t key_cmd_len = strlen(ducky_modifier_keys[i].name);
-        if((strncmp(param, ducky_modifier_keys[i].name, key_cmd_len) == 0) &&
-           (ducky_is_line_end(param[key_cmd_len]))) {
-            return ducky_modifier_keys[i].keycode;
-        }
+    const DuckyToken* token = ducky_get_token(param, ducky_get_token_len(param, false));
+    if(token && (token->modifier_key != DUCKY_TOKEN_NONE)) {
+        return ducky_modifier_keys[token->modifier_key].keycode;
     }
 
     return HID_KEYBOARD_NONE;
 }
 
 uint16_t ducky_get_keycode_by_name(const char* param) {
-    for(size_t i = 0; i < COUNT_OF(ducky_keys); i++) {
-        size_t key_cmd_len = strlen(ducky_keys[i].name);
-        if((strncmp(param, ducky_keys[i].name, key_cmd_len) == 0) &&
-           (ducky_is_line_end(param[key_cmd_len]))) {
-            return ducky_keys[i].keycode;
-        }
+    const DuckyToken* token = ducky_get_token(param, ducky_get_token_len(param, false));
+    if(token && (token->key != DUCKY_TOKEN_NONE)) {
+        return ducky_keys[token->key].keycode;
     }
 
     return HID_KEYBOARD_NONE;
 }
 
 uint16_t ducky_get_media_keycode_by_name(const char* param) {
-    for(size_t i = 0; i < COUNT_OF(ducky_media_keys); i++) {
-        size_t key_cmd_len = strlen(ducky_media_keys[i].name);
-        if((strncmp(param, ducky_media_keys[i].name, key_cmd_len) == 0) &&
-           (ducky_is_line_end(param[key_cmd_len]))) {
-            return ducky_media_keys[i].keycode;
-        }
+    const DuckyToken* token = ducky_get_token(param, ducky_get_token_len(param, false));
+    if(token && (token->media_key != DUCKY_TOKEN_NONE)) {
+        return ducky_media_keys[token->media_key].keycode;
     }
 
     return HID_CONSUMER_UNASSIGNED;
 }
 
 uint8_t ducky_get_mouse_keycode_by_name(const char* param) {
-    for(size_t i = 0; i < COUNT_OF(ducky_mouse_keys); i++) {
-        size_t key_cmd_len = strlen(ducky_mouse_keys[i].name);
-        if((strncmp(param, ducky_mouse_keys[i].name, key_cmd_len) == 0) &&
-           (ducky_is_line_end(param[key_cmd_len]))) {
-            return ducky_mouse_keys[i].keycode;
-        }
+    const DuckyToken* token = ducky_get_token(param, ducky_get_token_len(param, false));
+    if(token && (token->mouse_key != DUCKY_TOKEN_NONE)) {
+        return ducky_mouse_keys[token->mouse_key].keycode;
     }
 
     return HID_MOUSE_INVALID;
@@ -0,0 +1,355 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+#include <storage/storage.h>
+#include <toolbox/path.h>
+#include "ducky_script.h"
+#include "ducky_script_i.h"
+
+#define TAG "BadUsb"
+
+#define WORKER_TAG TAG "Worker"
+
+#define DUCKY_PROFILE_FOLDER  EXT_PATH("badusb/.profile")
+#define DUCKY_PROFILE_EXT     ".csv"
+#define DUCKY_PROFILE_SLOWEST 16 // Lines kept in the report
+
+typedef struct {
+    uint32_t line;
+    uint32_t runs;
+    uint32_t parse_time;
+    uint32_t exec_time;
+    uint32_t hid_time;
+    uint32_t delay;
+} DuckyProfileLine;
+
+struct DuckyProfile {
+    // Backend the profiler forwards HID calls to
+    const BadUsbHidApi* hid;
+    void* hid_inst;
+
+    uint32_t step_start;
+    uint32_t step_parsed;
+    uint32_t step_hid_time;
+    uint32_t run_start;
+
+    DuckyProfileLine total;
+    DuckyProfileLine slowest[DUCKY_PROFILE_SLOWEST];
+    size_t slowest_nb;
+};
+
+static uint32_t ducky_profile_get_cycles(void) {
+    return furi_hal_cortex_timer_get(0).start;
+}
+
+static uint32_t ducky_profile_cycles_to_us(uint32_t cycles) {
+    return cycles / furi_hal_cortex_instructions_per_microsecond();
+}
+
+// HID backend wrapper, accounts the time spent blocked in the real backend
+
+static void ducky_profile_hid_time(DuckyProfile* profile, uint32_t hid_start) {
+    profile->step_hid_time += ducky_profile_get_cycles() - hid_start;
+}
+
+static void* ducky_profile_hid_init(FuriHalUsbHidConfig* hid_cfg) {
+    UNUSED(hid_cfg);
+    furi_crash("Profiled HID is not initialized directly");
+}
+
+static void ducky_profile_hid_deinit(void* inst) {
+    DuckyProfile* profile = inst;
+    profile->hid->deinit(profile->hid_inst);
+}
+
+static void ducky_profile_hid_set_state_callback(void* inst, HidStateCallback cb, void* context) {
+    DuckyProfile* profile = inst;
+    profile->hid->set_state_callback(profile->hid_inst, cb, context);
+}
+
+static bool ducky_profile_hid_is_connected(void* inst) {
+    DuckyProfile* profile = inst;
+    return profile->hid->is_connected(profile->hid_inst);
+}
+
+static bool ducky_profile_hid_is_ready(void* inst) {
+    DuckyProfile* profile = inst;
+    return profile->hid->is_ready(profile->hid_inst);
+}
+
+static bool ducky_profile_hid_kb_press(void* inst, uint16_t button) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->kb_press(profile->hid_inst, button);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_kb_release(void* inst, uint16_t button) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->kb_release(profile->hid_inst, button);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_kb_release_all(void* inst) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->kb_release_all(profile->hid_inst);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_mouse_press(void* inst, uint8_t button) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->mouse_press(profile->hid_inst, button);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_mouse_release(void* inst, uint8_t button) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->mouse_release(profile->hid_inst, button);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_mouse_scroll(void* inst, int8_t delta) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->mouse_scroll(profile->hid_inst, delta);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_mouse_move(void* inst, int8_t dx, int8_t dy) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->mouse_move(profile->hid_inst, dx, dy);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_consumer_press(void* inst, uint16_t button) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->consumer_press(profile->hid_inst, button);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_consumer_release(void* inst, uint16_t button) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->consumer_release(profile->hid_inst, button);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static bool ducky_profile_hid_release_all(void* inst) {
+    DuckyProfile* profile = inst;
+    uint32_t hid_start = ducky_profile_get_cycles();
+    bool state = profile->hid->release_all(profile->hid_inst);
+    ducky_profile_hid_time(profile, hid_start);
+    return state;
+}
+
+static uint8_t ducky_profile_hid_get_led_state(void* inst) {
+    DuckyProfile* profile = inst;
+    return profile->hid->get_led_state(profile->hid_inst);
+}
+
+static const BadUsbHidApi ducky_profile_hid_api = {
+    .init = ducky_profile_hid_init,
+    .deinit = ducky_profile_hid_deinit,
+    .set_state_callback = ducky_profile_hid_set_state_callback,
+    .is_connected = ducky_profile_hid_is_connected,
+    .is_ready = ducky_profile_hid_is_ready,
+
+    .kb_press = ducky_profile_hid_kb_press,
+    .kb_release = ducky_profile_hid_kb_release,
+    .kb_release_all = ducky_profile_hid_kb_release_all,
+    .mouse_press = ducky_profile_hid_mouse_press,
+    .mouse_release = ducky_profile_hid_mouse_release,
+    .mouse_scroll = ducky_profile_hid_mouse_scroll,
+    .mouse_move = ducky_profile_hid_mouse_move,
+    .consumer_press = ducky_profile_hid_consumer_press,
+    .consumer_release = ducky_profile_hid_consumer_release,
+    .release_all = ducky_profile_hid_release_all,
+    .get_led_state = ducky_profile_hid_get_led_state,
+};
+
+void ducky_profile_start(BadUsbScript* bad_usb) {
+    DuckyProfile* profile = bad_usb->profile;
+    if(profile == NULL) {
+        profile = malloc(sizeof(DuckyProfile));
+        profile->hid = bad_usb->hid;
+        profile->hid_inst = bad_usb->hid_inst;
+        bad_usb->hid = &ducky_profile_hid_api;
+        bad_usb->hid_inst = profile;
+        bad_usb->profile = profile;
+    }
+
+    memset(&profile->total, 0, sizeof(DuckyProfileLine));
+    profile->slowest_nb = 0;
+    profile->run_start = furi_get_tick();
+}
+
+void ducky_profile_stop(BadUsbScript* bad_usb) {
+    DuckyProfile* profile = bad_usb->profile;
+    if(profile == NULL) return;
+
+    bad_usb->hid = profile->hid;
+    bad_usb->hid_inst = profile->hid_inst;
+    bad_usb->profile = NULL;
+    free(profile);
+}
+
+void ducky_profile_step_start(DuckyProfile* profile) {
+    if(profile == NULL) return;
+    profile->step_start = ducky_profile_get_cycles();
+    profile->step_parsed = profile->step_start;
+    profile->step_hid_time = 0;
+}
+
+void ducky_profile_step_parsed(DuckyProfile* profile) {
+    if(profile == NULL) return;
+    profile->step_parsed = ducky_profile_get_cycles();
+}
+
+static uint32_t ducky_profile_line_time(const DuckyProfileLine* line) {
+    return line->parse_time + line->exec_time;
+}
+
+static void ducky_profile_add_slowest(DuckyProfile* profile, const DuckyProfileLine* step) {
+    DuckyProfileLine line = *step;
+
+    // Lines executed several times (REPEAT) keep their slowest run
+    for(size_t i = 0; i < profile->slowest_nb; i++) {
+        if(profile->slowest[i].line != line.line) continue;
+        line.runs += profile->slowest[i].runs;
+        if(ducky_profile_line_time(&line) <= ducky_profile_line_time(&profile->slowest[i])) {
+            profile->slowest[i].runs = line.runs;
+            return;
+        }
+        profile->slowest_nb--;
+        memmove(
+            &profile->slowest[i],
+            &profile->slowest[i + 1],
+            (profile->slowest_nb - i) * sizeof(DuckyProfileLine));
+        break;
+    }
+
+    size_t pos = profile->slowest_nb;
+    if(pos == DUCKY_PROFILE_SLOWEST) {
+        if(ducky_profile_line_time(&line) <=
+           ducky_profile_line_time(&profile->slowest[DUCKY_PROFILE_SLOWEST - 1]))
+            return;
+        pos--;
+    } else {
+        profile->slowest_nb++;
+    }
+
+    // Keep the list sorted, slowest first
+    while((pos > 0) &&
+          (ducky_profile_line_time(&line) > ducky_profile_line_time(&profile->slowest[pos - 1]))) {
+        profile->slowest[pos] = profile->slowest[pos - 1];
+        pos--;
+    }
+    profile->slowest[pos] = line;
+}
+
+void ducky_profile_step_end(DuckyProfile* profile, size_t line, int32_t delay) {
+    if((profile == NULL) || (delay == SCRIPT_STATE_END)) return;
+
+    uint32_t step_end = ducky_profile_get_cycles();
+    DuckyProfileLine step = {
+        .line = line,
+        .runs = 1,
+        .parse_time = ducky_profile_cycles_to_us(profile->step_parsed - profile->step_start),
+        .exec_time = ducky_profile_cycles_to_us(step_end - profile->step_parsed),
+        .hid_time = ducky_profile_cycles_to_us(profile->step_hid_time),
+        .delay = (delay > 0) ? delay : 0,
+    };
+
+    profile->total.runs++;
+    profile->total.parse_time += step.parse_time;
+    profile->total.exec_time += step.exec_time;
+    profile->total.hid_time += step.hid_time;
+    profile->total.delay += step.delay;
+    ducky_profile_add_slowest(profile, &step);
+}
+
+static bool ducky_profile_write_line(File* file, FuriString* str, const DuckyProfileLine* line) {
+    furi_string_printf(
+        str,
+        "%lu,%lu,%lu,%lu,%lu,%lu\n",
+        line->line,
+        line->runs,
+        line->parse_time,
+        line->exec_time,
+        line->hid_time,
+        line->delay);
+    size_t len = furi_string_size(str);
+    return storage_file_write(file, furi_string_get_cstr(str), len) == len;
+}
+
+void ducky_profile_save(BadUsbScript* bad_usb) {
+    DuckyProfile* profile = bad_usb->profile;
+    if(profile == NULL) return;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    FuriString* str = furi_string_alloc();
+    FuriString* report_path = furi_string_alloc();
+
+    path_extract_filename(bad_usb->file_path, str, true);
+    furi_string_printf(
+        report_path,
+        "%s/%s%s",
+        DUCKY_PROFILE_FOLDER,
+        furi_string_get_cstr(str),
+        DUCKY_PROFILE_EXT);
+    storage_simply_mkdir(storage, DUCKY_PROFILE_FOLDER);
+
+    bool state = false;
+    do {
+        if(!storage_file_open(
+               file, furi_string_get_cstr(report_path), FSAM_WRITE, FSOM_CREATE_ALWAYS))
+            break;
+
+        // Times in microseconds, delays in milliseconds. Line 0 holds the totals
+        furi_string_printf(
+            str,
+            "# %s, run %lu ms, stack space left %zu\nline,runs,parse_us,exec_us,hid_us,delay_ms\n",
+            furi_string_get_cstr(bad_usb->file_path),
+            furi_get_tick() - profile->run_start,
+            furi_thread_get_stack_space(furi_thread_get_current_id()));
+        if(storage_file_write(file, furi_string_get_cstr(str), furi_string_size(str)) !=
+           furi_string_size(str))
+            break;
+        if(!ducky_profile_write_line(file, str, &profile->total)) break;
+
+        size_t i = 0;
+        for(; i < profile->slowest_nb; i++) {
+            if(!ducky_profile_write_line(file, str, &profile->slowest[i])) break;
+        }
+        state = (i == profile->slowest_nb);
+    } while(0);
+
+    if(state) {
+        FURI_LOG_I(WORKER_TAG, "Profile saved: %s", furi_string_get_cstr(report_path));
+    } else {
+        FURI_LOG_E(WORKER_TAG, "Profile save error");
+    }
+
+    furi_string_free(report_path);
+    furi_string_free(str);
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    // Saved after the run state changed, the high water mark is taken again to cover it
+    bad_usb->st.stack_free = furi_thread_get_stack_space(furi_thread_get_current_id());
+}
@@ -0,0 +1,177 @@
+/* Generated by ducky_script_tokens.py, do not edit */
+/* Token fields: name offset, name length, index in ducky_commands, ducky_modifier_keys, */
+/* ducky_keys, ducky_media_keys, ducky_mouse_keys */
+
+#include "ducky_script_i.h"
+
+#define DUCKY_TOKEN_NB      122
+#define DUCKY_TOKEN_BUCKETS 31
+#define NONE                DUCKY_TOKEN_NONE
+
+static const uint16_t ducky_token_displacement[DUCKY_TOKEN_BUCKETS] = {
+    20, 497, 9, 2, 811, 1, 76, 90, 36, 94, 5, 71,
+    12, 5, 1918, 148, 1, 0, 1, 1465, 4, 1246, 6, 4,
+    5948, 644, 631, 2899, 7, 4, 1407,
+};
+
+static const char ducky_token_pool[] =
+    "F6DELAYDEFAULTSTRINGDELAYF12DEFAULT_STRING_DELAYCONTROLUPF14PAGEUPVARMUTEF19F5"
+    "STOPESCAPEFNF8LEFT_CLICKDOWNF7LEFTARROWF9F22WAIT_FOR_BUTTON_PRESSALTCHARRELEASE"
+    "F1DELETEBACKLEFTBREAKCAPSLOCKENDAPPLEFTCLICKALTSTRINGF24SPACETABSHIFTF3NUMLOCK"
+    "END_WHILEMEDIAVOLUME_UPSLEEPREFRESHBACKSPACEPAUSEEND_FUNCTIONALTCODESCROLLLOCK"
+    "SNAPSHOTF11IDMIDDLE_CLICKRETURNREMSTRINGRIGHTCLICKENTERF20FORWARDSTRINGLNF17"
+    "RIGHT_CLICKMOUSE_MOVEREPEATGUIBRIGHT_DOWNALTNEXT_TRACKPAGEDOWNF16INSERT"
+    "RIGHTARROWEND_IFPLAYF4MENUGLOBEPOWERF23F15F2CTRLPREV_TRACKMOUSESCROLLUPARROWF18"
+    "DEFAULTDELAYPRINTSCREENDOWNARROWHOLDEXITESCSTRINGFILEREBOOTLOGOFFVOLUME_DOWN"
+    "WHILERIGHTELSEWHEELCLICKDEFAULT_DELAYF21EJECTF10PLAY_PAUSEMOUSE_SCROLLMOUSEMOVE"
+    "MIDDLECLICKSTRINGDELAYSYSRQF13HOMEFUNCTIONIFWINDOWSBRIGHT_UPSTRING_DELAY"
+    "WHEEL_CLICK";
+
+static const DuckyToken ducky_tokens[DUCKY_TOKEN_NB] = {
+    {0, 2, NONE, NONE, 33, NONE, NONE}, // F6
+    {2, 5, 2, NONE, NONE, NONE, NONE}, // DELAY
+    {7, 18, 11, NONE, NONE, NONE, NONE}, // DEFAULTSTRINGDELAY
+    {25, 3, NONE, NONE, 39, NONE, NONE}, // F12
+    {28, 20, 10, NONE, NONE, NONE, NONE}, // DEFAULT_STRING_DELAY
+    {48, 7, NONE, 1, NONE, NONE, NONE}, // CONTROL
+    {55, 2, NONE, NONE, 7, NONE, NONE}, // UP
+    {57, 3, NONE, NONE, 41, NONE, NONE}, // F14
+    {60, 6, NONE, NONE, 20, NONE, NONE}, // PAGEUP
+    {66, 3, 26, NONE, NONE, NONE, NONE}, // VAR
+    {69, 4, NONE, NONE, NONE, 17, NONE}, // MUTE
+    {73, 3, NONE, NONE, 46, NONE, NONE}, // F19
+    {76, 2, NONE, NONE, 32, NONE, NONE}, // F5
+    {78, 4, NONE, NONE, NONE, 15, NONE}, // STOP
+    {82, 6, NONE, NONE, 16, NONE, NONE}, // ESCAPE
+    {88, 2, NONE, NONE, NONE, 20, NONE}, // FN
+    {90, 2, NONE, NONE, 35, NONE, NONE}, // F8
+    {92, 10, NONE, NONE, NONE, NONE, 1}, // LEFT_CLICK
+    {102, 4, NONE, NONE, 1, NONE, NONE}, // DOWN
+    {106, 2, NONE, NONE, 34, NONE, NONE}, // F7
+    {108, 9, NONE, NONE, 2, NONE, NONE}, // LEFTARROW
+    {117, 2, NONE, NONE, 36, NONE, NONE}, // F9
+    {119, 3, NONE, NONE, 49, NONE, NONE}, // F22
+    {122, 21, 19, NONE, NONE, NONE, NONE}, // WAIT_FOR_BUTTON_PRESS
+    {143, 7, 14, NONE, NONE, NONE, NONE}, // ALTCHAR
+    {150, 7, 18, NONE, NONE, NONE, NONE}, // RELEASE
+    {157, 2, NONE, NONE, 28, NONE, NONE}, // F1
+    {159, 6, NONE, NONE, 12, NONE, NONE}, // DELETE
+    {165, 4, NONE, NONE, NONE, 6, NONE}, // BACK
+    {169, 4, NONE, NONE, 3, NONE, NONE}, // LEFT
+    {173, 5, NONE, NONE, 9, NONE, NONE}, // BREAK
+    {178, 8, NONE, NONE, 11, NONE, NONE}, // CAPSLOCK
+    {186, 3, NONE, NONE, 14, NONE, NONE}, // END
+    {189, 3, NONE, NONE, 27, NONE, NONE}, // APP
+    {192, 9, NONE, NONE, NONE, NONE, 0}, // LEFTCLICK
+    {201, 9, 15, NONE, NONE, NONE, NONE}, // ALTSTRING
+    {210, 3, NONE, NONE, 51, NONE, NONE}, // F24
+    {213, 5, NONE, NONE, 24, NONE, NONE}, // SPACE
+    {218, 3, NONE, NONE, 25, NONE, NONE}, // TAB
+    {221, 5, NONE, 2, NONE, NONE, NONE}, // SHIFT
+    {226, 2, NONE, NONE, 30, NONE, NONE}, // F3
+    {228, 7, NONE, NONE, 19, NONE, NONE}, // NUMLOCK
+    {235, 9, 28, NONE, NONE, NONE, NONE}, // END_WHILE
+    {244, 5, 20, NONE, NONE, NONE, NONE}, // MEDIA
+    {249, 9, NONE, NONE, NONE, 18, NONE}, // VOLUME_UP
+    {258, 5, NONE, NONE, NONE, 2, NONE}, // SLEEP
+    {263, 7, NONE, NONE, NONE, 8, NONE}, // REFRESH
+    {270, 9, NONE, NONE, 13, NONE, NONE}, // BACKSPACE
+    {279, 5, NONE, NONE, 10, 11, NONE}, // PAUSE
+    {284, 12, 33, NONE, NONE, NONE, NONE}, // END_FUNCTION
+    {296, 7, 16, NONE, NONE, NONE, NONE}, // ALTCODE
+    {303, 10, NONE, NONE, 23, NONE, NONE}, // SCROLLLOCK
+    {313, 8, NONE, NONE, NONE, 9, NONE}, // SNAPSHOT
+    {321, 3, NONE, NONE, 38, NONE, NONE}, // F11
+    {324, 2, 1, NONE, NONE, NONE, NONE}, // ID
+    {326, 12, NONE, NONE, NONE, NONE, 5}, // MIDDLE_CLICK
+    {338, 6, 34, NONE, NONE, NONE, NONE}, // RETURN
+    {344, 3, 0, NONE, NONE, NONE, NONE}, // REM
+    {347, 6, 3, NONE, NONE, NONE, NONE}, // STRING
+    {353, 10, NONE, NONE, NONE, NONE, 2}, // RIGHTCLICK
+    {363, 5, NONE, NONE, 8, NONE, NONE}, // ENTER
+    {368, 3, NONE, NONE, 47, NONE, NONE}, // F20
+    {371, 7, NONE, NONE, NONE, 7, NONE}, // FORWARD
+    {378, 8, 4, NONE, NONE, NONE, NONE}, // STRINGLN
+    {386, 3, NONE, NONE, 44, NONE, NONE}, // F17
+    {389, 11, NONE, NONE, NONE, NONE, 3}, // RIGHT_CLICK
+    {400, 10, 23, NONE, NONE, NONE, NONE}, // MOUSE_MOVE
+    {410, 6, 12, NONE, NONE, NONE, NONE}, // REPEAT
+    {416, 3, NONE, 4, NONE, NONE, NONE}, // GUI
+    {419, 11, NONE, NONE, NONE, 22, NONE}, // BRIGHT_DOWN
+    {430, 3, NONE, 3, NONE, NONE, NONE}, // ALT
+    {433, 10, NONE, NONE, NONE, 13, NONE}, // NEXT_TRACK
+    {443, 8, NONE, NONE, 21, NONE, NONE}, // PAGEDOWN
+    {451, 3, NONE, NONE, 43, NONE, NONE}, // F16
+    {454, 6, NONE, NONE, 18, NONE, NONE}, // INSERT
+    {460, 10, NONE, NONE, 4, NONE, NONE}, // RIGHTARROW
+    {470, 6, 31, NONE, NONE, NONE, NONE}, // END_IF
+    {476, 4, NONE, NONE, NONE, 10, NONE}, // PLAY
+    {480, 2, NONE, NONE, 31, NONE, NONE}, // F4
+    {482, 4, NONE, NONE, 26, NONE, NONE}, // MENU
+    {486, 5, 21, NONE, NONE, NONE, NONE}, // GLOBE
+    {491, 5, NONE, NONE, NONE, 0, NONE}, // POWER
+    {496, 3, NONE, NONE, 50, NONE, NONE}, // F23
+    {499, 3, NONE, NONE, 42, NONE, NONE}, // F15
+    {502, 2, NONE, NONE, 29, NONE, NONE}, // F2
+    {504, 4, NONE, 0, NONE, NONE, NONE}, // CTRL
+    {508, 10, NONE, NONE, NONE, 14, NONE}, // PREV_TRACK
+    {518, 11, 24, NONE, NONE, NONE, NONE}, // MOUSESCROLL
+    {529, 7, NONE, NONE, 6, NONE, NONE}, // UPARROW
+    {536, 3, NONE, NONE, 45, NONE, NONE}, // F18
+    {539, 12, 7, NONE, NONE, NONE, NONE}, // DEFAULTDELAY
+    {551, 11, NONE, NONE, 22, NONE, NONE}, // PRINTSCREEN
+    {562, 9, NONE, NONE, 0, NONE, NONE}, // DOWNARROW
+    {571, 4, 17, NONE, NONE, NONE, NONE}, // HOLD
+    {575, 4, NONE, NONE, NONE, 4, NONE}, // EXIT
+    {579, 3, NONE, NONE, 15, NONE, NONE}, // ESC
+    {582, 10, 5, NONE, NONE, NONE, NONE}, // STRINGFILE
+    {592, 6, NONE, NONE, NONE, 1, NONE}, // REBOOT
+    {598, 6, NONE, NONE, NONE, 3, NONE}, // LOGOFF
+    {604, 11, NONE, NONE, NONE, 19, NONE}, // VOLUME_DOWN
+    {615, 5, 27, NONE, NONE, NONE, NONE}, // WHILE
+    {620, 5, NONE, NONE, 5, NONE, NONE}, // RIGHT
+    {625, 4, 30, NONE, NONE, NONE, NONE}, // ELSE
+    {629, 10, NONE, NONE, NONE, NONE, 6}, // WHEELCLICK
+    {639, 13, 6, NONE, NONE, NONE, NONE}, // DEFAULT_DELAY
+    {652, 3, NONE, NONE, 48, NONE, NONE}, // F21
+    {655, 5, NONE, NONE, NONE, 16, NONE}, // EJECT
+    {660, 3, NONE, NONE, 37, NONE, NONE}, // F10
+    {663, 10, NONE, NONE, NONE, 12, NONE}, // PLAY_PAUSE
+    {673, 12, 25, NONE, NONE, NONE, NONE}, // MOUSE_SCROLL
+    {685, 9, 22, NONE, NONE, NONE, NONE}, // MOUSEMOVE
+    {694, 11, NONE, NONE, NONE, NONE, 4}, // MIDDLECLICK
+    {705, 11, 8, NONE, NONE, NONE, NONE}, // STRINGDELAY
+    {716, 5, 13, NONE, NONE, NONE, NONE}, // SYSRQ
+    {721, 3, NONE, NONE, 40, NONE, NONE}, // F13
+    {724, 4, NONE, NONE, 17, 5, NONE}, // HOME
+    {728, 8, 32, NONE, NONE, NONE, NONE}, // FUNCTION
+    {736, 2, 29, NONE, NONE, NONE, NONE}, // IF
+    {738, 7, NONE, 5, NONE, NONE, NONE}, // WINDOWS
+    {745, 9, NONE, NONE, NONE, 21, NONE}, // BRIGHT_UP
+    {754, 12, 9, NONE, NONE, NONE, NONE}, // STRING_DELAY
+    {766, 11, NONE, NONE, NONE, NONE, 7}, // WHEEL_CLICK
+};
+
+static uint32_t ducky_token_hash(const char* name, size_t len, uint32_t seed) {
+    uint32_t hash = 2166136261UL ^ seed;
+    for(size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619UL;
+    }
+    return hash ^ (hash >> 16);
+}
+
+const DuckyToken* ducky_get_token(const char* name, size_t len) {
+    if((len == 0) || (len > UINT8_MAX)) return NULL;
+
+    uint32_t bucket = ducky_token_hash(name, len, 0) % DUCKY_TOKEN_BUCKETS;
+    uint32_t slot =
+        ducky_token_hash(name, len, ducky_token_displacement[bucket]) % DUCKY_TOKEN_NB;
+    const DuckyToken* token = &ducky_tokens[slot];
+
+    if((token->name_len != len) ||
+       (memcmp(&ducky_token_pool[token->name_offset], name, len) != 0)) {
+        return NULL;
+    }
+    return token;
+}
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Generate ducky_script_tokens.c from the command and key name tables.
+
+The command table in ducky_script_commands.c and the key tables in
+ducky_script_keycodes.c stay the source of truth. This script packs every
+name into one string pool and builds a minimal perfect hash over it, so the
+interpreter resolves any token with a single probe. Run it after editing
+those tables.
+"""
+
+import os
+import re
+import sys
+
+HELPERS_DIR = os.path.dirname(os.path.abspath(__file__))
+OUTPUT_FILE = os.path.join(HELPERS_DIR, "ducky_script_tokens.c")
+
+TOKEN_NONE = 0xFF
+BUCKET_SIZE = 4
+
+# (source file, table name, DuckyToken field)
+TABLES = (
+    ("ducky_script_commands.c", "ducky_commands", "cmd"),
+    ("ducky_script_keycodes.c", "ducky_modifier_keys", "modifier_key"),
+    ("ducky_script_keycodes.c", "ducky_keys", "key"),
+    ("ducky_script_keycodes.c", "ducky_media_keys", "media_key"),
+    ("ducky_script_keycodes.c", "ducky_mouse_keys", "mouse_key"),
+)
+FIELDS = tuple(table[2] for table in TABLES)
+
+
+def read_table(file_name, table_name):
+    with open(os.path.join(HELPERS_DIR, file_name)) as f:
+        source = f.read()
+    match = re.search(r"\b%s\[\]\s*=\s*\{(.*?)\n\};" % table_name, source, re.S)
+    if not match:
+        sys.exit("Table %s not found in %s" % (table_name, file_name))
+    return re.findall(r'\{\s*"([^"]+)"', match.group(1))
+
+
+def token_hash(name, seed):
+    # FNV-1a with a seeded offset basis, must match ducky_token_hash()
+    value = (2166136261 ^ seed) & 0xFFFFFFFF
+    for char in name.encode():
+        value ^= char
+        value = (value * 16777619) & 0xFFFFFFFF
+    # Fold the high bits in, FNV low bits mix poorly under an even modulus
+    return value ^ (value >> 16)
+
+
+def build_hash(names):
+    token_nb = len(names)
+    bucket_nb = (token_nb + BUCKET_SIZE - 1) // BUCKET_SIZE
+    buckets = [[] for _ in range(bucket_nb)]
+    for name in names:
+        buckets[token_hash(name, 0) % bucket_nb].append(name)
+
+    displacements = [0] * bucket_nb
+    slots = [None] * token_nb
+    for bucket_id in sorted(range(bucket_nb), key=lambda i: -len(buckets[i])):
+        bucket = buckets[bucket_id]
+        if not bucket:
+            continue
+        seed = 1
+        while True:
+            bucket_slots = [token_hash(name, seed) % token_nb for name in bucket]
+            if len(set(bucket_slots)) == len(bucket) and all(
+                slots[slot] is None for slot in bucket_slots
+            ):
+                break
+            seed += 1
+            if seed > 0xFFFF:
+                sys.exit("Unable to build perfect hash")
+        displacements[bucket_id] = seed
+        for name, slot in zip(bucket, bucket_slots):
+            slots[slot] = name
+    return displacements, slots
+
+
+def main():
+    tokens = {}
+    for file_name, table_name, field in TABLES:
+        for index, name in enumerate(read_table(file_name, table_name)):
+            token = tokens.setdefault(name, dict.fromkeys(FIELDS, TOKEN_NONE))
+            if token[field] == TOKEN_NONE:
+                token[field] = index
+
+    displacements, slots = build_hash(sorted(tokens))
+
+    pool = ""
+    offsets = {}
+    for name in slots:
+        offsets[name] = len(pool)
+        pool += name
+
+    out = []
+    out.append("/* Generated by ducky_script_tokens.py, do not edit */")
+    out.append("/* Token fields: name offset, name length, index in %s, */" % ", ".join(
+        table[1] for table in TABLES[:2]))
+    out.append("/* %s */" % ", ".join(table[1] for table in TABLES[2:]))
+    out.append("")
+    out.append('#include "ducky_script_i.h"')
+    out.append("")
+    out.append("#define DUCKY_TOKEN_NB      %d" % len(slots))
+    out.append("#define DUCKY_TOKEN_BUCKETS %d" % len(displacements))
+    out.append("#define NONE                DUCKY_TOKEN_NONE")
+    out.append("")
+    out.append("static const uint16_t ducky_token_displacement[DUCKY_TOKEN_BUCKETS] = {")
+    for i in range(0, len(displacements), 12):
+        out.append("    " + " ".join("%d," % d for d in displacements[i : i + 12]))
+    out.append("};")
+    out.append("")
+    out.append("static const char ducky_token_pool[] =")
+    line = ""
+    for name in slots:
+        if len(line) + len(name) > 80:
+            out.append('    "%s"' % line)
+            line = ""
+        line += name
+    out.append('    "%s";' % line)
+    out.append("")
+    out.append("static const DuckyToken ducky_tokens[DUCKY_TOKEN_NB] = {")
+    for name in slots:
+        token = tokens[name]
+        fields = ", ".join(
+            "%d" % token[field] if token[field] != TOKEN_NONE else "NONE"
+            for field in FIELDS
+        )
+        out.append("    {%d, %d, %s}, // %s" % (offsets[name], len(name), fields, name))
+    out.append("};")
+    out.append("")
+    out.append("static uint32_t ducky_token_hash(const char* name, size_t len, uint32_t seed) {")
+    out.append("    uint32_t hash = 2166136261UL ^ seed;")
+    out.append("    for(size_t i = 0; i < len; i++) {")
+    out.append("        hash ^= (uint8_t)name[i];")
+    out.append("        hash *= 16777619UL;")
+    out.append("    }")
+    out.append("    return hash ^ (hash >> 16);")
+    out.append("}")
+    out.append("")
+    out.append("const DuckyToken* ducky_get_token(const char* name, size_t len) {")
+    out.append("    if((len == 0) || (len > UINT8_MAX)) return NULL;")
+    out.append("")
+    out.append("    uint32_t bucket = ducky_token_hash(name, len, 0) % DUCKY_TOKEN_BUCKETS;")
+    out.append("    uint32_t slot =")
+    out.append(
+        "        ducky_token_hash(name, len, ducky_token_displacement[bucket]) % DUCKY_TOKEN_NB;"
+    )
+    out.append("    const DuckyToken* token = &ducky_tokens[slot];")
+    out.append("")
+    out.append("    if((token->name_len != len) ||")
+    out.append("       (memcmp(&ducky_token_pool[token->name_offset], name, len) != 0)) {")
+    out.append("        return NULL;")
+    out.append("    }")
+    out.append("    return token;")
+    out.append("}")
+    out.append("")
+
+    with open(OUTPUT_FILE, "w") as f:
+        f.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
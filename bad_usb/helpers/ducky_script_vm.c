@@ -0,0 +1,533 @@
+#include <furi.h>
+#include <lib/toolbox/strint.h>
+#include "ducky_script.h"
+#include "ducky_script_i.h"
+
+#define TAG "BadUsb"
+
+#define WORKER_TAG TAG "Worker"
+
+#define DUCKY_VM_NAME_LEN    15
+#define DUCKY_VM_FUNC_NB     16
+#define DUCKY_VM_BLOCK_DEPTH 8
+
+typedef enum {
+    DuckyExprNone,
+    DuckyExprAdd,
+    DuckyExprSub,
+    DuckyExprMul,
+    DuckyExprDiv,
+    DuckyExprMod,
+    DuckyExprEq,
+    DuckyExprNe,
+    DuckyExprLt,
+    DuckyExprLe,
+    DuckyExprGt,
+    DuckyExprGe,
+    DuckyExprAnd,
+    DuckyExprOr,
+    DuckyExprBitAnd,
+    DuckyExprBitOr,
+} DuckyExprOp;
+
+typedef struct {
+    const char* name;
+    DuckyExprOp expr;
+} DuckyExprOperator;
+
+// Two character operators go first, so they are not taken for their one character prefix
+static const DuckyExprOperator ducky_expr_operators[] = {
+    {"==", DuckyExprEq},
+    {"!=", DuckyExprNe},
+    {"<=", DuckyExprLe},
+    {">=", DuckyExprGe},
+    {"&&", DuckyExprAnd},
+    {"||", DuckyExprOr},
+    {"<", DuckyExprLt},
+    {">", DuckyExprGt},
+    {"+", DuckyExprAdd},
+    {"-", DuckyExprSub},
+    {"*", DuckyExprMul},
+    {"/", DuckyExprDiv},
+    {"%", DuckyExprMod},
+    {"&", DuckyExprBitAnd},
+    {"|", DuckyExprBitOr},
+};
+
+typedef enum {
+    DuckyVmBlockWhile,
+    DuckyVmBlockIf,
+    DuckyVmBlockElse,
+    DuckyVmBlockFunction,
+} DuckyVmBlockType;
+
+typedef struct {
+    uint8_t type;
+    uint32_t start; // Address of the op opening the block
+    uint32_t patch; // Address of the op jumping past the block
+    size_t line;
+} DuckyVmBlock;
+
+typedef char DuckyVmName[DUCKY_VM_NAME_LEN + 1];
+
+struct DuckyVmCompiler {
+    uint32_t pc; // Address of the op being compiled
+    bool patch_pending; // Point the jump at patch_addr to the next op
+    uint32_t patch_addr;
+    bool func_pending; // Last declared function starts at the next op
+
+    DuckyVmName var_names[DUCKY_VM_VAR_NB];
+    uint8_t var_nb;
+    DuckyVmName func_names[DUCKY_VM_FUNC_NB];
+    uint32_t func_addr[DUCKY_VM_FUNC_NB];
+    uint8_t func_nb;
+    DuckyVmBlock blocks[DUCKY_VM_BLOCK_DEPTH];
+    uint8_t block_nb;
+};
+
+// Compiler state lives in the script arena, it is cleared when compilation begins
+size_t ducky_vm_compiler_get_size(void) {
+    return sizeof(DuckyVmCompiler);
+}
+
+bool ducky_vm_compiler_advance(BadUsbScript* bad_usb, uint32_t op_size) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+    bool state = true;
+
+    vm->pc += op_size;
+    if(vm->patch_pending) {
+        state = ducky_bytecode_patch_jump(bad_usb, vm->patch_addr, vm->pc);
+        vm->patch_pending = false;
+    }
+    if(vm->func_pending) {
+        vm->func_addr[vm->func_nb - 1] = vm->pc;
+        vm->func_pending = false;
+    }
+    return state;
+}
+
+int32_t ducky_vm_compiler_end(BadUsbScript* bad_usb) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+    if(vm->block_nb == 0) return 0;
+
+    bad_usb->st.error_line = vm->blocks[vm->block_nb - 1].line;
+    ducky_error(bad_usb, "Block is not closed");
+    FURI_LOG_E(WORKER_TAG, "Block is not closed at line %zu", bad_usb->st.error_line);
+    return SCRIPT_STATE_ERROR;
+}
+
+static const char* ducky_vm_skip_spaces(const char* str) {
+    while(*str == ' ') {
+        str++;
+    }
+    return str;
+}
+
+static size_t ducky_vm_get_name_len(const char* str) {
+    size_t len = 0;
+    while(((str[len] >= 'a') && (str[len] <= 'z')) || ((str[len] >= 'A') && (str[len] <= 'Z')) ||
+          ((str[len] >= '0') && (str[len] <= '9')) || (str[len] == '_')) {
+        len++;
+    }
+    return len;
+}
+
+static int32_t
+    ducky_vm_find_name(const DuckyVmName* names, uint8_t name_nb, const char* name, size_t len) {
+    for(uint8_t i = 0; i < name_nb; i++) {
+        if((strncmp(names[i], name, len) == 0) && (names[i][len] == '\0')) return i;
+    }
+    return -1;
+}
+
+static bool ducky_vm_parse_operand(
+    DuckyVmCompiler* vm,
+    const char** str,
+    int32_t* value,
+    bool* is_var) {
+    const char* param = ducky_vm_skip_spaces(*str);
+    *is_var = false;
+
+    if(*param == '$') {
+        param++;
+        size_t len = ducky_vm_get_name_len(param);
+        int32_t var = ducky_vm_find_name(vm->var_names, vm->var_nb, param, len);
+        if((len == 0) || (var < 0)) return false;
+        *value = var;
+        *is_var = true;
+        *str = &param[len];
+        return true;
+    }
+
+    size_t len = ducky_vm_get_name_len(param);
+    if((len == 4) && (strncmp(param, "TRUE", len) == 0)) {
+        *value = 1;
+        *str = &param[len];
+        return true;
+    } else if((len == 5) && (strncmp(param, "FALSE", len) == 0)) {
+        *value = 0;
+        *str = &param[len];
+        return true;
+    }
+
+    char* end = NULL;
+    if(strint_to_int32(param, &end, value, 10) != StrintParseNoError) return false;
+    *str = end;
+    return true;
+}
+
+// Expressions are a single operand or two operands joined by an operator, optionally in brackets
+static bool
+    ducky_vm_parse_expr(DuckyVmCompiler* vm, const char* str, const char* end, DuckyOp* op) {
+    str = ducky_vm_skip_spaces(str);
+    while((end > str) && (end[-1] == ' ')) {
+        end--;
+    }
+    if((*str == '(') && (end > str) && (end[-1] == ')')) {
+        str++;
+        end--;
+    }
+
+    bool is_var = false;
+    if(!ducky_vm_parse_operand(vm, &str, &op->arg[0], &is_var)) return false;
+    if(is_var) op->flags |= DuckyOpFlagArg0Var;
+
+    str = ducky_vm_skip_spaces(str);
+    op->expr = DuckyExprNone;
+    if(str >= end) return true;
+
+    for(size_t i = 0; i < COUNT_OF(ducky_expr_operators); i++) {
+        size_t len = strlen(ducky_expr_operators[i].name);
+        if(strncmp(str, ducky_expr_operators[i].name, len) == 0) {
+            op->expr = ducky_expr_operators[i].expr;
+            str += len;
+            break;
+        }
+    }
+    if(op->expr == DuckyExprNone) return false;
+
+    if(!ducky_vm_parse_operand(vm, &str, &op->arg[1], &is_var)) return false;
+    if(is_var) op->flags |= DuckyOpFlagArg1Var;
+
+    return (ducky_vm_skip_spaces(str) >= end);
+}
+
+static int32_t
+    ducky_vm_parse_assign(BadUsbScript* bad_usb, const char* line, DuckyOp* op, bool declare) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+    const char* name = &line[1];
+    size_t len = ducky_vm_get_name_len(name);
+    if((len == 0) || (len > DUCKY_VM_NAME_LEN)) {
+        return ducky_error(bad_usb, "Invalid variable %s", line);
+    }
+
+    int32_t var = ducky_vm_find_name(vm->var_names, vm->var_nb, name, len);
+    if((var < 0) && declare) {
+        if(vm->var_nb >= DUCKY_VM_VAR_NB) {
+            return ducky_error(bad_usb, "Too many variables");
+        }
+        var = vm->var_nb++;
+        strlcpy(vm->var_names[var], name, len + 1);
+    } else if(var < 0) {
+        return ducky_error(bad_usb, "Unknown variable %s", line);
+    }
+
+    const char* value = ducky_vm_skip_spaces(&name[len]);
+    if((value[0] != '=') || (value[1] == '=')) {
+        return ducky_error(bad_usb, "Invalid assignment %s", line);
+    }
+
+    op->type = DuckyOpSet;
+    op->var = var;
+    if(!ducky_vm_parse_expr(vm, &value[1], &value[strlen(value)], op)) {
+        return ducky_error(bad_usb, "Invalid expression %s", &value[1]);
+    }
+    return 0;
+}
+
+static bool ducky_vm_push_block(BadUsbScript* bad_usb, DuckyVmBlockType type) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+    if(vm->block_nb >= DUCKY_VM_BLOCK_DEPTH) return false;
+
+    DuckyVmBlock* block = &vm->blocks[vm->block_nb++];
+    block->type = type;
+    block->start = vm->pc;
+    block->patch = vm->pc;
+    block->line = bad_usb->st.line_cur;
+    return true;
+}
+
+static DuckyVmBlock* ducky_vm_get_block(DuckyVmCompiler* vm, DuckyVmBlockType type) {
+    if(vm->block_nb == 0) return NULL;
+
+    DuckyVmBlock* block = &vm->blocks[vm->block_nb - 1];
+    if((block->type == type) || ((type == DuckyVmBlockIf) && (block->type == DuckyVmBlockElse))) {
+        return block;
+    }
+    return NULL;
+}
+
+static int32_t ducky_vm_parse_function(BadUsbScript* bad_usb, const char* param, DuckyOp* op) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+    size_t len = ducky_vm_get_name_len(param);
+    if((len == 0) || (len > DUCKY_VM_NAME_LEN) || (strcmp(&param[len], "()") != 0)) {
+        return ducky_error(bad_usb, "Invalid function %s", param);
+    }
+    if(vm->block_nb > 0) {
+        return ducky_error(bad_usb, "Nested function %s", param);
+    }
+    if(ducky_vm_find_name(vm->func_names, vm->func_nb, param, len) >= 0) {
+        return ducky_error(bad_usb, "Function %s is already defined", param);
+    }
+    if(vm->func_nb >= DUCKY_VM_FUNC_NB) {
+        return ducky_error(bad_usb, "Too many functions");
+    }
+
+    strlcpy(vm->func_names[vm->func_nb], param, len + 1);
+    vm->func_nb++;
+    vm->func_pending = true;
+    ducky_vm_push_block(bad_usb, DuckyVmBlockFunction);
+    op->type = DuckyOpJump; // Skip the body, it only runs when called
+    return 0;
+}
+
+int32_t ducky_vm_parse_cmd(BadUsbScript* bad_usb, const char* line, DuckyOp* op, int32_t param) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+    if(vm == NULL) {
+        return ducky_error(bad_usb, "Blocks need a compiled script");
+    }
+
+    const char* args = ducky_vm_skip_spaces(&line[strcspn(line, " ")]);
+    const char* args_end = NULL;
+    DuckyVmBlock* block = NULL;
+
+    switch(param) {
+    case DuckyVmCmdVar:
+        if(args[0] != '$') {
+            return ducky_error(bad_usb, "Invalid variable %s", args);
+        }
+        return ducky_vm_parse_assign(bad_usb, args, op, true);
+    case DuckyVmCmdWhile:
+    case DuckyVmCmdIf:
+        if(!ducky_vm_push_block(
+               bad_usb, (param == DuckyVmCmdWhile) ? DuckyVmBlockWhile : DuckyVmBlockIf)) {
+            return ducky_error(bad_usb, "Too many nested blocks");
+        }
+        op->type = DuckyOpJumpIfNot;
+        args_end = &args[strlen(args)];
+        // THEN is optional after the condition
+        if(((args_end - args) > 5) && (strcmp(&args_end[-5], " THEN") == 0)) {
+            args_end -= 5;
+        }
+        if(!ducky_vm_parse_expr(vm, args, args_end, op)) {
+            return ducky_error(bad_usb, "Invalid condition %s", args);
+        }
+        return 0;
+    case DuckyVmCmdEndWhile:
+        block = ducky_vm_get_block(vm, DuckyVmBlockWhile);
+        if(block == NULL) break;
+        op->type = DuckyOpJump;
+        op->jump = block->start;
+        vm->patch_addr = block->patch;
+        vm->patch_pending = true;
+        vm->block_nb--;
+        return 0;
+    case DuckyVmCmdElse:
+        block = ducky_vm_get_block(vm, DuckyVmBlockIf);
+        if((block == NULL) || (block->type == DuckyVmBlockElse) || (args[0] != '\0')) break;
+        op->type = DuckyOpJump; // End of the IF branch, jumps past the ELSE branch
+        vm->patch_addr = block->patch;
+        vm->patch_pending = true;
+        block->type = DuckyVmBlockElse;
+        block->patch = vm->pc;
+        return 0;
+    case DuckyVmCmdEndIf:
+        block = ducky_vm_get_block(vm, DuckyVmBlockIf);
+        if(block == NULL) break;
+        // No op of its own, the branch jumps straight to the op after END_IF
+        vm->patch_addr = block->patch;
+        vm->patch_pending = true;
+        vm->block_nb--;
+        return SCRIPT_STATE_NEXT_LINE;
+    case DuckyVmCmdFunction:
+        return ducky_vm_parse_function(bad_usb, args, op);
+    case DuckyVmCmdEndFunction:
+        block = ducky_vm_get_block(vm, DuckyVmBlockFunction);
+        if(block == NULL) break;
+        op->type = DuckyOpReturn;
+        vm->patch_addr = block->patch;
+        vm->patch_pending = true;
+        vm->block_nb--;
+        return 0;
+    case DuckyVmCmdReturn:
+        if((vm->block_nb == 0) || (vm->blocks[0].type != DuckyVmBlockFunction)) break;
+        op->type = DuckyOpReturn;
+        return 0;
+    default:
+        break;
+    }
+
+    return ducky_error(bad_usb, "Unexpected %s", line);
+}
+
+int32_t ducky_vm_parse_line(BadUsbScript* bad_usb, const char* line, DuckyOp* op) {
+    DuckyVmCompiler* vm = bad_usb->vm_compiler;
+
+    if(line[0] == '$') {
+        if(vm == NULL) {
+            return ducky_error(bad_usb, "Variables need a compiled script");
+        }
+        return ducky_vm_parse_assign(bad_usb, line, op, false);
+    }
+
+    if(vm == NULL) return SCRIPT_STATE_CMD_UNKNOWN;
+
+    size_t len = ducky_vm_get_name_len(line);
+    if((len > 0) && (strcmp(&line[len], "()") == 0)) {
+        int32_t func = ducky_vm_find_name(vm->func_names, vm->func_nb, line, len);
+        if(func < 0) {
+            return ducky_error(bad_usb, "Unknown function %s", line);
+        }
+        op->type = DuckyOpCall;
+        op->jump = vm->func_addr[func];
+        return 0;
+    }
+
+    return SCRIPT_STATE_CMD_UNKNOWN;
+}
+
+bool ducky_vm_is_jump(const DuckyOp* op) {
+    return (op->type == DuckyOpJump) || (op->type == DuckyOpJumpIfNot) ||
+           (op->type == DuckyOpCall) || (op->type == DuckyOpReturn);
+}
+
+bool ducky_vm_needs_code(const DuckyOp* op) {
+    return ducky_vm_is_jump(op) || (op->type == DuckyOpSet) ||
+           (op->flags & (DuckyOpFlagArg0Var | DuckyOpFlagArg1Var));
+}
+
+void ducky_vm_reset(BadUsbScript* bad_usb) {
+    memset(bad_usb->vm_var, 0, sizeof(bad_usb->vm_var));
+    bad_usb->vm_call_depth = 0;
+}
+
+static bool ducky_vm_get_arg(BadUsbScript* bad_usb, const DuckyOp* op, uint8_t id, int32_t* val) {
+    if((op->flags & (id ? DuckyOpFlagArg1Var : DuckyOpFlagArg0Var)) == 0) {
+        *val = op->arg[id];
+        return true;
+    }
+    if((uint32_t)op->arg[id] >= DUCKY_VM_VAR_NB) return false;
+    *val = bad_usb->vm_var[op->arg[id]];
+    return true;
+}
+
+static int32_t ducky_vm_eval(BadUsbScript* bad_usb, const DuckyOp* op, int32_t* result) {
+    int32_t a = 0;
+    int32_t b = 0;
+    if(!ducky_vm_get_arg(bad_usb, op, 0, &a) || !ducky_vm_get_arg(bad_usb, op, 1, &b)) {
+        return ducky_error(bad_usb, "Invalid variable");
+    }
+
+    // Arithmetic wraps around like the 32-bit registers it runs on
+    switch(op->expr) {
+    case DuckyExprNone:
+        *result = a;
+        break;
+    case DuckyExprAdd:
+        *result = (int32_t)((uint32_t)a + (uint32_t)b);
+        break;
+    case DuckyExprSub:
+        *result = (int32_t)((uint32_t)a - (uint32_t)b);
+        break;
+    case DuckyExprMul:
+        *result = (int32_t)((uint32_t)a * (uint32_t)b);
+        break;
+    case DuckyExprDiv:
+    case DuckyExprMod:
+        if(b == 0) {
+            return ducky_error(bad_usb, "Division by zero");
+        } else if(b == -1) {
+            *result = (op->expr == DuckyExprDiv) ? (int32_t)(0U - (uint32_t)a) : 0;
+        } else {
+            *result = (op->expr == DuckyExprDiv) ? (a / b) : (a % b);
+        }
+        break;
+    case DuckyExprEq:
+        *result = (a == b);
+        break;
+    case DuckyExprNe:
+        *result = (a != b);
+        break;
+    case DuckyExprLt:
+        *result = (a < b);
+        break;
+    case DuckyExprLe:
+        *result = (a <= b);
+        break;
+    case DuckyExprGt:
+        *result = (a > b);
+        break;
+    case DuckyExprGe:
+        *result = (a >= b);
+        break;
+    case DuckyExprAnd:
+        *result = (a && b);
+        break;
+    case DuckyExprOr:
+        *result = (a || b);
+        break;
+    case DuckyExprBitAnd:
+        *result = (a & b);
+        break;
+    case DuckyExprBitOr:
+        *result = (a | b);
+        break;
+    default:
+        return ducky_error(bad_usb, "Unknown operator %u", op->expr);
+    }
+    return 0;
+}
+
+int32_t ducky_vm_execute_op(BadUsbScript* bad_usb, const DuckyOp* op) {
+    int32_t value = 0;
+    int32_t state = 0;
+
+    switch(op->type) {
+    case DuckyOpSet:
+        if(op->var >= DUCKY_VM_VAR_NB) {
+            return ducky_error(bad_usb, "Invalid variable");
+        }
+        state = ducky_vm_eval(bad_usb, op, &value);
+        if(state != 0) return state;
+        bad_usb->vm_var[op->var] = value;
+        break;
+    case DuckyOpJump:
+        ducky_bytecode_jump(bad_usb, op->jump);
+        break;
+    case DuckyOpJumpIfNot:
+        state = ducky_vm_eval(bad_usb, op, &value);
+        if(state != 0) return state;
+        if(value == 0) {
+            ducky_bytecode_jump(bad_usb, op->jump);
+        }
+        break;
+    case DuckyOpCall:
+        if(bad_usb->vm_call_depth >= DUCKY_VM_CALL_DEPTH) {
+            return ducky_error(bad_usb, "Too many nested calls");
+        }
+        bad_usb->vm_call_stack[bad_usb->vm_call_depth++] = bad_usb->code_pc;
+        ducky_bytecode_jump(bad_usb, op->jump);
+        break;
+    case DuckyOpReturn:
+        if(bad_usb->vm_call_depth == 0) {
+            return ducky_error(bad_usb, "Return outside of a function");
+        }
+        ducky_bytecode_jump(bad_usb, bad_usb->vm_call_stack[--bad_usb->vm_call_depth]);
+        break;
+    default:
+        return ducky_error(bad_usb, "Unknown opcode %u", op->type);
+    }
+
+    // Control flow takes no time, DEFAULT_DELAY only applies to lines doing HID output
+    return SCRIPT_STATE_NEXT_LINE;
+}
@@ -9,6 +9,7 @@ void bad_usb_scene_unpair_done_on_enter(void* context) {
     BadUsbApp* bad_usb = context;
     Popup* popup = bad_usb->popup;
 
+    bad_usb_hid_session_stop(bad_usb->hid_session); // BLE HID profile is restored to default
     bad_usb_hid_ble_remove_pairing();
 
     popup_set_icon(popup, 48, 4, &I_DolphinDone_80x58);
@@ -37,7 +37,10 @@ bool bad_usb_scene_work_on_event(void* context, SceneManagerEvent event) {
                     app->interface == BadUsbHidInterfaceBle ? BadUsbHidInterfaceUsb :
                                                               BadUsbHidInterfaceBle);
                 bad_usb_script_close(app->bad_usb_script);
-                app->bad_usb_script = bad_usb_script_open(app->file_path, app->interface);
+                app->bad_usb_script =
+                    bad_usb_script_open(app->file_path, app->interface, app->hid_session);
+                bad_usb_script_set_profiling(
+                    app->bad_usb_script, furi_hal_rtc_is_flag_set(FuriHalRtcFlagDebug));
             } else {
                 bad_usb_script_pause_resume(app->bad_usb_script);
             }
@@ -54,8 +57,10 @@ void bad_usb_scene_work_on_enter(void* context) {
 
     bad_usb_view_set_interface(app->bad_usb_view, app->interface);
 
-    app->bad_usb_script = bad_usb_script_open(app->file_path, app->interface);
+    app->bad_usb_script = bad_usb_script_open(app->file_path, app->interface, app->hid_session);
     bad_usb_script_set_keyboard_layout(app->bad_usb_script, app->keyboard_layout);
+    bad_usb_script_set_profiling(
+        app->bad_usb_script, furi_hal_rtc_is_flag_set(FuriHalRtcFlagDebug));
 
     FuriString* file_name;
     file_name = furi_string_alloc();
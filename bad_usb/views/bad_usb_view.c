@@ -21,6 +21,11 @@ typedef struct {
     BadUsbHidInterface interface;
 } BadUsbModel;
 
+static size_t bad_usb_get_progress(const BadUsbState* state) {
+    if(state->byte_nb == 0) return 0;
+    return (size_t)(((uint64_t)state->byte_cur * 100) / state->byte_nb);
+}
+
 static void bad_usb_draw_callback(Canvas* canvas, void* _model) {
     BadUsbModel* model = _model;
 
@@ -93,7 +98,9 @@ static void bad_usb_draw_callback(Canvas* canvas, void* _model) {
         canvas_set_font(canvas, FontPrimary);
         canvas_draw_str_aligned(canvas, 127, 33, AlignRight, AlignBottom, "ERROR:");
         canvas_set_font(canvas, FontSecondary);
-        furi_string_printf(disp_str, "line %zu", model->state.error_line);
+        furi_string_printf(
+            disp_str, "line %zu: %s", model->state.error_line, model->state.error_text);
+        elements_string_fit_width(canvas, disp_str, canvas_width(canvas));
         canvas_draw_str_aligned(
             canvas, 127, 46, AlignRight, AlignBottom, furi_string_get_cstr(disp_str));
         furi_string_reset(disp_str);
@@ -115,8 +122,7 @@ static void bad_usb_draw_callback(Canvas* canvas, void* _model) {
             canvas_draw_icon(canvas, 4, 23, &I_EviSmile2_18x21);
         }
         canvas_set_font(canvas, FontBigNumbers);
-        furi_string_printf(
-            disp_str, "%zu", ((model->state.line_cur - 1) * 100) / model->state.line_nb);
+        furi_string_printf(disp_str, "%zu", bad_usb_get_progress(&model->state));
         canvas_draw_str_aligned(
             canvas, 114, 40, AlignRight, AlignBottom, furi_string_get_cstr(disp_str));
         furi_string_reset(disp_str);
@@ -134,8 +140,7 @@ static void bad_usb_draw_callback(Canvas* canvas, void* _model) {
             canvas_draw_icon(canvas, 4, 23, &I_EviWaiting2_18x21);
         }
         canvas_set_font(canvas, FontBigNumbers);
-        furi_string_printf(
-            disp_str, "%zu", ((model->state.line_cur - 1) * 100) / model->state.line_nb);
+        furi_string_printf(disp_str, "%zu", bad_usb_get_progress(&model->state));
         canvas_draw_str_aligned(
             canvas, 114, 40, AlignRight, AlignBottom, furi_string_get_cstr(disp_str));
         furi_string_reset(disp_str);
@@ -152,8 +157,7 @@ static void bad_usb_draw_callback(Canvas* canvas, void* _model) {
             canvas_draw_icon(canvas, 4, 23, &I_EviWaiting2_18x21);
         }
         canvas_set_font(canvas, FontBigNumbers);
-        furi_string_printf(
-            disp_str, "%zu", ((model->state.line_cur - 1) * 100) / model->state.line_nb);
+        furi_string_printf(disp_str, "%zu", bad_usb_get_progress(&model->state));
         canvas_draw_str_aligned(
             canvas, 114, 40, AlignRight, AlignBottom, furi_string_get_cstr(disp_str));
         furi_string_reset(disp_str);
@@ -6,21 +6,48 @@
 #define TAG "BadUsb2Worker"
 
 #include <furi_hal_resources.h>
+#include <stm32wbxx_ll_spi.h>
 
 // --- SPI Configuration ---
 #define SPI_HANDLE &furi_hal_spi_bus_handle_external
 #define SPI_CS_PIN &gpio_ext_pa4
 #define SPI_TIMEOUT 100
+#define SPI_DMA_MIN 16 // Shorter transfers don't pay for the DMA setup
+
+// Link training
+#define LINK_TRAIN_ROUNDS  4 // Patterns that must come back intact at a speed
+#define LINK_TRAIN_TIMEOUT 50 // ms for the echo of one pattern
+#define LINK_ERROR_BURST   3 // Bad frames in a row before the clock steps down
+#define LINK_STEP_UP_PERIOD 10000 // ms without a bad frame before the next speed is tried again
+#define LINK_MSC_IDLE 2000 // ms without MSC frames before training may hold up the bus
+#define LINK_STATS_PERIOD 30000 // ms between link counter logs, when they changed
+
+// Give up on a STRING ack after this, the RP2040 types a key in two USB polls
+#define STRING_ACK_TIMEOUT 500
+#define STRING_KEY_TIMEOUT 10 // ms per key
 
 // GPIO for Handshake (Assuming PC3 for now)
 #define GPIO_HANDSHAKE &gpio_ext_pc3
 
+// SPI1 runs from the 64 MHz APB2 clock. The RP2040 slave can't follow more than clk_peri / 12.
+typedef struct {
+    uint32_t prescaler;
+    uint32_t khz;
+} SpiLinkSpeed;
+
+static const SpiLinkSpeed spi_link_speeds[] = {
+    {LL_SPI_BAUDRATEPRESCALER_DIV32, 2000}, // External bus default
+    {LL_SPI_BAUDRATEPRESCALER_DIV16, 4000},
+    {LL_SPI_BAUDRATEPRESCALER_DIV8, 8000},
+};
+
 // Events
 typedef enum {
     WorkerEvtStop = (1 << 0),
     WorkerEvtStart = (1 << 1),
     WorkerEvtPauseResume = (1 << 2),
     WorkerEvtSpiIrq = (1 << 3), // Triggered by GPIO
+    WorkerEvtEnd = (1 << 4),
 } WorkerEvents;
 
 typedef struct BadUsb2Worker BadUsb2Worker;
@@ -46,8 +73,54 @@ struct BadUsb2Worker {
     uint32_t defdelay;
     uint32_t stringdelay;
     uint32_t repeat_cnt;
+    uint16_t layout[128]; // ASCII to keycode, modifiers in the high byte
+
+    // SPI Link
+    BadUsb2Frame frame; // Kept off the thread stack, MSC frames hold several sectors
+    uint8_t tx_seq;
+    uint8_t rp_seq_next; // Next RP2040 request, what a NAK asks for when its frame is lost
+    uint8_t link_speed; // Index in spi_link_speeds
+    uint8_t link_error_run;
+    bool link_trained; // A speed passed training, else the next handshake trains again
+    uint32_t link_clean_start; // Tick of the last bad frame or training
+    uint32_t msc_last; // Tick of the last MSC request
+    BadUsb2LinkStats link_stats;
+    BadUsb2LinkStats link_stats_logged;
+    BadUsb2LinkStats rp_stats_logged;
+    uint32_t link_stats_last; // Tick of the last counter log
+
+    // MSC read responses, one goes out while the other holds the next sectors
+    BadUsb2Frame msc_frame[2];
+    uint8_t msc_cur;
+    bool msc_ahead_valid;
+    uint32_t msc_ahead_lba;
+    uint16_t msc_ahead_nb;
+
+    // STRING typed by the RP2040
+    size_t string_pos; // Next char of the line to send, 0 when no STRING is in progress
+    size_t string_chunk_pos; // Start of the chunk in flight, sent again on a NAK
+    bool string_pending; // Waiting for the ack of string_seq
+    uint8_t string_seq;
+    uint8_t string_retry; // Times the chunk in flight was sent again after an ack timeout
+    uint32_t string_start;
+    uint32_t string_timeout;
+
+    // Stop tells the RP2040 to drop the chunk it is typing, sent again until it acks
+    bool cancel_pending;
+    uint8_t cancel_seq;
+    uint8_t cancel_retry;
+    uint32_t cancel_start;
+
+    // DELAY runs out while the main loop goes on serving the RP2040 and Stop
+    uint32_t delay_start;
+    uint32_t delay_len;
 };
 
+// A script is in progress, typing or waiting out a DELAY
+static bool worker_is_running(const BadUsbState* st) {
+    return st->state == BadUsbStateRunning || st->state == BadUsbStateDelay;
+}
+
 // --- IRQ Handler ---
 static void worker_gpio_callback(void* context) {
     FuriThreadId thread_id = (FuriThreadId)context;
@@ -56,96 +129,570 @@ static void worker_gpio_callback(void* context) {
 
 // --- SPI Operations ---
 
-static void handle_spi_transaction(BadUsb2Worker* worker) {
-    SpiPacket req;
-    SpiPacket resp;
-    
+// Bus hook restores the 2 MHz preset on every acquire, the trained clock is set on top
+static void spi_acquire(BadUsb2Worker* worker) {
     furi_hal_spi_acquire(SPI_HANDLE);
-    
-    // 1. Read Request
+    SPI_TypeDef* spi = (SPI_HANDLE)->bus->spi;
+    LL_SPI_Disable(spi);
+    LL_SPI_SetBaudRatePrescaler(spi, spi_link_speeds[worker->link_speed].prescaler);
+    LL_SPI_Enable(spi);
+}
+
+// Payloads go by DMA, the thread sleeps until the transfer is done
+static void spi_bus_rx(uint8_t* buffer, size_t size) {
+    if (size < SPI_DMA_MIN) {
+        furi_hal_spi_bus_rx(SPI_HANDLE, buffer, size, SPI_TIMEOUT);
+    } else {
+        furi_hal_spi_bus_trx_dma(SPI_HANDLE, NULL, buffer, size, SPI_TIMEOUT);
+    }
+}
+
+static void spi_bus_tx(uint8_t* buffer, size_t size) {
+    if (size < SPI_DMA_MIN) {
+        furi_hal_spi_bus_tx(SPI_HANDLE, buffer, size, SPI_TIMEOUT);
+    } else {
+        furi_hal_spi_bus_trx_dma(SPI_HANDLE, buffer, NULL, size, SPI_TIMEOUT);
+    }
+}
+
+// Reads a header, then only as many payload bytes as it announces and the CRC behind them
+static bool spi_receive_frame(BadUsb2Worker* worker, BadUsb2Frame* frame) {
+    bool valid = false;
+
+    // Rx clocks out what the buffer holds. The RP2040 takes a header it sees for a request of ours
+    // that crossed its frame, so the previous one must not go out again.
+    memset(&frame->header, 0, sizeof(BadUsb2FrameHeader));
     furi_hal_gpio_write(SPI_CS_PIN, false);
-    furi_hal_spi_bus_rx(SPI_HANDLE, (uint8_t*)&req, sizeof(SpiPacket), SPI_TIMEOUT);
+    furi_hal_spi_bus_rx(SPI_HANDLE, (uint8_t*)&frame->header, sizeof(BadUsb2FrameHeader), SPI_TIMEOUT);
+    if (badusb2_frame_header_is_valid(&frame->header)) {
+        spi_bus_rx(frame->payload, frame->header.length + BADUSB2_CRC_SIZE);
+        valid = true;
+    }
     furi_hal_gpio_write(SPI_CS_PIN, true);
-    
-    if (req.magic != BADUSB2_PROTOCOL_MAGIC) {
+
+    // No CRC unit arbitration in the firmware, the nibble table keeps up with the bus
+    if (!valid) {
+        worker->link_stats.frame_error_nb++;
+    } else if (badusb2_frame_crc(frame) != badusb2_frame_get_crc(frame)) {
+        worker->link_stats.crc_error_nb++;
+        valid = false;
+    }
+
+    return valid;
+}
+
+// Payload is already in place, header, payload and CRC go out in one transfer
+static void spi_send_frame(
+    BadUsb2Frame* frame,
+    uint8_t type,
+    uint8_t flags,
+    uint8_t seq,
+    uint16_t length) {
+    badusb2_frame_header_init(&frame->header, type, flags, seq, length);
+    badusb2_frame_set_crc(frame, badusb2_frame_crc(frame));
+
+    furi_hal_gpio_write(SPI_CS_PIN, false);
+    spi_bus_tx((uint8_t*)frame, badusb2_frame_size(length));
+    furi_hal_gpio_write(SPI_CS_PIN, true);
+}
+
+// Frame still holds what was sent, CRC included
+static void spi_resend_frame(BadUsb2Worker* worker, BadUsb2Frame* frame) {
+    worker->link_stats.retransmit_nb++;
+
+    furi_hal_gpio_write(SPI_CS_PIN, false);
+    spi_bus_tx((uint8_t*)frame, badusb2_frame_size(frame->header.length));
+    furi_hal_gpio_write(SPI_CS_PIN, true);
+}
+
+static void spi_send_nak(BadUsb2Worker* worker, uint8_t seq, uint8_t flags) {
+    worker->link_stats.nak_sent_nb++;
+    spi_send_frame(&worker->frame, CMD_LINK_NAK, flags, seq, 0);
+}
+
+// Sectors land straight in the frame that goes out by DMA
+static void msc_read_sectors(
+    BadUsb2Worker* worker,
+    uint8_t* buffer,
+    uint32_t lba,
+    uint16_t sector_nb) {
+    size_t len = sector_nb * BADUSB2_SECTOR_SIZE;
+    size_t read_len = 0;
+    if (worker->iso_file && storage_file_is_open(worker->iso_file)) {
+        storage_file_seek(worker->iso_file, lba * BADUSB2_SECTOR_SIZE, true);
+        read_len = storage_file_read(worker->iso_file, buffer, len);
+    }
+    memset(buffer + read_len, 0, len - read_len);
+}
+
+static void link_stats_log(const char* side, const BadUsb2LinkStats* stats) {
+    FURI_LOG_I(
+        TAG,
+        "%s link: %lu CRC errors, %lu frame errors, %lu NAKs sent, %lu received, %lu retransmits, "
+        "%lu timeouts",
+        side,
+        stats->crc_error_nb,
+        stats->frame_error_nb,
+        stats->nak_sent_nb,
+        stats->nak_received_nb,
+        stats->retransmit_nb,
+        stats->timeout_nb);
+}
+
+// Wiring that passed training can still degrade, a burst of bad frames steps the clock down
+static void link_error(BadUsb2Worker* worker) {
+    worker->link_clean_start = furi_get_tick();
+    if (++worker->link_error_run < LINK_ERROR_BURST) return;
+
+    worker->link_error_run = 0;
+    if (worker->link_speed > 0) {
+        worker->link_speed--;
+        FURI_LOG_W(TAG, "Link errors, down to %lu kHz", spi_link_speeds[worker->link_speed].khz);
+    }
+}
+
+static void link_train_pattern(uint8_t* buffer, uint8_t round) {
+    uint8_t lfsr = 0xA5;
+    for (size_t i = 0; i < BADUSB2_TRAIN_LEN; i++) {
+        if (round == 0) {
+            buffer[i] = (i & 1) ? 0xAA : 0x55; // Every bit toggles
+        } else if (round == 1) {
+            buffer[i] = (i & 1) ? 0xFF : 0x00; // Long runs
+        } else if (round == 2) {
+            buffer[i] = 1 << (i % 8); // Walking one
+        } else {
+            lfsr = (lfsr >> 1) ^ ((lfsr & 1) ? 0xB8 : 0); // Pseudo random
+            buffer[i] = lfsr;
+        }
+    }
+}
+
+static void handle_spi_frame(BadUsb2Worker* worker);
+static void spi_service_pending(BadUsb2Worker* worker);
+static void send_hid_cancel(BadUsb2Worker* worker);
+
+// Waits for the echo of the pattern with this seq. Requests the RP2040 sends meanwhile are
+// served as usual, an MSC read must not go unanswered because training took its frame.
+static bool link_train_echo(BadUsb2Worker* worker, uint8_t seq, const uint8_t* pattern) {
+    BadUsb2Frame* frame = &worker->frame;
+    uint32_t start = furi_get_tick();
+
+    while (true) {
+        uint32_t elapsed = furi_get_tick() - start;
+        if (elapsed >= LINK_TRAIN_TIMEOUT) return false;
+        if (!furi_hal_gpio_read(GPIO_HANDSHAKE)) {
+            uint32_t timeout = LINK_TRAIN_TIMEOUT - elapsed;
+            furi_thread_flags_wait(WorkerEvtSpiIrq, FuriFlagWaitAny, timeout);
+            continue;
+        }
+
+        spi_acquire(worker);
+        if (!spi_receive_frame(worker, frame)) {
+            // Bad at this clock, the RP2040 sends it again once the clock is back down
+            spi_send_nak(worker, worker->rp_seq_next, 0);
+            furi_hal_spi_release(SPI_HANDLE);
+            return false;
+        }
+        bool response = frame->header.flags & BADUSB2_FLAG_RESPONSE;
+        if (frame->header.type == CMD_LINK_TRAIN && response) {
+            furi_hal_spi_release(SPI_HANDLE);
+            return frame->header.seq == seq && frame->header.length == BADUSB2_TRAIN_LEN &&
+                   memcmp(frame->payload, pattern, BADUSB2_TRAIN_LEN) == 0;
+        }
+        if (frame->header.type == CMD_LINK_NAK && !response && frame->header.seq == seq) {
+            worker->link_stats.nak_received_nb++; // Pattern came in corrupt
+            furi_hal_spi_release(SPI_HANDLE);
+            return false;
+        }
+        handle_spi_frame(worker);
+    }
+}
+
+// Sends every pattern at the current speed and checks what the RP2040 echoes back
+static bool link_train_speed(BadUsb2Worker* worker) {
+    BadUsb2Frame* frame = &worker->frame;
+    uint8_t pattern[BADUSB2_TRAIN_LEN];
+
+    for (uint8_t round = 0; round < LINK_TRAIN_ROUNDS; round++) {
+        spi_service_pending(worker);
+
+        uint8_t seq = worker->tx_seq++;
+        link_train_pattern(pattern, round);
+        memcpy(frame->payload, pattern, BADUSB2_TRAIN_LEN);
+
+        spi_acquire(worker);
+        spi_send_frame(frame, CMD_LINK_TRAIN, 0, seq, BADUSB2_TRAIN_LEN);
         furi_hal_spi_release(SPI_HANDLE);
+
+        if (!link_train_echo(worker, seq, pattern)) return false;
+    }
+
+    return true;
+}
+
+// Steps the clock up while the link stays clean, and keeps the last speed that passed
+static void link_train(BadUsb2Worker* worker) {
+    uint8_t speed_nb = 0;
+    for (uint8_t speed = 0; speed < COUNT_OF(spi_link_speeds); speed++) {
+        worker->link_speed = speed;
+        if (!link_train_speed(worker)) break;
+        speed_nb++;
+    }
+    worker->link_speed = (speed_nb > 0) ? (speed_nb - 1) : 0;
+    worker->link_error_run = 0;
+    worker->link_trained = (speed_nb > 0);
+    worker->link_clean_start = furi_get_tick();
+    if (speed_nb > 0) {
+        FURI_LOG_I(TAG, "Link trained at %lu kHz", spi_link_speeds[worker->link_speed].khz);
+    } else {
+        FURI_LOG_W(TAG, "Link training failed, staying at %lu kHz", spi_link_speeds[0].khz);
+    }
+}
+
+static void handle_spi_transaction(BadUsb2Worker* worker);
+
+// A frame the RP2040 queued would go out on our clock while we send and both would be lost,
+// so a raised handshake is served first. It stays up until the frame is read, the IRQ flag
+// only wakes the thread and may be left over from a frame that was read already.
+static void spi_service_pending(BadUsb2Worker* worker) {
+    if (furi_hal_gpio_read(GPIO_HANDSHAKE)) {
+        handle_spi_transaction(worker);
+    }
+}
+
+// Training runs once at start, a speed it missed on a transient error is tried again after a
+// clean run. Only between STRING chunks, an ack would be taken for a wrong echo, and not while
+// the host uses the disk, whose requests would wait behind the patterns.
+static void link_step_up(BadUsb2Worker* worker) {
+    uint32_t now = furi_get_tick();
+    if (!worker->link_trained || worker->string_pending ||
+        (size_t)worker->link_speed + 1 >= COUNT_OF(spi_link_speeds) ||
+        now - worker->link_clean_start < LINK_STEP_UP_PERIOD ||
+        now - worker->msc_last < LINK_MSC_IDLE) {
         return;
     }
-    
-    // 2. Process
-    memset(&resp, 0, sizeof(SpiPacket));
-    resp.magic = BADUSB2_PROTOCOL_MAGIC;
-    
-    if (req.type == CMD_MSC_READ) {
-        resp.type = CMD_MSC_READ;
-        if (worker->iso_file && storage_file_is_open(worker->iso_file)) {
-             storage_file_seek(worker->iso_file, req.address * 512, true);
-             storage_file_read(worker->iso_file, resp.data, 512);
+
+    uint8_t speed = worker->link_speed;
+    worker->link_speed = speed + 1;
+    if (link_train_speed(worker)) {
+        FURI_LOG_I(TAG, "Link up to %lu kHz", spi_link_speeds[worker->link_speed].khz);
+    } else {
+        worker->link_speed = speed;
+    }
+    worker->link_clean_start = furi_get_tick();
+}
+
+// Ships the chunk of the STRING line at string_chunk_pos, the RP2040 acks once it has typed all of it
+static void send_hid_string_chunk(BadUsb2Worker* worker) {
+    spi_service_pending(worker); // First, a request is read into the frame the keys go in
+
+    const char* str = furi_string_get_cstr(worker->line) + worker->string_chunk_pos;
+    BadUsb2HidKey* keys = (BadUsb2HidKey*)worker->frame.payload;
+    uint16_t key_nb = 0;
+    size_t char_nb = 0;
+
+    // The RP2040 sends keycodes as they are, so chars go through the layout here
+    for (; str[char_nb] != '\0' && key_nb < BADUSB2_STRING_KEY_MAX; char_nb++) {
+        uint8_t chr = (uint8_t)str[char_nb];
+        uint16_t key = (chr < COUNT_OF(worker->layout)) ? worker->layout[chr] : HID_KEYBOARD_NONE;
+        if ((key & 0xFF) == HID_KEYBOARD_NONE) continue; // Not on this layout
+        keys[key_nb].modifier = key >> 8;
+        keys[key_nb].keycode = key & 0xFF;
+        key_nb++;
+    }
+    worker->string_pos = worker->string_chunk_pos + char_nb;
+    if (key_nb == 0) return; // Nothing to type, the RP2040 would have nothing to ack
+    worker->string_pending = true;
+    worker->string_start = furi_get_tick();
+    worker->string_timeout = STRING_ACK_TIMEOUT + key_nb * STRING_KEY_TIMEOUT;
+
+    spi_acquire(worker);
+    spi_send_frame(
+        &worker->frame, CMD_HID_STRING, 0, worker->string_seq, key_nb * sizeof(BadUsb2HidKey));
+    furi_hal_spi_release(SPI_HANDLE);
+}
+
+static void send_hid_string(BadUsb2Worker* worker) {
+    worker->string_chunk_pos = worker->string_pos;
+    worker->string_seq = worker->tx_seq++;
+    worker->string_retry = 0;
+    send_hid_string_chunk(worker);
+}
+
+// Serves the frame just read into worker->frame, the bus is still held and gets released
+static void handle_spi_frame(BadUsb2Worker* worker) {
+    BadUsb2Frame* frame = &worker->frame;
+
+    if (!(frame->header.flags & BADUSB2_FLAG_RESPONSE) && frame->header.type != CMD_LINK_NAK) {
+        worker->rp_seq_next = frame->header.seq + 1;
+    }
+
+    BadUsb2MscRequest req = {0};
+    uint8_t type = frame->header.type;
+    uint8_t seq = frame->header.seq;
+    if (frame->header.length >= sizeof(BadUsb2MscRequest)) {
+        memcpy(&req, frame->payload, sizeof(BadUsb2MscRequest));
+    }
+    bool file_ok = worker->iso_file && storage_file_is_open(worker->iso_file);
+    if (type == CMD_MSC_READ || type == CMD_MSC_WRITE) {
+        worker->msc_last = furi_get_tick();
+    }
+
+    if (type == CMD_MSC_READ) {
+        if (req.sector_nb == 0 || req.sector_nb > BADUSB2_SECTOR_MAX) {
+            uint8_t flags = BADUSB2_FLAG_RESPONSE | BADUSB2_FLAG_ERROR;
+            spi_send_frame(frame, CMD_MSC_READ, flags, seq, 0);
+            furi_hal_spi_release(SPI_HANDLE);
+            return;
+        }
+
+        // Hosts read sequentially, so the sectors are often already in the other buffer
+        uint8_t ahead = worker->msc_cur ^ 1;
+        if (worker->msc_ahead_valid && worker->msc_ahead_lba == req.lba &&
+            worker->msc_ahead_nb == req.sector_nb) {
+            worker->msc_cur = ahead;
         } else {
-             memset(resp.data, 0, 512);
+            msc_read_sectors(
+                worker, worker->msc_frame[worker->msc_cur].payload, req.lba, req.sector_nb);
         }
-        
+
         furi_delay_us(50);
-        
-        furi_hal_gpio_write(SPI_CS_PIN, false);
-        furi_hal_spi_bus_tx(SPI_HANDLE, (uint8_t*)&resp, sizeof(SpiPacket), SPI_TIMEOUT);
-        furi_hal_gpio_write(SPI_CS_PIN, true);
-        
-    } else if (req.type == CMD_MSC_WRITE) {
-         if (worker->iso_file && storage_file_is_open(worker->iso_file)) {
-             storage_file_seek(worker->iso_file, req.address * 512, true);
-             storage_file_write(worker->iso_file, req.data, 512);
+
+        spi_send_frame(
+            &worker->msc_frame[worker->msc_cur],
+            CMD_MSC_READ,
+            BADUSB2_FLAG_RESPONSE,
+            seq,
+            req.sector_nb * BADUSB2_SECTOR_SIZE);
+        furi_hal_spi_release(SPI_HANDLE);
+
+        // Fill the other buffer while the RP2040 hands this one to the host
+        ahead = worker->msc_cur ^ 1;
+        worker->msc_ahead_lba = req.lba + req.sector_nb;
+        worker->msc_ahead_nb = req.sector_nb;
+        msc_read_sectors(
+            worker, worker->msc_frame[ahead].payload, worker->msc_ahead_lba, req.sector_nb);
+        worker->msc_ahead_valid = true;
+        return;
+
+    } else if (type == CMD_HID_STRING) {
+        if ((frame->header.flags & BADUSB2_FLAG_RESPONSE) && seq == worker->string_seq) {
+            worker->string_pending = false;
+        }
+
+    } else if (type == CMD_HID_CANCEL) {
+        if ((frame->header.flags & BADUSB2_FLAG_RESPONSE) && seq == worker->cancel_seq) {
+            worker->cancel_pending = false;
+        }
+
+    } else if (type == CMD_LINK_NAK) {
+        // MSC responses stay in msc_frame until the next request, a STRING chunk is rebuilt from
+        // the line
+        BadUsb2Frame* msc_frame = &worker->msc_frame[worker->msc_cur];
+        worker->link_stats.nak_received_nb++;
+        if (frame->header.flags & BADUSB2_FLAG_RESPONSE) {
+            if (msc_frame->header.magic == BADUSB2_FRAME_MAGIC &&
+                (msc_frame->header.flags & BADUSB2_FLAG_RESPONSE) &&
+                msc_frame->header.seq == seq) {
+                spi_resend_frame(worker, msc_frame);
+            }
+        } else if (worker->string_pending && seq == worker->string_seq) {
+            furi_hal_spi_release(SPI_HANDLE);
+            worker->link_stats.retransmit_nb++;
+            send_hid_string_chunk(worker);
+            return;
+        } else if (worker->cancel_pending && seq == worker->cancel_seq) {
+            furi_hal_spi_release(SPI_HANDLE);
+            worker->link_stats.retransmit_nb++;
+            send_hid_cancel(worker);
+            return;
+        }
+
+    } else if (type == CMD_LINK_STATS) {
+        BadUsb2LinkStats rp_stats;
+        if ((frame->header.flags & BADUSB2_FLAG_RESPONSE) &&
+            frame->header.length == sizeof(rp_stats)) {
+            memcpy(&rp_stats, frame->payload, sizeof(rp_stats));
+            if (memcmp(&rp_stats, &worker->rp_stats_logged, sizeof(rp_stats)) != 0) {
+                link_stats_log("RP2040", &rp_stats);
+                worker->rp_stats_logged = rp_stats;
+            }
         }
+
+    } else if (type == CMD_MSC_WRITE) {
+        uint32_t len = req.sector_nb * BADUSB2_SECTOR_SIZE;
+        bool written = false;
+        worker->msc_ahead_valid = false; // May overwrite what was read ahead
+        const uint8_t* sectors = frame->payload + sizeof(BadUsb2MscRequest);
+        if (file_ok && req.sector_nb > 0 &&
+            sizeof(BadUsb2MscRequest) + len <= frame->header.length) {
+            storage_file_seek(worker->iso_file, req.lba * BADUSB2_SECTOR_SIZE, true);
+            written = storage_file_write(worker->iso_file, sectors, len) == len;
+        }
+
+        // The RP2040 tells the host only after this ack. It goes out of msc_frame, which the read
+        // ahead no longer needs, so a NAK finds it there like a read response.
+        uint8_t flags = BADUSB2_FLAG_RESPONSE | (written ? 0 : BADUSB2_FLAG_ERROR);
+        spi_send_frame(&worker->msc_frame[worker->msc_cur], CMD_MSC_WRITE, flags, seq, 0);
     }
-    
+
     furi_hal_spi_release(SPI_HANDLE);
 }
 
-static void send_hid_command(BadUsb2Worker* worker, uint8_t type, uint8_t keycode) {
-    UNUSED(worker);
-    SpiPacket pkt;
-    memset(&pkt, 0, sizeof(SpiPacket));
-    pkt.magic = BADUSB2_PROTOCOL_MAGIC;
-    pkt.type = type;
-    pkt.address = keycode;
-    
-    furi_hal_spi_acquire(SPI_HANDLE);
-    furi_hal_gpio_write(SPI_CS_PIN, false);
-    furi_hal_spi_bus_tx(SPI_HANDLE, (uint8_t*)&pkt, sizeof(SpiPacket), SPI_TIMEOUT);
-    furi_hal_gpio_write(SPI_CS_PIN, true);
+static void handle_spi_transaction(BadUsb2Worker* worker) {
+    spi_acquire(worker);
+
+    // 1. Read Request
+    if (!spi_receive_frame(worker, &worker->frame)) {
+        // Ask again, going by the seq we expect as the header may be corrupt too
+        spi_send_nak(worker, worker->rp_seq_next, 0);
+        furi_hal_spi_release(SPI_HANDLE);
+        link_error(worker);
+        return;
+    }
+    worker->link_error_run = 0;
+
+    // 2. Process
+    handle_spi_frame(worker);
+}
+
+// Logs our counters when they changed and asks the RP2040 for its own, which the response logs
+static void link_stats_report(BadUsb2Worker* worker) {
+    if (furi_get_tick() - worker->link_stats_last < LINK_STATS_PERIOD) return;
+    worker->link_stats_last = furi_get_tick();
+
+    if (memcmp(&worker->link_stats, &worker->link_stats_logged, sizeof(BadUsb2LinkStats)) != 0) {
+        link_stats_log("Flipper", &worker->link_stats);
+        worker->link_stats_logged = worker->link_stats;
+    }
+    if (!worker->link_trained) return; // No RP2040 to ask
+
+    spi_service_pending(worker);
+    spi_acquire(worker);
+    spi_send_frame(&worker->frame, CMD_LINK_STATS, 0, worker->tx_seq++, 0);
+    furi_hal_spi_release(SPI_HANDLE);
+}
+
+// The RP2040 types a chunk on its own, without this it would go on for up to
+// BADUSB2_STRING_KEY_MAX keys after Stop
+static void send_hid_cancel(BadUsb2Worker* worker) {
+    spi_service_pending(worker);
+    worker->cancel_pending = true;
+    worker->cancel_start = furi_get_tick();
+
+    spi_acquire(worker);
+    spi_send_frame(&worker->frame, CMD_HID_CANCEL, 0, worker->cancel_seq, 0);
     furi_hal_spi_release(SPI_HANDLE);
 }
 
+static void hid_cancel_step(BadUsb2Worker* worker) {
+    if (!worker->cancel_pending || furi_get_tick() - worker->cancel_start < STRING_ACK_TIMEOUT) {
+        return;
+    }
+    worker->cancel_pending = false;
+    worker->link_stats.timeout_nb++;
+    if (worker->cancel_retry < BADUSB2_RETRY_MAX) {
+        worker->cancel_retry++;
+        worker->link_stats.retransmit_nb++;
+        send_hid_cancel(worker);
+    } else {
+        FURI_LOG_W(TAG, "STRING cancel not acked by RP2040");
+    }
+}
+
+static void worker_stop(BadUsb2Worker* worker) {
+    worker->st.state = BadUsbStateIdle;
+    if (worker->string_pending) {
+        worker->cancel_seq = worker->tx_seq++;
+        worker->cancel_retry = 0;
+        send_hid_cancel(worker);
+    }
+    worker->string_pending = false;
+    worker->string_pos = 0;
+}
+
 // --- DuckyScript Interpreter Partial Implementation ---
+static void finish_script_line(BadUsb2Worker* worker) {
+    worker->string_pos = 0;
+    furi_string_reset(worker->line);
+    worker->st.line_cur++;
+}
+
+static void execute_script_line(BadUsb2Worker* worker) {
+    const char* cmd = furi_string_get_cstr(worker->line);
+    if (strncmp(cmd, "STRING ", 7) == 0 && cmd[7] != '\0') {
+        // Line is kept until the RP2040 has typed every chunk
+        worker->string_pos = 7;
+        send_hid_string(worker);
+        return;
+    } else if (strncmp(cmd, "DELAY ", 6) == 0) {
+         uint32_t d;
+         if (strint_to_uint32(cmd + 6, NULL, &d, 10) == StrintParseNoError && d > 0) {
+             worker->delay_start = furi_get_tick();
+             worker->delay_len = d;
+             worker->st.delay_remain = (d + 999) / 1000;
+             worker->st.state = BadUsbStateDelay;
+         }
+    }
+    finish_script_line(worker);
+}
+
 static void execute_script_step(BadUsb2Worker* worker) {
-    if (furi_string_empty(worker->line)) {
-        if (storage_file_read(worker->script_file, worker->file_buf, 1) > 0) {
-            char c = (char)worker->file_buf[0];
-            if (c == '\n') {
-                const char* cmd = furi_string_get_cstr(worker->line);
-                if (strncmp(cmd, "STRING ", 7) == 0) {
-                    const char* str = cmd + 7;
-                    while (*str) {
-                         send_hid_command(worker, CMD_HID_PRESS, (uint8_t)*str);
-                         send_hid_command(worker, CMD_HID_RELEASE, 0);
-                         str++;
-                         furi_delay_ms(10);
-                    }
-                } else if (strncmp(cmd, "DELAY ", 6) == 0) {
-                     uint32_t d;
-                     if (strint_to_uint32(cmd + 6, NULL, &d, 10) == StrintParseNoError) {
-                         furi_delay_ms(d);
-                     }
-                }
-                furi_string_reset(worker->line);
-                worker->st.line_cur++;
-            } else {
-                furi_string_push_back(worker->line, c);
-            }
+    if (worker->st.state == BadUsbStateDelay) {
+        uint32_t elapsed = furi_get_tick() - worker->delay_start;
+        if (elapsed < worker->delay_len) {
+            worker->st.delay_remain = (worker->delay_len - elapsed + 999) / 1000;
+            return;
+        }
+        worker->st.state = BadUsbStateRunning;
+    }
+
+    if (worker->string_pending) {
+        if (furi_get_tick() - worker->string_start < worker->string_timeout) {
+            return; // RP2040 is still typing
+        }
+        worker->string_pending = false;
+        worker->link_stats.timeout_nb++;
+        if (worker->string_retry < BADUSB2_RETRY_MAX) {
+            // Same seq, the RP2040 only acks again if it typed the chunk and the ack got lost
+            FURI_LOG_W(TAG, "STRING ack timeout, line %zu, sending again", worker->st.line_cur);
+            worker->string_retry++;
+            worker->link_stats.retransmit_nb++;
+            worker->string_pos = worker->string_chunk_pos;
+            send_hid_string_chunk(worker);
+            return;
+        }
+        worker->string_pos = 0;
+        worker->st.state = BadUsbStateScriptError;
+        worker->st.error_line = worker->st.line_cur;
+        snprintf(worker->st.error, sizeof(worker->st.error), "STRING not acked by RP2040");
+        return;
+    }
+
+    if (worker->string_pos > 0) {
+        if (furi_string_get_cstr(worker->line)[worker->string_pos] != '\0') {
+            send_hid_string(worker);
         } else {
-            worker->st.state = BadUsbStateIdle;
-            furi_thread_flags_set(furi_thread_get_id(worker->thread), WorkerEvtStop);
+            finish_script_line(worker);
         }
+        return;
+    }
+
+    // Read the whole line, one step per script line
+    while (storage_file_read(worker->script_file, worker->file_buf, 1) > 0) {
+        char c = (char)worker->file_buf[0];
+        if (c == '\n') {
+            execute_script_line(worker);
+            return;
+        }
+        furi_string_push_back(worker->line, c);
+    }
+
+    if (!furi_string_empty(worker->line)) {
+        execute_script_line(worker); // Last line has no newline
+    } else {
+        worker->st.state = BadUsbStateIdle;
+        furi_thread_flags_set(furi_thread_get_id(worker->thread), WorkerEvtStop);
     }
 }
 
@@ -175,34 +722,58 @@ static int32_t bad_usb2_worker_task(void* context) {
         FURI_LOG_I(TAG, "Opened disk.img");
     }
 
+    link_train(worker);
+
     while(1) {
-        uint32_t flags = furi_thread_flags_wait(WorkerEvtStop | WorkerEvtStart | WorkerEvtSpiIrq, FuriFlagWaitAny, 10);
-        
+        uint32_t flags = furi_thread_flags_wait(
+            WorkerEvtStop | WorkerEvtStart | WorkerEvtSpiIrq | WorkerEvtEnd, FuriFlagWaitAny, 10);
+        bool idle = flags & FuriFlagError;
+        if (idle) {
+            flags = 0; // Error codes have event bits set
+        }
+
+        if (flags & WorkerEvtEnd) {
+            break;
+        }
+
         if (flags & WorkerEvtStop) {
-             if (worker->st.state == BadUsbStateRunning) {
-                 worker->st.state = BadUsbStateIdle;
+             if (worker_is_running(&worker->st)) {
+                 worker_stop(worker);
                  continue;
              }
         }
         
-        if (flags & WorkerEvtSpiIrq) {
+        if (furi_hal_gpio_read(GPIO_HANDSHAKE)) {
             handle_spi_transaction(worker);
-            furi_thread_flags_clear(WorkerEvtSpiIrq);
+            if (!worker->link_trained) {
+                link_train(worker); // RP2040 is up now, it may have still been booting at start
+            }
         }
         
         if (flags & WorkerEvtStart) {
             worker->st.state = BadUsbStateRunning;
             storage_file_seek(worker->script_file, 0, true);
             worker->st.line_cur = 0;
+            furi_string_reset(worker->line);
+            worker->string_pos = 0;
+            worker->string_pending = false;
             furi_thread_flags_clear(WorkerEvtStart);
         }
 
-        if (worker->st.state == BadUsbStateRunning) {
+        if (worker_is_running(&worker->st)) {
             execute_script_step(worker);
         }
+
+        hid_cancel_step(worker);
+        if (idle) {
+            link_step_up(worker); // Nothing happened for a while, the bus is free
+        }
+        link_stats_report(worker);
     }
     
     furi_hal_gpio_remove_int_callback(GPIO_HANDSHAKE);
+
+    link_stats_log("Flipper", &worker->link_stats);
     
     storage_file_close(worker->script_file);
     storage_file_close(worker->iso_file);
@@ -216,11 +787,17 @@ static int32_t bad_usb2_worker_task(void* context) {
 
 // --- API ---
 
+static void bad_usb2_worker_set_default_keyboard_layout(BadUsbScript* worker) {
+    memset(worker->layout, HID_KEYBOARD_NONE, sizeof(worker->layout));
+    memcpy(worker->layout, hid_asciimap, MIN(sizeof(hid_asciimap), sizeof(worker->layout)));
+}
+
 BadUsbScript* bad_usb2_worker_open(FuriString* file_path) {
     BadUsb2Worker* worker = malloc(sizeof(BadUsb2Worker));
     worker->file_path = furi_string_alloc();
     furi_string_set(worker->file_path, file_path);
     worker->layout_path = furi_string_alloc();
+    bad_usb2_worker_set_default_keyboard_layout(worker);
     
     worker->thread = furi_thread_alloc_ex("BadUsb2Worker", 4096, bad_usb2_worker_task, worker);
     furi_thread_start(worker->thread);
@@ -228,7 +805,7 @@ BadUsbScript* bad_usb2_worker_open(FuriString* file_path) {
 }
 
 void bad_usb2_worker_close(BadUsbScript* worker) {
-     furi_thread_flags_set(furi_thread_get_id(worker->thread), WorkerEvtStop);
+     furi_thread_flags_set(furi_thread_get_id(worker->thread), WorkerEvtEnd);
      furi_thread_join(worker->thread);
      furi_thread_free(worker->thread);
      furi_string_free(worker->file_path);
@@ -237,7 +814,7 @@ void bad_usb2_worker_close(BadUsbScript* worker) {
 }
 
 void bad_usb2_worker_start_stop(BadUsbScript* worker) {
-    if (worker->st.state == BadUsbStateRunning) {
+    if (worker_is_running(&worker->st)) {
         furi_thread_flags_set(furi_thread_get_id(worker->thread), WorkerEvtStop);
     } else {
         furi_thread_flags_set(furi_thread_get_id(worker->thread), WorkerEvtStart);
@@ -253,7 +830,24 @@ BadUsbState* bad_usb2_worker_get_state(BadUsbScript* worker) {
 }
 
 void bad_usb2_worker_set_keyboard_layout(BadUsbScript* worker, FuriString* layout_path) {
-    if (layout_path) {
-        furi_string_set(worker->layout_path, layout_path);
+    if (!layout_path || worker_is_running(&worker->st)) {
+        return; // Layout stays as it is while a script is typed
     }
+    furi_string_set(worker->layout_path, layout_path);
+
+    if (furi_string_empty(layout_path)) {
+        bad_usb2_worker_set_default_keyboard_layout(worker);
+        return;
+    }
+    File* layout_file = storage_file_alloc(furi_record_open(RECORD_STORAGE));
+    if (storage_file_open(
+            layout_file, furi_string_get_cstr(layout_path), FSAM_READ, FSOM_OPEN_EXISTING)) {
+        uint16_t layout[128];
+        if (storage_file_read(layout_file, layout, sizeof(layout)) == sizeof(layout)) {
+            memcpy(worker->layout, layout, sizeof(layout));
+        }
+    }
+    storage_file_close(layout_file);
+    storage_file_free(layout_file);
+    furi_record_close(RECORD_STORAGE);
 }
@@ -1,32 +1,184 @@
 #ifndef BADUSB2_PROTOCOL_H
 #define BADUSB2_PROTOCOL_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-// Protocol Magic Byte for Sync
-#define BADUSB2_PROTOCOL_MAGIC 0xBD
-
 // Command Types
 typedef enum {
     CMD_HID_PRESS = 0x01,
     CMD_HID_RELEASE = 0x02,
+    CMD_HID_STRING = 0x03,
+    CMD_HID_CANCEL = 0x04,
     CMD_MSC_READ = 0x10,
     CMD_MSC_WRITE = 0x11,
+    CMD_LINK_TRAIN = 0x20,
+    CMD_LINK_NAK = 0x21,
+    CMD_LINK_STATS = 0x22,
 } BadUsb2CommandType;
 
-// Payload Size (512 bytes for 1 sector)
-#define BADUSB2_PAYLOAD_SIZE 512
+// --- Framing ---
+// Every frame is a header followed by `length` payload bytes and a CRC, both sides are little endian.
+#define BADUSB2_FRAME_MAGIC 0xB2
+
+// CRC-32/MPEG-2 over the header and payload: polynomial 0x04C11DB7, MSB first, no final xor.
+// It's what the RP2040 DMA sniffer and the STM32 CRC unit compute without any bit reversal.
+#define BADUSB2_CRC_INIT 0xFFFFFFFF
+#define BADUSB2_CRC_SIZE 4
+
+// A frame that fails its CRC is asked for again with CMD_LINK_NAK, at most this many times
+#define BADUSB2_RETRY_MAX 3
+
+// MSC frames carry up to this many sectors
+#define BADUSB2_SECTOR_SIZE 512
+#define BADUSB2_SECTOR_MAX  8
+
+typedef enum {
+    BADUSB2_FLAG_RESPONSE = (1 << 0), // Answers the request with the same sequence number
+    BADUSB2_FLAG_ERROR = (1 << 1), // Request failed, payload is empty
+} BadUsb2FrameFlags;
 
 // Address Alignment
 #pragma pack(push, 1)
 
 typedef struct {
-    uint8_t magic;           // BADUSB2_PROTOCOL_MAGIC
+    uint8_t magic;           // BADUSB2_FRAME_MAGIC
     uint8_t type;            // BadUsb2CommandType
-    uint32_t address;        // MSC Sector Address (LBA) or HID Modifier/Keycode
-    uint8_t data[BADUSB2_PAYLOAD_SIZE]; // Data Payload
-} SpiPacket;
+    uint8_t flags;           // BadUsb2FrameFlags
+    uint8_t seq;             // Sender's frame counter, echoed in responses
+    uint16_t length;         // Payload bytes after the header
+} BadUsb2FrameHeader;
+
+// CMD_HID_PRESS payload, CMD_HID_RELEASE has none
+typedef struct {
+    uint8_t modifier;
+    uint8_t keycode;
+} BadUsb2HidKey;
+
+// CMD_HID_STRING payload is an array of BadUsb2HidKey. The RP2040 presses and releases each one
+// at the USB poll rate, then answers with an empty response once the last key is released.
+#define BADUSB2_STRING_KEY_MAX (BADUSB2_FRAME_PAYLOAD_MAX / sizeof(BadUsb2HidKey))
+
+// CMD_HID_CANCEL has no payload. The RP2040 drops the STRING it is typing, releases every key and
+// answers with an empty response.
+
+// CMD_LINK_TRAIN carries a test pattern of this many bytes, the RP2040 echoes it back in a response.
+// The Flipper clocks the bus, so it steps its clock up while the echoes come back intact.
+#define BADUSB2_TRAIN_LEN 64
+
+// CMD_LINK_NAK has no payload, seq names the frame to send again. Without BADUSB2_FLAG_RESPONSE it
+// is a request the receiver sent, seq counting from the one after its last request that got through.
+// With it, seq is the NAK sender's own request and the receiver resends its response to it.
+
+// CMD_MSC_READ request payload, and CMD_MSC_WRITE payload followed by the sectors.
+// A CMD_MSC_READ response carries sector_nb sectors, a CMD_MSC_WRITE response is an empty ack
+// sent once the sectors are stored, with BADUSB2_FLAG_ERROR when they couldn't be.
+typedef struct {
+    uint32_t lba;
+    uint16_t sector_nb;
+} BadUsb2MscRequest;
+
+#define BADUSB2_FRAME_PAYLOAD_MAX \
+    (sizeof(BadUsb2MscRequest) + BADUSB2_SECTOR_SIZE * BADUSB2_SECTOR_MAX)
+
+typedef struct {
+    BadUsb2FrameHeader header;
+    uint8_t payload[BADUSB2_FRAME_PAYLOAD_MAX + BADUSB2_CRC_SIZE]; // CRC follows the payload
+} BadUsb2Frame;
 
 #pragma pack(pop)
 
+// Link error counters, each side keeps its own. A CMD_LINK_STATS request has no payload, the
+// RP2040 answers with its counters.
+typedef struct {
+    uint32_t crc_error_nb; // Frames dropped on a CRC mismatch
+    uint32_t frame_error_nb; // Frames dropped on a bad header
+    uint32_t nak_sent_nb;
+    uint32_t nak_received_nb;
+    uint32_t retransmit_nb; // Frames sent again after a NAK or a timeout
+    uint32_t timeout_nb; // Frames or answers that never came
+} BadUsb2LinkStats;
+
+static inline uint32_t badusb2_crc32(uint32_t crc, const void* data, size_t size) {
+    // One nibble at a time, the table is small enough to live in every header user
+    static const uint32_t crc_table[16] = {
+        0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9, 0x130476DC, 0x17C56B6B,
+        0x1A864DB2, 0x1E475005, 0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+        0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD,
+    };
+    const uint8_t* byte = data;
+    while (size--) {
+        crc = (crc << 4) ^ crc_table[(crc >> 28) ^ (*byte >> 4)];
+        crc = (crc << 4) ^ crc_table[(crc >> 28) ^ (*byte & 0x0F)];
+        byte++;
+    }
+    return crc;
+}
+
+// Header, payload and CRC, as clocked over the bus
+static inline size_t badusb2_frame_size(uint16_t length) {
+    return sizeof(BadUsb2FrameHeader) + length + BADUSB2_CRC_SIZE;
+}
+
+static inline void badusb2_frame_set_crc(BadUsb2Frame* frame, uint32_t crc) {
+    uint8_t* trailer = &frame->payload[frame->header.length];
+    for (size_t i = 0; i < BADUSB2_CRC_SIZE; i++) {
+        trailer[i] = (uint8_t)(crc >> (i * 8));
+    }
+}
+
+// Software CRC of the header and payload, for sides without CRC hardware
+static inline uint32_t badusb2_frame_crc(const BadUsb2Frame* frame) {
+    return badusb2_crc32(
+        BADUSB2_CRC_INIT, frame, sizeof(BadUsb2FrameHeader) + frame->header.length);
+}
+
+static inline uint32_t badusb2_frame_get_crc(const BadUsb2Frame* frame) {
+    const uint8_t* trailer = &frame->payload[frame->header.length];
+    uint32_t crc = 0;
+    for (size_t i = 0; i < BADUSB2_CRC_SIZE; i++) {
+        crc |= (uint32_t)trailer[i] << (i * 8);
+    }
+    return crc;
+}
+
+static inline void badusb2_frame_header_init(
+    BadUsb2FrameHeader* header,
+    uint8_t type,
+    uint8_t flags,
+    uint8_t seq,
+    uint16_t length) {
+    header->magic = BADUSB2_FRAME_MAGIC;
+    header->type = type;
+    header->flags = flags;
+    header->seq = seq;
+    header->length = length;
+}
+
+static inline bool badusb2_frame_type_is_known(uint8_t type) {
+    switch(type) {
+    case CMD_HID_PRESS:
+    case CMD_HID_RELEASE:
+    case CMD_HID_STRING:
+    case CMD_HID_CANCEL:
+    case CMD_MSC_READ:
+    case CMD_MSC_WRITE:
+    case CMD_LINK_TRAIN:
+    case CMD_LINK_NAK:
+    case CMD_LINK_STATS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// A stray byte can pass for the magic, so every header field has to make sense
+static inline bool badusb2_frame_header_is_valid(const BadUsb2FrameHeader* header) {
+    return (header->magic == BADUSB2_FRAME_MAGIC) &&
+           badusb2_frame_type_is_known(header->type) &&
+           !(header->flags & ~(BADUSB2_FLAG_RESPONSE | BADUSB2_FLAG_ERROR)) &&
+           (header->length <= BADUSB2_FRAME_PAYLOAD_MAX);
+}
+
 #endif // BADUSB2_PROTOCOL_H
@@ -0,0 +1,426 @@
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/gpio.h"
+#include "hardware/dma.h"
+
+#include "badusb2_spi_slave.h"
+
+// Quiet time that ends a corrupt frame
+#define SPI_DRAIN_IDLE_US 200
+// Time the Flipper gets to clock out a frame we queued, or the rest of a frame it started
+#define SPI_FRAME_TIMEOUT_US 200000
+// Time the Flipper gets to answer an MSC request before the request is sent again
+#define SPI_RESPONSE_TIMEOUT_US 500000
+
+typedef enum {
+    SpiRxOk,
+    SpiRxBad, // Corrupt, the sender is asked for it again
+    SpiRxTimeout, // Nothing came, the frame was lost outright
+} SpiRxResult;
+
+// What was just received, a NAK can be built in it
+static BadUsb2Frame spi_frame;
+// MSC read requests, kept until answered so a NAK can have them again
+static BadUsb2Frame spi_ctrl_frame;
+// Acks, training echoes and counters, which must not overwrite a request in flight
+static BadUsb2Frame spi_response_frame;
+static uint8_t spi_tx_seq = 0;
+static BadUsb2LinkStats link_stats;
+// Next Flipper request we expect, what a NAK asks for when its frame is lost
+static uint8_t spi_rx_seq_next = 0;
+// MSC write, kept until the Flipper acks it
+static BadUsb2Frame spi_write_frame;
+static bool spi_tx_pending = false; // Handshake stays up until a queued frame is clocked out
+static absolute_time_t spi_tx_deadline; // The queued frame is dropped if still there by then
+// DMA channels feeding and draining the SPI FIFOs
+static int spi_dma_tx;
+static int spi_dma_rx;
+// Runs CRCs through the DMA sniffer, -1 when no channel was left and the CPU does them
+static int spi_dma_crc;
+static const uint8_t spi_dma_zero = 0;
+static uint8_t spi_dma_sink;
+// What the Flipper clocks in while one of our frames goes out. It zeroes the header it reads
+// into, so a frame here is a request of its own that crossed ours.
+static BadUsb2Frame spi_cross_frame;
+static size_t spi_cross_len; // Bytes clocked in, a longer frame was cut short
+static bool spi_cross_watch = false;
+static bool spi_cross_lost = false; // A crossed request was dropped, the main loop NAKs it
+
+// As a slave the SCK comes from the Flipper, which trains it up to what the wiring sustains.
+// spi_init() resets the block, which also empties FIFOs a dropped transfer left bytes in.
+static void spi_port_init(void) {
+    spi_init(SPI_PORT, 1000 * 1000);
+    spi_set_slave(SPI_PORT, true);
+}
+
+void spi_slave_init(void) {
+    spi_port_init();
+    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_CS, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
+    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
+
+    gpio_init(PIN_HANDSHAKE);
+    gpio_set_dir(PIN_HANDSHAKE, GPIO_OUT);
+    gpio_put(PIN_HANDSHAKE, 0);
+
+    spi_dma_tx = dma_claim_unused_channel(true);
+    spi_dma_rx = dma_claim_unused_channel(true);
+    spi_dma_crc = dma_claim_unused_channel(false);
+}
+
+// Continues crc over len bytes. The sniffer sees them as the DMA copies them into a sink,
+// which beats the CPU loop on a full MSC frame. CRC-32/MPEG-2 is its plain CRC32 mode.
+static uint32_t spi_crc(uint32_t crc, const void* data, size_t len) {
+    if (spi_dma_crc < 0 || len == 0) {
+        return badusb2_crc32(crc, data, len);
+    }
+
+    dma_channel_config c = dma_channel_get_default_config(spi_dma_crc);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+    dma_sniffer_set_data_accumulator(crc);
+    dma_sniffer_enable(spi_dma_crc, DMA_SNIFF_CTRL_CALC_VALUE_CRC32, true);
+    dma_channel_configure(spi_dma_crc, &c, &spi_dma_sink, data, len, true);
+    dma_channel_wait_for_finish_blocking(spi_dma_crc);
+    crc = dma_sniffer_get_data_accumulator();
+    dma_sniffer_disable();
+    return crc;
+}
+
+// Starts moving len bytes each way, a NULL side sends zeros or discards what comes in.
+// What comes in while a frame goes out is kept in spi_cross_frame instead.
+static void spi_dma_start(const uint8_t* tx, uint8_t* rx, size_t len) {
+    spi_cross_watch = (tx != NULL && rx == NULL);
+    if (spi_cross_watch) {
+        spi_cross_frame.header.magic = 0;
+        spi_cross_len = len;
+        rx = (uint8_t*)&spi_cross_frame;
+    }
+
+    dma_channel_config c = dma_channel_get_default_config(spi_dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(SPI_PORT, true));
+    channel_config_set_read_increment(&c, tx != NULL);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(
+        spi_dma_tx, &c, &spi_get_hw(SPI_PORT)->dr, tx ? tx : &spi_dma_zero, len, false);
+
+    c = dma_channel_get_default_config(spi_dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, spi_get_dreq(SPI_PORT, false));
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, rx != NULL);
+    dma_channel_configure(
+        spi_dma_rx, &c, rx ? rx : &spi_dma_sink, &spi_get_hw(SPI_PORT)->dr, len, false);
+
+    dma_start_channel_mask((1u << spi_dma_tx) | (1u << spi_dma_rx));
+}
+
+// Stray bytes must not pass for a lost request, or both sides end up NAKing each other.
+// The whole header has to be valid, and so does the CRC when the frame came in whole.
+static bool spi_cross_is_frame(void) {
+    const BadUsb2FrameHeader* header = &spi_cross_frame.header;
+    if (!badusb2_frame_header_is_valid(header)) {
+        return false;
+    }
+    if (badusb2_frame_size(header->length) > spi_cross_len) {
+        return true; // Cut short by the end of our frame, the header is all there is
+    }
+    uint32_t crc = spi_crc(BADUSB2_CRC_INIT, header, sizeof(BadUsb2FrameHeader) + header->length);
+    return crc == badusb2_frame_get_crc(&spi_cross_frame);
+}
+
+static bool spi_dma_busy(void) {
+    return dma_channel_is_busy(spi_dma_tx) || dma_channel_is_busy(spi_dma_rx);
+}
+
+// A queued frame must be off the wire before anything else uses the bus. One the Flipper
+// doesn't clock by the deadline is dropped, false then, so tud_task() never stalls on the link.
+static bool spi_dma_wait_until(absolute_time_t deadline) {
+    bool done = true;
+    while (spi_dma_busy()) {
+        if (time_reached(deadline)) {
+            dma_channel_abort(spi_dma_tx);
+            dma_channel_abort(spi_dma_rx);
+            spi_port_init();
+            link_stats.timeout_nb++;
+            done = false;
+            break;
+        }
+    }
+
+    if (spi_tx_pending) {
+        gpio_put(PIN_HANDSHAKE, 0);
+        spi_tx_pending = false;
+    }
+    if (spi_cross_watch) {
+        spi_cross_watch = false;
+        if (done && spi_cross_is_frame()) {
+            link_stats.frame_error_nb++;
+            spi_cross_lost = true;
+        }
+    }
+    return done;
+}
+
+static bool spi_dma_wait(void) {
+    return spi_dma_wait_until(make_timeout_time_us(SPI_FRAME_TIMEOUT_US));
+}
+
+// Starts clocking out a sealed frame and raises the handshake until the Flipper has read it
+static void spi_start_frame(const BadUsb2Frame* frame) {
+    spi_dma_wait();
+    spi_dma_start((const uint8_t*)frame, NULL, badusb2_frame_size(frame->header.length));
+    gpio_put(PIN_HANDSHAKE, 1);
+    spi_tx_pending = true;
+    spi_tx_deadline = make_timeout_time_us(SPI_FRAME_TIMEOUT_US);
+}
+
+// Seals a frame with its CRC and starts clocking it out.
+// The frame stays untouched until the next one is queued, so a NAK can have it again.
+static void spi_queue_frame(
+    BadUsb2Frame* frame, uint8_t type, uint8_t flags, uint8_t seq, uint16_t length) {
+    badusb2_frame_header_init(&frame->header, type, flags, seq, length);
+    uint32_t crc = spi_crc(BADUSB2_CRC_INIT, frame, sizeof(BadUsb2FrameHeader) + length);
+    badusb2_frame_set_crc(frame, crc);
+    spi_start_frame(frame);
+}
+
+static void spi_send_frame(
+    BadUsb2Frame* frame, uint8_t type, uint8_t flags, uint8_t seq, uint16_t length) {
+    spi_queue_frame(frame, type, flags, seq, length);
+    spi_dma_wait();
+}
+
+void spi_send_response(uint8_t type, uint8_t seq, const void* payload, uint16_t length) {
+    if (length > 0) {
+        memcpy(spi_response_frame.payload, payload, length);
+    }
+    spi_send_frame(&spi_response_frame, type, BADUSB2_FLAG_RESPONSE, seq, length);
+}
+
+// spi_frame only ever holds what was just received, so a NAK can be built in it
+static void spi_send_nak(uint8_t seq, uint8_t flags) {
+    link_stats.nak_sent_nb++;
+    spi_send_frame(&spi_frame, CMD_LINK_NAK, flags, seq, 0);
+}
+
+// Frame still holds what was sent, CRC included
+static void spi_resend_frame(const BadUsb2Frame* frame) {
+    link_stats.retransmit_nb++;
+    spi_start_frame(frame);
+}
+
+// Sends our request with this seq again, if it is still in its buffer
+static void spi_resend(uint8_t seq) {
+    BadUsb2Frame* frames[] = {&spi_ctrl_frame, &spi_write_frame};
+    link_stats.nak_received_nb++;
+    for (size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+        BadUsb2Frame* frame = frames[i];
+        if (frame->header.magic == BADUSB2_FRAME_MAGIC &&
+            !(frame->header.flags & BADUSB2_FLAG_RESPONSE) &&
+            frame->header.seq == seq) {
+            spi_resend_frame(frame);
+            return;
+        }
+    }
+}
+
+// Our queued frame goes out first, then the header must be in by the deadline
+static SpiRxResult spi_receive_header(BadUsb2FrameHeader* header, absolute_time_t deadline) {
+    if (!spi_dma_wait()) {
+        return SpiRxTimeout;
+    }
+    spi_dma_start(NULL, (uint8_t*)header, sizeof(BadUsb2FrameHeader));
+    if (!spi_dma_wait_until(deadline)) {
+        return SpiRxTimeout;
+    }
+    if (!badusb2_frame_header_is_valid(header)) {
+        link_stats.frame_error_nb++;
+        return SpiRxBad;
+    }
+    return SpiRxOk;
+}
+
+// Reads the payload and the CRC behind it, SpiRxBad when they don't match
+static SpiRxResult spi_receive_payload(const BadUsb2FrameHeader* header, uint8_t* payload) {
+    uint8_t trailer[BADUSB2_CRC_SIZE];
+    if (header->length > 0) {
+        spi_dma_start(NULL, payload, header->length);
+        if (!spi_dma_wait()) {
+            return SpiRxTimeout;
+        }
+    }
+    spi_dma_start(NULL, trailer, sizeof(trailer));
+    if (!spi_dma_wait()) {
+        return SpiRxTimeout;
+    }
+
+    uint32_t crc = spi_crc(BADUSB2_CRC_INIT, header, sizeof(BadUsb2FrameHeader));
+    crc = spi_crc(crc, payload, header->length);
+    uint32_t crc_rx = 0;
+    for (size_t i = 0; i < sizeof(trailer); i++) {
+        crc_rx |= (uint32_t)trailer[i] << (i * 8);
+    }
+    if (crc != crc_rx) {
+        link_stats.crc_error_nb++;
+        return SpiRxBad;
+    }
+    return SpiRxOk;
+}
+
+// Drops the rest of a corrupt frame, the next header starts once the bus has been idle a while.
+// Bytes are taken straight from the FIFO, a blocking read would queue zeros to send as well.
+static void spi_drain(void) {
+    absolute_time_t idle = make_timeout_time_us(SPI_DRAIN_IDLE_US);
+    while (!time_reached(idle)) {
+        if (spi_is_readable(SPI_PORT)) {
+            (void)spi_get_hw(SPI_PORT)->dr;
+            idle = make_timeout_time_us(SPI_DRAIN_IDLE_US);
+        }
+    }
+}
+
+// Reads the header first, then only as many payload bytes as it announces
+static SpiRxResult spi_receive_frame(BadUsb2Frame* frame) {
+    absolute_time_t deadline = make_timeout_time_us(SPI_FRAME_TIMEOUT_US);
+    SpiRxResult rx = spi_receive_header(&frame->header, deadline);
+    if (rx == SpiRxBad) {
+        spi_drain(); // Link training or a bad clock can leave the bus mid-frame
+    }
+    if (rx != SpiRxOk) {
+        return rx;
+    }
+    return spi_receive_payload(&frame->header, frame->payload);
+}
+
+// Serves a request the Flipper sent, from the main loop or while an MSC read waits for its answer
+static void spi_dispatch_frame(BadUsb2Frame* frame) {
+    if (!(frame->header.flags & BADUSB2_FLAG_RESPONSE) &&
+        frame->header.type != CMD_LINK_NAK) {
+        spi_rx_seq_next = frame->header.seq + 1;
+    }
+
+    if (frame->header.type == CMD_LINK_TRAIN) {
+        // Echo the pattern, the Flipper compares it at the clock it is trying
+        spi_send_response(
+            CMD_LINK_TRAIN, frame->header.seq, frame->payload, frame->header.length);
+    } else if (frame->header.type == CMD_LINK_STATS) {
+        spi_send_response(CMD_LINK_STATS, frame->header.seq, &link_stats, sizeof(link_stats));
+    } else if (frame->header.type == CMD_LINK_NAK) {
+        if (!(frame->header.flags & BADUSB2_FLAG_RESPONSE)) {
+            spi_resend(frame->header.seq); // An MSC write or read request got lost
+        }
+    } else {
+        hid_dispatch_frame(frame);
+    }
+}
+
+// Sends the MSC request in frame and waits for its response, rx_len payload bytes land in rx.
+// Both reads and writes only count as done once the Flipper has checked the CRC and answered.
+static bool spi_msc_request(
+    BadUsb2Frame* frame, uint8_t type, uint16_t length, void* rx, uint16_t rx_len) {
+    // 1. Hand the request to the Flipper, then wake it
+    // The Master sees the Handshake, clocks the request out, then clocks the response in.
+    uint8_t seq = spi_tx_seq++;
+    spi_queue_frame(frame, type, 0, seq, length);
+
+    // 2. Receive data straight into the USB buffer, asking again while it arrives corrupt.
+    // A request clocked out while the Flipper sent, or dropped on its side, gets no answer at all,
+    // so it goes out again once the response is overdue.
+    absolute_time_t deadline = make_timeout_time_us(SPI_RESPONSE_TIMEOUT_US);
+    uint8_t retry = 0;
+    while (retry <= BADUSB2_RETRY_MAX) {
+        BadUsb2FrameHeader header;
+        SpiRxResult rx = spi_receive_header(&header, deadline);
+        if (rx == SpiRxTimeout) {
+            spi_resend_frame(frame);
+            deadline = make_timeout_time_us(SPI_RESPONSE_TIMEOUT_US);
+            retry++;
+            continue;
+        }
+        if (rx == SpiRxBad) {
+            spi_drain();
+            spi_send_nak(seq, BADUSB2_FLAG_RESPONSE);
+            deadline = make_timeout_time_us(SPI_RESPONSE_TIMEOUT_US);
+            retry++;
+            continue;
+        }
+
+        bool expected = header.type == type &&
+                        header.seq == seq &&
+                        (header.flags & BADUSB2_FLAG_RESPONSE) &&
+                        !(header.flags & BADUSB2_FLAG_ERROR) &&
+                        header.length == rx_len;
+        if (spi_receive_payload(&header, expected ? (uint8_t*)rx : spi_frame.payload) != SpiRxOk) {
+            spi_send_nak(seq, BADUSB2_FLAG_RESPONSE);
+            deadline = make_timeout_time_us(SPI_RESPONSE_TIMEOUT_US);
+            retry++;
+            continue;
+        }
+        if (expected) {
+            return true;
+        }
+        if (header.type == CMD_LINK_NAK && !(header.flags & BADUSB2_FLAG_RESPONSE)) {
+            spi_resend(header.seq); // The Flipper lost our request
+            deadline = make_timeout_time_us(SPI_RESPONSE_TIMEOUT_US);
+            retry++;
+            continue;
+        }
+        if (!(header.flags & BADUSB2_FLAG_RESPONSE)) {
+            // A Flipper request such as a STRING crossed ours, serve it and keep waiting
+            spi_frame.header = header;
+            spi_dispatch_frame(&spi_frame);
+            continue;
+        }
+        break; // Error response
+    }
+
+    return false; // The host gets an error instead of a USB stack stuck on the link
+}
+
+// bufsize is up to CFG_TUD_MSC_EP_BUFSIZE, all of its sectors are asked for in one frame
+bool spi_msc_read(uint32_t lba, uint16_t sector_nb, void* buffer) {
+    BadUsb2MscRequest req = {.lba = lba, .sector_nb = sector_nb};
+    memcpy(spi_ctrl_frame.payload, &req, sizeof(req));
+    return spi_msc_request(
+        &spi_ctrl_frame, CMD_MSC_READ, sizeof(req), buffer, sector_nb * BADUSB2_SECTOR_SIZE);
+}
+
+bool spi_msc_write(uint32_t lba, uint16_t sector_nb, const uint8_t* buffer) {
+    // Request followed by the sectors, the ack is an empty response
+    BadUsb2MscRequest req = {.lba = lba, .sector_nb = sector_nb};
+    uint16_t length = sizeof(req) + sector_nb * BADUSB2_SECTOR_SIZE;
+    memcpy(spi_write_frame.payload, &req, sizeof(req));
+    memcpy(spi_write_frame.payload + sizeof(req), buffer, sector_nb * BADUSB2_SECTOR_SIZE);
+    return spi_msc_request(&spi_write_frame, CMD_MSC_WRITE, length, NULL, 0);
+}
+
+void spi_slave_task(void) {
+    if ((spi_tx_pending || spi_cross_watch) &&
+        (!spi_dma_busy() || time_reached(spi_tx_deadline))) {
+        // Drops the handshake and checks what came in while the frame went out
+        spi_dma_wait_until(spi_tx_deadline);
+    }
+    if (spi_cross_lost) {
+        // Our frame went out on the Flipper's clock while it sent, it asks for ours in turn
+        spi_cross_lost = false;
+        spi_send_nak(spi_rx_seq_next, 0);
+    }
+
+    // The Flipper selects us whenever it has a frame, the FIFO tells a header is coming in
+    if (!spi_dma_busy() && spi_is_readable(SPI_PORT)) {
+        // Header first, it tells how much payload follows
+        if (spi_receive_frame(&spi_frame) != SpiRxOk) {
+            // Ask again, going by the seq we expect as the header may be corrupt too
+            spi_send_nak(spi_rx_seq_next, 0);
+        } else {
+            spi_dispatch_frame(&spi_frame);
+        }
+    }
+}
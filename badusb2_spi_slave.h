@@ -0,0 +1,36 @@
+#ifndef BADUSB2_SPI_SLAVE_H
+#define BADUSB2_SPI_SLAVE_H
+
+// RP2040 side of the BadUSB 2.0 SPI link: frames, DMA, CRCs and NAKs.
+// Both firmwares build badusb2_spi_slave.c, each serves its own HID requests.
+
+#include "badusb2_protocol.h"
+
+// --- Configuration ---
+#define SPI_PORT spi0
+#define PIN_MISO 16
+#define PIN_CS   17
+#define PIN_SCK  18
+#define PIN_MOSI 19
+
+// Handshake Pin: High = Request Attention from Flipper, held until the frame is clocked out
+#define PIN_HANDSHAKE 20
+
+void spi_slave_init(void);
+
+// Answers the Flipper's request with this seq. Returns once the Flipper has clocked it out, or it
+// was dropped on a timeout.
+void spi_send_response(uint8_t type, uint8_t seq, const void* payload, uint16_t length);
+
+// Asks the Flipper for the sectors of an MSC read, false when they didn't come through
+bool spi_msc_read(uint32_t lba, uint16_t sector_nb, void* buffer);
+// Hands the sectors of an MSC write to the Flipper, true once it has acked them
+bool spi_msc_write(uint32_t lba, uint16_t sector_nb, const uint8_t* buffer);
+
+// Main loop part: finishes sent frames and serves what the Flipper clocks in
+void spi_slave_task(void);
+
+// Implemented by each firmware, serves the HID requests among the Flipper's frames
+void hid_dispatch_frame(BadUsb2Frame* frame);
+
+#endif // BADUSB2_SPI_SLAVE_H
@@ -1,11 +0,0 @@
-#pragma once
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-typedef struct BadUsbApp BadUsbApp;
-
-#ifdef __cplusplus
-}
-#endif
@@ -0,0 +1,163 @@
+// ALTSTRING over every printable char. Cost per char when each code is formatted with
+// snprintf and typed through ALTCHAR, with the LED state queried per command, as ALTSTRING
+// used to do, against the precomputed numpad table. Then a script is run by the worker to
+// check the reports sent and how often NumLock is queried.
+// Usage: bench_altstring [--quick]
+
+#include "host_test.h"
+#include "hid_record.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+
+#define BENCH_ALTSTRING_NB       10000
+#define BENCH_ALTSTRING_NB_QUICK 100
+
+// Backend that sends nothing, keys are hashed so both paths must type the same sequence
+static uint32_t bench_key_hash;
+static size_t bench_key_nb;
+
+static bool bench_hid_key(void* inst, uint16_t button) {
+    UNUSED(inst);
+    bench_key_hash = (bench_key_hash ^ button) * 16777619;
+    bench_key_nb++;
+    return true;
+}
+
+static bool bench_hid_none(void* inst) {
+    UNUSED(inst);
+    return true;
+}
+
+static uint8_t bench_hid_led_state(void* inst) {
+    UNUSED(inst);
+    return HID_KB_LED_NUM;
+}
+
+static const BadUsbHidApi bench_hid = {
+    .kb_press = bench_hid_key,
+    .kb_release = bench_hid_key,
+    .kb_release_all = bench_hid_none,
+    .release_all = bench_hid_none,
+    .get_led_state = bench_hid_led_state,
+};
+
+static bool bench_altstring_legacy(BadUsbScript* bad_usb, const char* param) {
+    bad_usb->hid->get_led_state(bad_usb->hid_inst);
+    uint32_t i = 0;
+    bool state = false;
+    while(param[i] != '\0') {
+        if((param[i] < ' ') || (param[i] > '~')) {
+            i++;
+            continue; // Skip non-printable chars
+        }
+
+        char temp_str[4];
+        snprintf(temp_str, 4, "%u", param[i]);
+
+        state = ducky_altchar(bad_usb, temp_str);
+        if(state == false) break;
+        i++;
+    }
+    return state;
+}
+
+static bool bench_altstring_table(BadUsbScript* bad_usb, const char* param) {
+    ducky_numlock_on(bad_usb);
+    return ducky_altstring(bad_usb, param);
+}
+
+static double bench_altstring_type(
+    BadUsbScript* bad_usb,
+    const char* param,
+    bool (*type)(BadUsbScript* bad_usb, const char* param),
+    size_t repeat_nb,
+    uint32_t* key_hash) {
+    type(bad_usb, param); // Warm up
+    bench_key_hash = 2166136261;
+    bench_key_nb = 0;
+    uint64_t start = host_bench_get_ns();
+    for(size_t i = 0; i < repeat_nb; i++) {
+        type(bad_usb, param);
+    }
+    double time_ns = (double)(host_bench_get_ns() - start) / (repeat_nb * strlen(param));
+    *key_hash = bench_key_hash;
+    return time_ns;
+}
+
+// LED state is queried once per ALTCHAR or ALTSTRING command, NumLock is pressed for the first
+// command and again only after the script toggles it
+static bool bench_altstring_run(const char* param) {
+    FuriString* script = furi_string_alloc();
+    furi_string_printf(
+        script, "ALTSTRING %s\nALTCHAR 65\nNUMLOCK\nALTSTRING ab\nALTCHAR 66\n", param);
+    FuriString* path = host_test_write_script(
+        "altstring.txt", furi_string_get_cstr(script), furi_string_size(script));
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+
+    hid_record_reset();
+    const HostTestEvent start_event = {0, HostTestEventStartStop};
+    bool state = (host_test_run_events(bad_usb, &start_event, 1) == BadUsbStateDone);
+
+    // Alt press and release around a press and release per digit
+    size_t report_nb = 0;
+    for(const char* chr = param; *chr != '\0'; chr++) {
+        report_nb += 2 + 2 * ((*chr < 100) ? 2 : 3);
+    }
+    report_nb += 2 * 2; // NumLock on for the first ALTSTRING and for the one after NUMLOCK
+    report_nb += 2; // NUMLOCK
+    report_nb += 4 * (2 + 2 * 2); // ALTCHAR 65, ALTSTRING ab, ALTCHAR 66
+    report_nb += 3; // The script end releases keyboard, consumer and mouse
+    if(hid_record_get_report_nb() != report_nb) {
+        fprintf(
+            stderr, "%zu reports, expected %zu\n", hid_record_get_report_nb(), report_nb);
+        state = false;
+    }
+    if(hid_record_get_led_query_nb() != 4) {
+        fprintf(stderr, "%zu LED state queries, expected 4\n", hid_record_get_led_query_nb());
+        state = false;
+    }
+
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    furi_string_free(script);
+    return state;
+}
+
+int main(int argc, char* argv[]) {
+    size_t repeat_nb = host_bench_is_quick(argc, argv) ? BENCH_ALTSTRING_NB_QUICK :
+                                                         BENCH_ALTSTRING_NB;
+
+    BadUsbScript* bad_usb = malloc(sizeof(BadUsbScript));
+    memset(bad_usb, 0, sizeof(BadUsbScript));
+    bad_usb->hid = &bench_hid;
+
+    char param['~' - ' ' + 2];
+    for(char chr = ' '; chr <= '~'; chr++) {
+        param[chr - ' '] = chr;
+    }
+    param[sizeof(param) - 1] = '\0';
+
+    uint32_t legacy_hash = 0;
+    uint32_t table_hash = 0;
+    double legacy =
+        bench_altstring_type(bad_usb, param, bench_altstring_legacy, repeat_nb, &legacy_hash);
+    double table =
+        bench_altstring_type(bad_usb, param, bench_altstring_table, repeat_nb, &table_hash);
+    bool state = (legacy_hash == table_hash);
+    if(!state) fprintf(stderr, "numpad table types other keys than the decimal codes\n");
+
+    bool run_state = bench_altstring_run(param);
+    printf("ALTSTRING x%zu, ns per char   snprintf    table  speedup  worker run\n", repeat_nb);
+    printf(
+        "%-30s %8.1f %8.1f %7.1fx %s\n",
+        "printable chars",
+        legacy,
+        table,
+        legacy / table,
+        run_state ? "ok" : "FAILED");
+    state &= run_state;
+
+    free(bad_usb);
+    return state ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Time to ready for 1 KB to 10 MB scripts. The worker leaves Init once the first line is
+// compiled, the rest is compiled in the background. The baseline is the full file scan that
+// used to count lines before the worker could report Idle.
+// Usage: bench_open [--quick]
+
+#include "host_test.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+#include <sched.h>
+
+static const char* bench_open_lines[] = {
+    "STRING The quick brown fox jumps over the lazy dog 0123456789\n",
+    "DELAY 10\n",
+    "CTRL-ALT DELETE\n",
+    "REM comment line\n",
+    "STRINGLN echo hello\n",
+    "ENTER\n",
+};
+
+static FuriString* bench_open_write(size_t size) {
+    FuriString* text = furi_string_alloc_set_str("ID 1234:5678 Bench:Keyboard\n");
+    for(size_t i = 0; furi_string_size(text) < size; i++) {
+        furi_string_cat_str(text, bench_open_lines[i % COUNT_OF(bench_open_lines)]);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "open_%zu.txt", size);
+    FuriString* path =
+        host_test_write_script(name, furi_string_get_cstr(text), furi_string_size(text));
+    furi_string_free(text);
+    return path;
+}
+
+// Line count scan the previous preload ran before the script was ready
+static double bench_open_scan(FuriString* path) {
+    uint64_t start = host_bench_get_ns();
+    File* file = storage_file_alloc(furi_record_open(RECORD_STORAGE));
+    host_test_check(
+        storage_file_open(file, furi_string_get_cstr(path), FSAM_READ, FSOM_OPEN_EXISTING));
+    static char buf[FILE_BUFFER_LEN];
+    size_t line_nb = 0;
+    size_t line_len = 0;
+    size_t read_len = 0;
+    do {
+        read_len = storage_file_read(file, buf, FILE_BUFFER_LEN);
+        for(size_t i = 0; i < read_len; i++) {
+            if((buf[i] == '\n') && (line_len > 0)) {
+                line_nb++;
+                line_len = 0;
+            } else {
+                line_len++;
+            }
+        }
+    } while(read_len > 0);
+    storage_file_seek(file, 0, true);
+    storage_file_free(file);
+    host_test_check(line_nb > 0);
+    return (host_bench_get_ns() - start) / 1e6;
+}
+
+// Open until the worker leaves Init, then until it has nothing left to do
+static double bench_open_ready(FuriString* path, BadUsbHidSession* session, double* idle_ms) {
+    uint64_t start = host_bench_get_ns();
+    BadUsbScript* bad_usb = bad_usb_script_open(path, BadUsbHidInterfaceUsb, session);
+    volatile BadUsbWorkerState* state = &bad_usb_script_get_state(bad_usb)->state;
+    while(*state == BadUsbStateInit) {
+        sched_yield();
+    }
+    double ready_ms = (host_bench_get_ns() - start) / 1e6;
+    host_test_check(*state == BadUsbStateIdle);
+
+    host_test_wait_idle(bad_usb);
+    *idle_ms = (host_bench_get_ns() - start) / 1e6;
+    host_test_check(*state == BadUsbStateIdle);
+    bad_usb_script_close(bad_usb);
+    return ready_ms;
+}
+
+int main(int argc, char* argv[]) {
+    static const size_t sizes[] = {1024, 10 * 1024, 100 * 1024, 1024 * 1024, 10 * 1024 * 1024};
+    size_t size_nb = host_bench_is_quick(argc, argv) ? 3 : COUNT_OF(sizes);
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+
+    printf("open, ms        full scan   ready  compiled   cached ready\n");
+    for(size_t i = 0; i < size_nb; i++) {
+        FuriString* path = bench_open_write(sizes[i]);
+        double scan_ms = bench_open_scan(path);
+        double compiled_ms = 0;
+        double ready_ms = bench_open_ready(path, session, &compiled_ms);
+        double cached_idle_ms = 0;
+        double cached_ms = bench_open_ready(path, session, &cached_idle_ms);
+        printf(
+            "%6zu KB %15.3f %7.3f %9.1f %14.3f\n",
+            sizes[i] / 1024,
+            scan_ms,
+            ready_ms,
+            compiled_ms,
+            cached_ms);
+        furi_string_free(path);
+    }
+
+    bad_usb_hid_session_free(session);
+    return 0;
+}
@@ -0,0 +1,134 @@
+// REPEAT 10000 over key combos and strings. Dispatch cost per repetition when the line is
+// parsed again, as REPEAT used to do, against replaying the cached op. Then whole scripts are
+// run by the worker to check the reports sent.
+// Usage: bench_repeat [--quick]
+
+#include "host_test.h"
+#include "hid_record.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+
+#define BENCH_REPEAT_NB       10000
+#define BENCH_REPEAT_NB_QUICK 100
+
+typedef struct {
+    const char* name;
+    const char* line;
+    size_t report_nb; // Reports sent by one repetition
+} BenchRepeatCase;
+
+static const BenchRepeatCase bench_repeat_cases[] = {
+    {"key combo", "CTRL-ALT DELETE", 2},
+    {"modifier chain", "CTRL SHIFT ALT GUI F5", 2},
+    {"string", "STRING hello", 7},
+    {"stringln", "STRINGLN the quick brown fox", 24},
+};
+
+// Backend that sends nothing, so only dispatch is measured
+static bool bench_hid_key(void* inst, uint16_t button) {
+    UNUSED(inst);
+    UNUSED(button);
+    return true;
+}
+
+static bool bench_hid_none(void* inst) {
+    UNUSED(inst);
+    return true;
+}
+
+static uint8_t bench_hid_led_state(void* inst) {
+    UNUSED(inst);
+    return 0;
+}
+
+static const BadUsbHidApi bench_hid = {
+    .kb_press = bench_hid_key,
+    .kb_release = bench_hid_key,
+    .kb_release_all = bench_hid_none,
+    .release_all = bench_hid_none,
+    .get_led_state = bench_hid_led_state,
+};
+
+static double bench_repeat_dispatch(
+    BadUsbScript* bad_usb,
+    const char* line,
+    bool reparse,
+    size_t repeat_nb) {
+    DuckyOp op;
+    host_test_check(ducky_parse_line(bad_usb, line, &op) == 0);
+    ducky_execute_op(bad_usb, &op); // Warm up
+    uint64_t start = host_bench_get_ns();
+    for(size_t i = 0; i < repeat_nb; i++) {
+        if(reparse) {
+            ducky_parse_line(bad_usb, line, &op);
+        }
+        ducky_execute_op(bad_usb, &op);
+    }
+    return (double)(host_bench_get_ns() - start) / repeat_nb;
+}
+
+// Whole script through the worker, every repetition must send the same reports
+static bool
+    bench_repeat_run(const BenchRepeatCase* repeat_case, size_t repeat_nb, double* time_ns) {
+    char script[128];
+    snprintf(script, sizeof(script), "%s\nREPEAT %zu\n", repeat_case->line, repeat_nb);
+    char name[32];
+    snprintf(name, sizeof(name), "repeat_%zu.txt", (size_t)(repeat_case - bench_repeat_cases));
+    FuriString* path = host_test_write_script(name, script, strlen(script));
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+
+    // Reports take no virtual time, STRING steps never end mid group and every repetition
+    // sends the same reports
+    hid_record_reset();
+    hid_record_set_poll_interval(0);
+    const HostTestEvent start_event = {0, HostTestEventStartStop};
+    uint64_t start = host_bench_get_ns();
+    bool state = (host_test_run_events(bad_usb, &start_event, 1) == BadUsbStateDone);
+    *time_ns = (double)(host_bench_get_ns() - start) / (repeat_nb + 1);
+    // The script end releases keyboard, consumer and mouse
+    size_t report_nb = repeat_case->report_nb * (repeat_nb + 1) + 3;
+    if(hid_record_get_report_nb() != report_nb) {
+        fprintf(
+            stderr,
+            "%s: %zu reports, expected %zu\n",
+            repeat_case->name,
+            hid_record_get_report_nb(),
+            report_nb);
+        state = false;
+    }
+
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    return state;
+}
+
+int main(int argc, char* argv[]) {
+    size_t repeat_nb = host_bench_is_quick(argc, argv) ? BENCH_REPEAT_NB_QUICK : BENCH_REPEAT_NB;
+
+    BadUsbScript* bad_usb = malloc(sizeof(BadUsbScript));
+    bad_usb->hid = &bench_hid;
+    memcpy(bad_usb->layout, hid_asciimap, sizeof(bad_usb->layout));
+
+    bool state = true;
+    printf("REPEAT %zu, ns per repetition   reparse   cached  speedup  worker run\n", repeat_nb);
+    for(size_t i = 0; i < COUNT_OF(bench_repeat_cases); i++) {
+        const BenchRepeatCase* repeat_case = &bench_repeat_cases[i];
+        double reparse = bench_repeat_dispatch(bad_usb, repeat_case->line, true, repeat_nb);
+        double cached = bench_repeat_dispatch(bad_usb, repeat_case->line, false, repeat_nb);
+        double run = 0;
+        bool run_state = bench_repeat_run(repeat_case, repeat_nb, &run);
+        printf(
+            "%-30s %8.1f %8.1f %7.1fx %11.1f%s\n",
+            repeat_case->name,
+            reparse,
+            cached,
+            reparse / cached,
+            run,
+            run_state ? "" : " FAILED");
+        state &= run_state;
+    }
+
+    free(bad_usb);
+    return state ? 0 : 1;
+}
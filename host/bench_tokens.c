@@ -0,0 +1,226 @@
+// Per-line dispatch cost of the perfect hash token lookup, against the linear scans it
+// replaced. Every line of the bundled scripts and every token name is classified both ways:
+// command, mouse button, modifier chain and main key, as ducky_parse_line does.
+// Usage: bench_tokens <scripts folder> [--quick]
+
+#include "host_test.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+
+// Baseline lookup runs on the name tables of the sources themselves, included here under
+// other names so they don't clash with the ones linked in
+#define ducky_parse_cmd                         bench_parse_cmd
+#define ducky_execute_op                        bench_execute_op
+#define ducky_get_token_len                     bench_get_token_len
+#define ducky_get_next_modifier_keycode_by_name bench_get_next_modifier_keycode_by_name
+#define ducky_get_modifier_keycode_by_name      bench_get_modifier_keycode_by_name
+#define ducky_get_keycode_by_name               bench_get_keycode_by_name
+#define ducky_get_media_keycode_by_name         bench_get_media_keycode_by_name
+#define ducky_get_mouse_keycode_by_name         bench_get_mouse_keycode_by_name
+int32_t ducky_parse_cmd(BadUsbScript* bad_usb, const char* line, DuckyOp* op);
+int32_t ducky_execute_op(BadUsbScript* bad_usb, const DuckyOp* op);
+size_t ducky_get_token_len(const char* param, bool modifier);
+uint16_t ducky_get_next_modifier_keycode_by_name(const char** param);
+uint16_t ducky_get_modifier_keycode_by_name(const char* param);
+uint16_t ducky_get_keycode_by_name(const char* param);
+uint16_t ducky_get_media_keycode_by_name(const char* param);
+uint8_t ducky_get_mouse_keycode_by_name(const char* param);
+#include "../bad_usb/helpers/ducky_script_commands.c"
+#include "../bad_usb/helpers/ducky_script_keycodes.c"
+#undef ducky_parse_cmd
+#undef ducky_execute_op
+#undef ducky_get_token_len
+#undef ducky_get_next_modifier_keycode_by_name
+#undef ducky_get_modifier_keycode_by_name
+#undef ducky_get_keycode_by_name
+#undef ducky_get_media_keycode_by_name
+#undef ducky_get_mouse_keycode_by_name
+
+#define BENCH_LINE_NB_MAX 4096
+#define BENCH_ROUNDS       2000
+#define BENCH_ROUNDS_QUICK 20
+
+typedef struct {
+    int32_t cmd;
+    uint16_t mouse;
+    uint16_t modifiers;
+    uint16_t key;
+} BenchClass;
+
+static const DuckyKey* legacy_find(const DuckyKey* keys, size_t key_nb, const char* param) {
+    for(size_t i = 0; i < key_nb; i++) {
+        size_t key_cmd_len = strlen(keys[i].name);
+        if((strncmp(param, keys[i].name, key_cmd_len) == 0) &&
+           (ducky_is_line_end(param[key_cmd_len]))) {
+            return &keys[i];
+        }
+    }
+    return NULL;
+}
+
+static void legacy_classify(const char* line, BenchClass* class) {
+    memset(class, 0, sizeof(BenchClass));
+    class->cmd = -1;
+
+    size_t cmd_word_len = strcspn(line, " ");
+    for(size_t i = 0; i < COUNT_OF(ducky_commands); i++) {
+        size_t cmd_compare_len = strlen(ducky_commands[i].name);
+        if(cmd_compare_len != cmd_word_len) continue;
+        if(strncmp(line, ducky_commands[i].name, cmd_compare_len) == 0) {
+            class->cmd = i;
+            return;
+        }
+    }
+
+    const DuckyKey* key = legacy_find(ducky_mouse_keys, COUNT_OF(ducky_mouse_keys), line);
+    if(key) {
+        class->mouse = key->keycode;
+        return;
+    }
+
+    while(1) {
+        const DuckyKey* modifier = NULL;
+        for(size_t i = 0; i < COUNT_OF(ducky_modifier_keys); i++) {
+            size_t key_cmd_len = strlen(ducky_modifier_keys[i].name);
+            if((strncmp(line, ducky_modifier_keys[i].name, key_cmd_len) == 0) &&
+               (ducky_is_line_end(line[key_cmd_len]) || (line[key_cmd_len] == '-'))) {
+                modifier = &ducky_modifier_keys[i];
+                line += key_cmd_len;
+                break;
+            }
+        }
+        if(modifier == NULL) break;
+        class->modifiers |= modifier->keycode;
+        if((*line == ' ') || (*line == '-')) line++;
+    }
+
+    key = legacy_find(ducky_keys, COUNT_OF(ducky_keys), line);
+    class->key = key ? key->keycode : HID_KEYBOARD_NONE;
+}
+
+static void hash_classify(const char* line, BenchClass* class) {
+    memset(class, 0, sizeof(BenchClass));
+    class->cmd = -1;
+
+    const DuckyToken* token = ducky_get_token(line, strcspn(line, " "));
+    if(token && (token->cmd != DUCKY_TOKEN_NONE)) {
+        class->cmd = token->cmd;
+        return;
+    }
+
+    class->mouse = ducky_get_mouse_keycode_by_name(line);
+    if(class->mouse != HID_MOUSE_INVALID) return;
+
+    while(1) {
+        uint16_t modifier = ducky_get_next_modifier_keycode_by_name(&line);
+        if(modifier == HID_KEYBOARD_NONE) break;
+        class->modifiers |= modifier;
+        if((*line == ' ') || (*line == '-')) line++;
+    }
+
+    class->key = ducky_get_keycode_by_name(line);
+}
+
+static size_t bench_add_names(const DuckyKey* keys, size_t key_nb, char** lines, size_t line_nb) {
+    for(size_t i = 0; (i < key_nb) && (line_nb < BENCH_LINE_NB_MAX); i++) {
+        lines[line_nb++] = strdup(keys[i].name);
+    }
+    return line_nb;
+}
+
+static size_t bench_add_script(const char* path, char** lines, size_t line_nb) {
+    FILE* file = fopen(path, "r");
+    host_test_check(file != NULL);
+    char text[DUCKY_LINE_LEN_MAX + 2];
+    while(fgets(text, sizeof(text), file) && (line_nb < BENCH_LINE_NB_MAX)) {
+        text[strcspn(text, "\r\n")] = '\0';
+        if(text[0] != '\0') lines[line_nb++] = strdup(text);
+    }
+    fclose(file);
+    return line_nb;
+}
+
+static double bench_run(
+    void (*classify)(const char*, BenchClass*),
+    char** lines,
+    size_t line_nb,
+    size_t rounds) {
+    volatile uint32_t sink = 0;
+    BenchClass class;
+    uint64_t start = host_bench_get_ns();
+    for(size_t round = 0; round < rounds; round++) {
+        for(size_t i = 0; i < line_nb; i++) {
+            classify(lines[i], &class);
+            sink += class.cmd + class.key;
+        }
+    }
+    (void)sink;
+    return (double)(host_bench_get_ns() - start) / (double)(rounds * line_nb);
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <scripts folder> [--quick]\n", argv[0]);
+        return 2;
+    }
+
+    static const char* scripts[] = {
+        "demo_windows.txt",
+        "demo_macos.txt",
+        "demo_gnome.txt",
+        "demo_chromeos.txt",
+        "test_mouse.txt",
+    };
+    static char* lines[BENCH_LINE_NB_MAX];
+    size_t line_nb = 0;
+    for(size_t i = 0; i < COUNT_OF(scripts); i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", argv[1], scripts[i]);
+        line_nb = bench_add_script(path, lines, line_nb);
+    }
+    size_t script_line_nb = line_nb;
+    for(size_t i = 0; i < COUNT_OF(ducky_commands); i++) {
+        lines[line_nb++] = strdup(ducky_commands[i].name);
+    }
+    line_nb = bench_add_names(ducky_modifier_keys, COUNT_OF(ducky_modifier_keys), lines, line_nb);
+    line_nb = bench_add_names(ducky_keys, COUNT_OF(ducky_keys), lines, line_nb);
+    line_nb = bench_add_names(ducky_mouse_keys, COUNT_OF(ducky_mouse_keys), lines, line_nb);
+
+    // Both lookups must agree before their speed means anything
+    for(size_t i = 0; i < line_nb; i++) {
+        BenchClass legacy;
+        BenchClass hash;
+        legacy_classify(lines[i], &legacy);
+        hash_classify(lines[i], &hash);
+        if(memcmp(&legacy, &hash, sizeof(BenchClass)) != 0) {
+            fprintf(stderr, "lookups differ on \"%s\"\n", lines[i]);
+            return 1;
+        }
+    }
+
+    size_t rounds = host_bench_is_quick(argc, argv) ? BENCH_ROUNDS_QUICK : BENCH_ROUNDS;
+    double script_legacy = bench_run(legacy_classify, lines, script_line_nb, rounds);
+    double script_hash = bench_run(hash_classify, lines, script_line_nb, rounds);
+    double names_legacy =
+        bench_run(legacy_classify, &lines[script_line_nb], line_nb - script_line_nb, rounds);
+    double names_hash =
+        bench_run(hash_classify, &lines[script_line_nb], line_nb - script_line_nb, rounds);
+
+    printf("token dispatch, ns per line     linear     hash  speedup\n");
+    printf(
+        "script lines (%4zu)          %9.1f %8.1f %7.1fx\n",
+        script_line_nb,
+        script_legacy,
+        script_hash,
+        script_legacy / script_hash);
+    printf(
+        "token names  (%4zu)          %9.1f %8.1f %7.1fx\n",
+        line_nb - script_line_nb,
+        names_legacy,
+        names_hash,
+        names_legacy / names_hash);
+
+    for(size_t i = 0; i < line_nb; i++) {
+        free(lines[i]);
+    }
+    return 0;
+}
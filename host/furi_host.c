@@ -0,0 +1,450 @@
+#include <furi.h>
+#include <furi_hal_cortex.h>
+#include <pthread.h>
+
+#undef malloc
+
+// Threads run on a large stack, their use is measured against the stack the target gives them.
+// Host frames hold 8 byte pointers and glibc calls, taken as twice the target's
+#define HOST_STACK_SIZE  (256 * 1024)
+#define HOST_STACK_SCALE 2
+#define HOST_STACK_PAINT 0xA5
+#define HOST_CPU_MHZ     64
+#define HOST_EVENT_MAX   64
+
+struct FuriThread {
+    const char* name;
+    FuriThreadCallback callback;
+    void* context;
+    pthread_t pthread;
+    uint8_t* stack;
+    size_t stack_size; // Stack the target allocates
+    size_t stack_base; // Host stack taken before the callback runs, by TLS and the thread entry
+    bool started;
+    bool done;
+    uint32_t flags;
+    uint32_t wait_mask; // Flags the thread is waiting for, 0 when it is not blocked
+    bool wait_forever;
+    size_t alloc_nb;
+};
+
+static pthread_mutex_t furi_host_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t furi_host_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t furi_host_tick;
+static uint32_t furi_host_wake_latency;
+static FuriThread furi_host_main_thread = {.name = "main"};
+static __thread FuriThread* furi_host_current;
+static FuriHostLogHandler furi_host_log_handler;
+
+static FuriHostEvent furi_host_events[HOST_EVENT_MAX]; // Sorted by tick
+static size_t furi_host_event_nb;
+
+void* furi_host_malloc(size_t size) {
+    furi_thread_get_current_id()->alloc_nb++;
+    void* ptr = calloc(1, size ? size : 1);
+    if(ptr == NULL) furi_crash("out of memory");
+    return ptr;
+}
+
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t len = strlen(src);
+    if(size > 0) {
+        size_t copy_len = MIN(len, size - 1);
+        memcpy(dst, src, copy_len);
+        dst[copy_len] = '\0';
+    }
+    return len;
+}
+
+void furi_crash(const char* message) {
+    fprintf(stderr, "furi_crash: %s\n", message);
+    abort();
+}
+
+// Log
+
+static pthread_once_t furi_host_log_once = PTHREAD_ONCE_INIT;
+static bool furi_host_log_stderr;
+
+static void furi_host_log_init(void) {
+    furi_host_log_stderr = (getenv("BADUSB_HOST_LOG") != NULL);
+}
+
+void furi_host_log_set_handler(FuriHostLogHandler handler) {
+    furi_host_log_handler = handler;
+}
+
+void furi_log_print_format(FuriLogLevel level, const char* tag, const char* format, ...) {
+    // Formatted only when someone reads it, as the firmware skips filtered levels
+    pthread_once(&furi_host_log_once, furi_host_log_init);
+    if(!furi_host_log_handler && !furi_host_log_stderr) return;
+
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if(furi_host_log_handler) {
+        furi_host_log_handler(level, tag, text);
+    } else {
+        fprintf(stderr, "%7u [%s] %s\n", furi_get_tick(), tag, text);
+    }
+}
+
+// Kernel
+
+uint32_t furi_get_tick(void) {
+    pthread_mutex_lock(&furi_host_lock);
+    uint32_t tick = furi_host_tick;
+    pthread_mutex_unlock(&furi_host_lock);
+    return tick;
+}
+
+void furi_host_clock_reset(void) {
+    pthread_mutex_lock(&furi_host_lock);
+    furi_host_tick = 0;
+    pthread_mutex_unlock(&furi_host_lock);
+}
+
+void furi_host_clock_advance(uint32_t milliseconds) {
+    pthread_mutex_lock(&furi_host_lock);
+    furi_host_tick += milliseconds;
+    pthread_mutex_unlock(&furi_host_lock);
+}
+
+void furi_host_clock_set_wake_latency(uint32_t milliseconds) {
+    pthread_mutex_lock(&furi_host_lock);
+    furi_host_wake_latency = milliseconds;
+    pthread_mutex_unlock(&furi_host_lock);
+}
+
+void furi_host_event_schedule(const FuriHostEvent* events, size_t event_nb) {
+    pthread_mutex_lock(&furi_host_lock);
+    furi_check(furi_host_event_nb + event_nb <= HOST_EVENT_MAX);
+    for(size_t i = 0; i < event_nb; i++) {
+        // Events of the same tick fire in the order they were scheduled
+        size_t pos = furi_host_event_nb;
+        while((pos > 0) && ((int32_t)(furi_host_events[pos - 1].tick - events[i].tick) > 0)) {
+            furi_host_events[pos] = furi_host_events[pos - 1];
+            pos--;
+        }
+        furi_host_events[pos] = events[i];
+        furi_host_event_nb++;
+    }
+    pthread_cond_broadcast(&furi_host_cond);
+    pthread_mutex_unlock(&furi_host_lock);
+}
+
+void furi_host_event_clear(void) {
+    pthread_mutex_lock(&furi_host_lock);
+    furi_host_event_nb = 0;
+    pthread_mutex_unlock(&furi_host_lock);
+}
+
+// Fires the first event due by until, any event when wait_forever is set. Called with the
+// lock held, which is released while the callback runs as it sets flags or sends reports.
+static bool furi_host_event_fire(uint32_t until, bool wait_forever) {
+    // The main thread drives the test, only the threads it started follow the clock
+    if((furi_host_current == NULL) || (furi_host_event_nb == 0)) return false;
+    FuriHostEvent event = furi_host_events[0];
+    if(!wait_forever && ((int32_t)(event.tick - until) > 0)) return false;
+
+    furi_host_event_nb--;
+    memmove(
+        &furi_host_events[0], &furi_host_events[1], furi_host_event_nb * sizeof(FuriHostEvent));
+    if((int32_t)(event.tick - furi_host_tick) > 0) furi_host_tick = event.tick;
+    pthread_mutex_unlock(&furi_host_lock);
+    event.callback(event.context);
+    pthread_mutex_lock(&furi_host_lock);
+    return true;
+}
+
+void furi_delay_ms(uint32_t milliseconds) {
+    furi_host_clock_advance(milliseconds);
+}
+
+FuriHalCortexTimer furi_hal_cortex_timer_get(uint32_t timeout_us) {
+    FuriHalCortexTimer timer = {
+        .start = furi_get_tick() * 1000 * HOST_CPU_MHZ,
+        .value = timeout_us * HOST_CPU_MHZ,
+    };
+    return timer;
+}
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void) {
+    return HOST_CPU_MHZ;
+}
+
+// Threads
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    FuriThread* thread = furi_host_malloc(sizeof(FuriThread));
+    thread->name = name;
+    thread->stack_size = stack_size;
+    thread->callback = callback;
+    thread->context = context;
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    furi_check(!thread->started || thread->done);
+    free(thread->stack);
+    free(thread);
+}
+
+static void* furi_host_thread_body(void* context) {
+    FuriThread* thread = context;
+    furi_host_current = thread;
+    thread->stack_base =
+        HOST_STACK_SIZE - ((uint8_t*)__builtin_frame_address(0) - thread->stack);
+    thread->callback(thread->context);
+
+    pthread_mutex_lock(&furi_host_lock);
+    thread->done = true;
+    pthread_cond_broadcast(&furi_host_cond);
+    pthread_mutex_unlock(&furi_host_lock);
+    return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+    // Painted so the unused part can be measured, as on the target
+    thread->stack = furi_host_malloc(HOST_STACK_SIZE);
+    memset(thread->stack, HOST_STACK_PAINT, HOST_STACK_SIZE);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, thread->stack, HOST_STACK_SIZE);
+    thread->started = true;
+    furi_check(pthread_create(&thread->pthread, &attr, furi_host_thread_body, thread) == 0);
+    pthread_attr_destroy(&attr);
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    furi_check(thread->started);
+    pthread_join(thread->pthread, NULL);
+    return true;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+FuriThreadId furi_thread_get_current_id(void) {
+    return furi_host_current ? furi_host_current : &furi_host_main_thread;
+}
+
+// Space left out of the stack size the target gives the thread, in host bytes, 0 once it is
+// used up
+size_t furi_thread_get_stack_space(FuriThreadId thread_id) {
+    if(thread_id->stack == NULL) return 0;
+    size_t space = 0;
+    while((space < HOST_STACK_SIZE) && (thread_id->stack[space] == HOST_STACK_PAINT)) {
+        space++;
+    }
+    size_t used = HOST_STACK_SIZE - space - thread_id->stack_base;
+    size_t size = thread_id->stack_size * HOST_STACK_SCALE;
+    return (used < size) ? (size - used) : 0;
+}
+
+size_t furi_host_thread_get_alloc_nb(FuriThreadId thread_id) {
+    return thread_id->alloc_nb;
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    pthread_mutex_lock(&furi_host_lock);
+    thread_id->flags |= flags;
+    uint32_t state = thread_id->flags;
+    pthread_cond_broadcast(&furi_host_cond);
+    pthread_mutex_unlock(&furi_host_lock);
+    return state;
+}
+
+uint32_t furi_thread_flags_clear(uint32_t flags) {
+    FuriThread* thread = furi_thread_get_current_id();
+    pthread_mutex_lock(&furi_host_lock);
+    uint32_t state = thread->flags;
+    thread->flags &= ~flags;
+    pthread_mutex_unlock(&furi_host_lock);
+    return state;
+}
+
+uint32_t furi_thread_flags_get(void) {
+    FuriThread* thread = furi_thread_get_current_id();
+    pthread_mutex_lock(&furi_host_lock);
+    furi_host_event_fire(furi_host_tick, false);
+    uint32_t state = thread->flags;
+    pthread_mutex_unlock(&furi_host_lock);
+    return state;
+}
+
+static bool furi_host_flags_ready(FuriThread* thread, uint32_t flags, uint32_t options) {
+    if(options & FuriFlagWaitAll) return (thread->flags & flags) == flags;
+    return (thread->flags & flags) != 0;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    FuriThread* thread = furi_thread_get_current_id();
+    uint32_t result = FuriFlagErrorTimeout;
+
+    pthread_mutex_lock(&furi_host_lock);
+    uint32_t deadline = furi_host_tick + timeout;
+    while(!furi_host_flags_ready(thread, flags, options)) {
+        if(timeout == 0) {
+            if(furi_host_event_fire(furi_host_tick, false)) continue;
+            result = FuriFlagErrorResource;
+            break;
+        } else if(timeout != FuriWaitForever) {
+            if(furi_host_event_fire(deadline, false)) continue;
+            // Nobody else runs while the worker is busy, the wait simply ends on time
+            if((int32_t)(deadline - furi_host_tick) > 0) {
+                furi_host_tick = deadline + furi_host_wake_latency;
+            }
+            break;
+        } else if(furi_host_event_fire(0, true)) {
+            continue;
+        }
+        thread->wait_mask = flags;
+        thread->wait_forever = true;
+        pthread_cond_broadcast(&furi_host_cond);
+        pthread_cond_wait(&furi_host_cond, &furi_host_lock);
+        // Not idle while it looks at what woke it up, an event may be fired next
+        thread->wait_mask = 0;
+        thread->wait_forever = false;
+    }
+
+    if(furi_host_flags_ready(thread, flags, options)) {
+        result = thread->flags & flags;
+        if(!(options & FuriFlagNoClear)) {
+            thread->flags &= ~flags;
+        }
+    }
+    pthread_mutex_unlock(&furi_host_lock);
+    return result;
+}
+
+void furi_host_thread_wait_idle(FuriThread* thread) {
+    pthread_mutex_lock(&furi_host_lock);
+    while(!thread->done) {
+        bool blocked = thread->wait_forever && ((thread->flags & thread->wait_mask) == 0);
+        if(blocked && (furi_host_event_nb == 0)) break;
+        pthread_cond_wait(&furi_host_cond, &furi_host_lock);
+    }
+    pthread_mutex_unlock(&furi_host_lock);
+}
+
+// Records
+
+void* furi_record_open(const char* name) {
+    return (void*)name; // Services are stateless on the host
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+// Strings
+
+struct FuriString {
+    char* data;
+    size_t size;
+    size_t capacity;
+};
+
+static void furi_string_reserve(FuriString* string, size_t size) {
+    if(size + 1 <= string->capacity) return;
+    string->capacity = MAX(size + 1, string->capacity * 2);
+    string->data = realloc(string->data, string->capacity);
+    furi_check(string->data);
+}
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = furi_host_malloc(sizeof(FuriString));
+    furi_string_reserve(string, 16);
+    string->data[0] = '\0';
+    return string;
+}
+
+FuriString* furi_string_alloc_set_str(const char* cstr) {
+    FuriString* string = furi_string_alloc();
+    furi_string_set_str(string, cstr);
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    free(string->data);
+    free(string);
+}
+
+void furi_string_reset(FuriString* string) {
+    string->size = 0;
+    string->data[0] = '\0';
+}
+
+void furi_string_set_strn(FuriString* string, const char* cstr, size_t n) {
+    furi_string_reserve(string, n);
+    memmove(string->data, cstr, n);
+    string->size = n;
+    string->data[n] = '\0';
+}
+
+void furi_string_set_str(FuriString* string, const char* cstr) {
+    furi_string_set_strn(string, cstr, strlen(cstr));
+}
+
+void furi_string_set(FuriString* string, FuriString* source) {
+    furi_string_set_strn(string, source->data, source->size);
+}
+
+void furi_string_cat_str(FuriString* string, const char* cstr) {
+    size_t len = strlen(cstr);
+    furi_string_reserve(string, string->size + len);
+    memcpy(&string->data[string->size], cstr, len + 1);
+    string->size += len;
+}
+
+int furi_string_cat_vprintf(FuriString* string, const char format[], va_list args) {
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+    if(len < 0) return len;
+
+    furi_string_reserve(string, string->size + len);
+    vsnprintf(&string->data[string->size], len + 1, format, args);
+    string->size += len;
+    return len;
+}
+
+int furi_string_cat_printf(FuriString* string, const char format[], ...) {
+    va_list args;
+    va_start(args, format);
+    int len = furi_string_cat_vprintf(string, format, args);
+    va_end(args);
+    return len;
+}
+
+int furi_string_printf(FuriString* string, const char format[], ...) {
+    furi_string_reset(string);
+    va_list args;
+    va_start(args, format);
+    int len = furi_string_cat_vprintf(string, format, args);
+    va_end(args);
+    return len;
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->data;
+}
+
+size_t furi_string_size(const FuriString* string) {
+    return string->size;
+}
+
+bool furi_string_empty(const FuriString* string) {
+    return string->size == 0;
+}
@@ -0,0 +1,335 @@
+#include "hid_record.h"
+#include "../bad_usb/helpers/bad_usb_hid.h"
+#include <pthread.h>
+
+typedef struct {
+    uint8_t mods;
+    uint8_t keys[HID_KB_MAX_KEYS];
+    uint8_t mouse_btn;
+    uint16_t consumer[HID_CONSUMER_MAX_KEYS];
+    uint8_t led_state;
+
+    bool connected;
+    uint32_t connect_tick;
+    uint32_t ready_delay;
+    bool probe_done; // Readiness is reported once per connection
+    uint32_t poll_interval;
+    HidStateCallback state_callback;
+    void* callback_context;
+
+    FuriString* log;
+    size_t report_nb;
+    size_t led_query_nb;
+} HidRecord;
+
+static HidRecord hid_record = {.connected = true, .poll_interval = HID_RECORD_POLL_INTERVAL};
+static pthread_mutex_t hid_record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void hid_record_vprintf(const char* format, va_list args) {
+    pthread_mutex_lock(&hid_record_lock);
+    if(hid_record.log == NULL) hid_record.log = furi_string_alloc();
+    furi_string_cat_printf(hid_record.log, "%7u ", furi_get_tick());
+    furi_string_cat_vprintf(hid_record.log, format, args);
+    furi_string_cat_str(hid_record.log, "\n");
+    pthread_mutex_unlock(&hid_record_lock);
+}
+
+void hid_record_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    hid_record_vprintf(format, args);
+    va_end(args);
+}
+
+void hid_record_reset(void) {
+    pthread_mutex_lock(&hid_record_lock);
+    if(hid_record.log == NULL) hid_record.log = furi_string_alloc();
+    furi_string_reset(hid_record.log);
+    FuriString* log = hid_record.log;
+    HidStateCallback state_callback = hid_record.state_callback;
+    void* callback_context = hid_record.callback_context;
+    memset(&hid_record, 0, sizeof(hid_record));
+    hid_record.log = log;
+    hid_record.state_callback = state_callback;
+    hid_record.callback_context = callback_context;
+    hid_record.connected = true;
+    hid_record.poll_interval = HID_RECORD_POLL_INTERVAL;
+    pthread_mutex_unlock(&hid_record_lock);
+}
+
+const char* hid_record_get_log(void) {
+    if(hid_record.log == NULL) return "";
+    return furi_string_get_cstr(hid_record.log);
+}
+
+size_t hid_record_get_report_nb(void) {
+    return hid_record.report_nb;
+}
+
+size_t hid_record_get_led_query_nb(void) {
+    return hid_record.led_query_nb;
+}
+
+void hid_record_set_poll_interval(uint32_t interval_ms) {
+    hid_record.poll_interval = interval_ms;
+}
+
+void hid_record_set_ready_delay(uint32_t delay_ms) {
+    hid_record.ready_delay = delay_ms;
+}
+
+void hid_record_set_connected(bool connected) {
+    if(hid_record.connected == connected) return;
+    hid_record.connected = connected;
+    hid_record.connect_tick = furi_get_tick();
+    hid_record.probe_done = false;
+    hid_record_printf(connected ? "connected" : "disconnected");
+    if(hid_record.state_callback) {
+        hid_record.state_callback(connected, hid_record.callback_context);
+    }
+}
+
+// Host side of the link: lock keys toggle their LED when pressed
+static void hid_record_update_leds(uint8_t key) {
+    if((key == HID_KEYBOARD_LOCK_NUM_LOCK) || (key == HID_KEYPAD_NUMLOCK)) {
+        hid_record.led_state ^= HID_KB_LED_NUM;
+    } else if(key == HID_KEYBOARD_CAPS_LOCK) {
+        hid_record.led_state ^= HID_KB_LED_CAPS;
+    } else if(key == HID_KEYBOARD_SCROLL_LOCK) {
+        hid_record.led_state ^= HID_KB_LED_SCROLL;
+    }
+}
+
+static bool hid_record_send(const char* format, ...) {
+    if(!hid_record.connected) return false;
+
+    va_list args;
+    va_start(args, format);
+    hid_record_vprintf(format, args);
+    va_end(args);
+    hid_record.report_nb++;
+    furi_host_clock_advance(hid_record.poll_interval);
+    return true;
+}
+
+static bool hid_record_send_kb(void) {
+    return hid_record_send(
+        "kb %02X %02X %02X %02X %02X %02X %02X",
+        hid_record.mods,
+        hid_record.keys[0],
+        hid_record.keys[1],
+        hid_record.keys[2],
+        hid_record.keys[3],
+        hid_record.keys[4],
+        hid_record.keys[5]);
+}
+
+static bool hid_record_send_mouse(int8_t dx, int8_t dy, int8_t wheel) {
+    return hid_record_send("mouse %02X %d %d %d", hid_record.mouse_btn, dx, dy, wheel);
+}
+
+static bool hid_record_send_consumer(void) {
+    return hid_record_send(
+        "consumer %04X %04X", hid_record.consumer[0], hid_record.consumer[1]);
+}
+
+static void* hid_record_init(FuriHalUsbHidConfig* hid_cfg) {
+    if(hid_cfg) {
+        hid_record_printf(
+            "usb %04lX:%04lX \"%s\" \"%s\"",
+            hid_cfg->vid,
+            hid_cfg->pid,
+            hid_cfg->manuf,
+            hid_cfg->product);
+    } else {
+        hid_record_printf("usb default");
+    }
+    hid_record.connect_tick = furi_get_tick();
+    return &hid_record;
+}
+
+static void hid_record_deinit(void* inst) {
+    UNUSED(inst);
+    hid_record_printf("usb off");
+}
+
+static void hid_record_set_state_callback(void* inst, HidStateCallback cb, void* context) {
+    UNUSED(inst);
+    hid_record.state_callback = cb;
+    hid_record.callback_context = context;
+}
+
+static bool hid_record_is_connected(void* inst) {
+    UNUSED(inst);
+    return hid_record.connected;
+}
+
+static bool hid_record_kb_release_all(void* inst);
+
+static bool hid_record_is_ready(void* inst) {
+    if(hid_record.ready_delay == HID_RECORD_NEVER_READY) return false;
+    if(hid_record.probe_done) return false;
+    if((int32_t)(furi_get_tick() - hid_record.connect_tick) < (int32_t)hid_record.ready_delay) {
+        return false;
+    }
+    // Same two reports as the USB interface, the second one is queued once the host polled
+    hid_record.probe_done = true;
+    return hid_record_kb_release_all(inst) && hid_record_kb_release_all(inst);
+}
+
+static bool hid_record_kb_press(void* inst, uint16_t button) {
+    UNUSED(inst);
+    for(size_t i = 0; i < HID_KB_MAX_KEYS; i++) {
+        if(hid_record.keys[i] == 0) {
+            hid_record.keys[i] = button & 0xFF;
+            break;
+        }
+    }
+    hid_record.mods |= (button >> 8);
+    hid_record_update_leds(button & 0xFF);
+    return hid_record_send_kb();
+}
+
+static bool hid_record_kb_release(void* inst, uint16_t button) {
+    UNUSED(inst);
+    for(size_t i = 0; i < HID_KB_MAX_KEYS; i++) {
+        if(hid_record.keys[i] == (button & 0xFF)) {
+            hid_record.keys[i] = 0;
+            break;
+        }
+    }
+    hid_record.mods &= ~(button >> 8);
+    return hid_record_send_kb();
+}
+
+static bool hid_record_kb_release_all(void* inst) {
+    UNUSED(inst);
+    memset(hid_record.keys, 0, sizeof(hid_record.keys));
+    hid_record.mods = 0;
+    return hid_record_send_kb();
+}
+
+static bool hid_record_mouse_press(void* inst, uint8_t button) {
+    UNUSED(inst);
+    hid_record.mouse_btn |= button;
+    return hid_record_send_mouse(0, 0, 0);
+}
+
+static bool hid_record_mouse_release(void* inst, uint8_t button) {
+    UNUSED(inst);
+    hid_record.mouse_btn &= ~button;
+    return hid_record_send_mouse(0, 0, 0);
+}
+
+static bool hid_record_mouse_scroll(void* inst, int8_t delta) {
+    UNUSED(inst);
+    return hid_record_send_mouse(0, 0, delta);
+}
+
+static bool hid_record_mouse_move(void* inst, int8_t dx, int8_t dy) {
+    UNUSED(inst);
+    return hid_record_send_mouse(dx, dy, 0);
+}
+
+static bool hid_record_consumer_press(void* inst, uint16_t button) {
+    UNUSED(inst);
+    for(size_t i = 0; i < HID_CONSUMER_MAX_KEYS; i++) {
+        if(hid_record.consumer[i] == 0) {
+            hid_record.consumer[i] = button;
+            break;
+        }
+    }
+    return hid_record_send_consumer();
+}
+
+static bool hid_record_consumer_release(void* inst, uint16_t button) {
+    UNUSED(inst);
+    for(size_t i = 0; i < HID_CONSUMER_MAX_KEYS; i++) {
+        if(hid_record.consumer[i] == button) {
+            hid_record.consumer[i] = 0;
+            break;
+        }
+    }
+    return hid_record_send_consumer();
+}
+
+static bool hid_record_release_all(void* inst) {
+    bool state = hid_record_kb_release_all(inst);
+    memset(hid_record.consumer, 0, sizeof(hid_record.consumer));
+    state &= hid_record_send_consumer();
+    state &= hid_record_mouse_release(inst, 0);
+    return state;
+}
+
+static uint8_t hid_record_get_led_state(void* inst) {
+    UNUSED(inst);
+    hid_record.led_query_nb++;
+    return hid_record.led_state;
+}
+
+static const BadUsbHidApi hid_api_record = {
+    .init = hid_record_init,
+    .deinit = hid_record_deinit,
+    .set_state_callback = hid_record_set_state_callback,
+    .is_connected = hid_record_is_connected,
+    .is_ready = hid_record_is_ready,
+
+    .kb_press = hid_record_kb_press,
+    .kb_release = hid_record_kb_release,
+    .kb_release_all = hid_record_kb_release_all,
+    .mouse_press = hid_record_mouse_press,
+    .mouse_release = hid_record_mouse_release,
+    .mouse_scroll = hid_record_mouse_scroll,
+    .mouse_move = hid_record_mouse_move,
+    .consumer_press = hid_record_consumer_press,
+    .consumer_release = hid_record_consumer_release,
+    .release_all = hid_record_release_all,
+    .get_led_state = hid_record_get_led_state,
+};
+
+// USB and BLE both end up in the recorder
+const BadUsbHidApi* bad_usb_hid_get_interface(BadUsbHidInterface interface) {
+    UNUSED(interface);
+    return &hid_api_record;
+}
+
+struct BadUsbHidSession {
+    bool started;
+    bool cfg_set;
+    FuriHalUsbHidConfig cfg;
+};
+
+BadUsbHidSession* bad_usb_hid_session_alloc(void) {
+    return malloc(sizeof(BadUsbHidSession));
+}
+
+void bad_usb_hid_session_free(BadUsbHidSession* session) {
+    bad_usb_hid_session_stop(session);
+    free(session);
+}
+
+void* bad_usb_hid_session_start(
+    BadUsbHidSession* session,
+    BadUsbHidInterface interface,
+    FuriHalUsbHidConfig* hid_cfg) {
+    UNUSED(interface);
+    bool same_cfg = (hid_cfg == NULL) ?
+                        !session->cfg_set :
+                        (session->cfg_set && !memcmp(&session->cfg, hid_cfg, sizeof(*hid_cfg)));
+    if(session->started && same_cfg) return &hid_record;
+
+    bad_usb_hid_session_stop(session);
+    session->started = true;
+    session->cfg_set = (hid_cfg != NULL);
+    if(hid_cfg) session->cfg = *hid_cfg;
+    return hid_api_record.init(hid_cfg);
+}
+
+void bad_usb_hid_session_stop(BadUsbHidSession* session) {
+    if(!session->started) return;
+    hid_api_record.deinit(&hid_record);
+    session->started = false;
+}
+
+void bad_usb_hid_ble_remove_pairing(void) {
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// Recording HID backend for the host build. It stands for the USB interface: every report
+// the interpreter sends is logged with its virtual timestamp, then the clock moves by one
+// host polling interval, as the report would wait that long in the interrupt endpoint
+
+#include <furi.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_RECORD_POLL_INTERVAL 1 // ms, full speed keyboards are polled every 1 to 10 ms
+
+// Clears the log and the report state, the host is connected and ready again
+void hid_record_reset(void);
+
+// Log of the run, one line per event: "<tick> <event>"
+const char* hid_record_get_log(void);
+
+size_t hid_record_get_report_nb(void);
+
+// get_led_state calls since the last reset
+size_t hid_record_get_led_query_nb(void);
+
+void hid_record_set_poll_interval(uint32_t interval_ms);
+
+// Calls the interpreter state callback as the USB stack would
+void hid_record_set_connected(bool connected);
+
+#define HID_RECORD_NEVER_READY UINT32_MAX
+
+// Time the host needs after enumeration before it polls the keyboard, HID_RECORD_NEVER_READY
+// for a host that doesn't poll it at all
+void hid_record_set_ready_delay(uint32_t delay_ms);
+
+// Adds a line to the log, for events that aren't reports
+void hid_record_printf(const char* format, ...);
+
+#ifdef __cplusplus
+}
+#endif
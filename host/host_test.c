@@ -0,0 +1,215 @@
+#include "host_test.h"
+#include "hid_record.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+#include <time.h>
+#include <unistd.h>
+
+static char host_test_dir[256];
+
+static void host_test_remove_dir(void) {
+    char cmd[300];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", host_test_dir);
+    if(system(cmd) != 0) {
+        fprintf(stderr, "can't remove %s\n", host_test_dir);
+    }
+}
+
+const char* host_test_get_dir(void) {
+    if(host_test_dir[0] == '\0') {
+        const char* tmp = getenv("TMPDIR");
+        snprintf(host_test_dir, sizeof(host_test_dir), "%s/badusb_XXXXXX", tmp ? tmp : "/tmp");
+        furi_check(mkdtemp(host_test_dir) != NULL);
+        storage_host_set_root(host_test_dir);
+        atexit(host_test_remove_dir);
+    }
+    return host_test_dir;
+}
+
+FuriString* host_test_write_script(const char* name, const char* text, size_t len) {
+    FuriString* path = furi_string_alloc();
+    furi_string_printf(path, "%s/%s", host_test_get_dir(), name);
+    FILE* file = fopen(furi_string_get_cstr(path), "wb");
+    furi_check(file);
+    furi_check(fwrite(text, 1, len, file) == len);
+    fclose(file);
+    return path;
+}
+
+FuriString* host_test_copy_script(const char* src_path) {
+    FILE* src = fopen(src_path, "rb");
+    if(src == NULL) {
+        fprintf(stderr, "can't open %s\n", src_path);
+        exit(1);
+    }
+    fseek(src, 0, SEEK_END);
+    size_t len = ftell(src);
+    fseek(src, 0, SEEK_SET);
+    char* text = malloc(len + 1);
+    furi_check(fread(text, 1, len, src) == len);
+    fclose(src);
+
+    const char* name = strrchr(src_path, '/');
+    FuriString* path = host_test_write_script(name ? (name + 1) : src_path, text, len);
+    free(text);
+    return path;
+}
+
+BadUsbScript* host_test_open(FuriString* path, BadUsbHidSession* session) {
+    BadUsbScript* bad_usb = bad_usb_script_open(path, BadUsbHidInterfaceUsb, session);
+    host_test_wait_idle(bad_usb);
+    return bad_usb;
+}
+
+void host_test_wait_idle(BadUsbScript* bad_usb) {
+    furi_host_thread_wait_idle(bad_usb->thread);
+}
+
+BadUsbWorkerState host_test_run(BadUsbScript* bad_usb) {
+    furi_host_clock_reset();
+    hid_record_reset();
+    bad_usb_script_start_stop(bad_usb);
+    host_test_wait_idle(bad_usb);
+    return bad_usb_script_get_state(bad_usb)->state;
+}
+
+static const char* const host_test_state_names[] = {
+    [BadUsbStateInit] = "Init",
+    [BadUsbStateNotConnected] = "NotConnected",
+    [BadUsbStateIdle] = "Idle",
+    [BadUsbStateWillRun] = "WillRun",
+    [BadUsbStateRunning] = "Running",
+    [BadUsbStateDelay] = "Delay",
+    [BadUsbStateStringDelay] = "StringDelay",
+    [BadUsbStateWaitForBtn] = "WaitForBtn",
+    [BadUsbStatePaused] = "Paused",
+    [BadUsbStateDone] = "Done",
+    [BadUsbStateScriptError] = "ScriptError",
+    [BadUsbStateFileError] = "FileError",
+};
+
+static const char* const host_test_event_names[] = {
+    [HostTestEventStartStop] = "start/stop",
+    [HostTestEventPauseResume] = "pause/resume",
+    [HostTestEventConnect] = "connect",
+    [HostTestEventDisconnect] = "disconnect",
+};
+
+static BadUsbScript* host_test_event_script;
+
+static const char* host_test_state_name(int state) {
+    if((state < 0) || (state >= (int)COUNT_OF(host_test_state_names))) return "?";
+    return host_test_state_names[state];
+}
+
+// Worker state changes go to the timeline, the rest of the log is left out
+static void host_test_log_states(FuriLogLevel level, const char* tag, const char* text) {
+    UNUSED(level);
+    UNUSED(tag);
+    int from = 0;
+    int to = 0;
+    if(sscanf(text, "State %d -> %d", &from, &to) == 2) {
+        hid_record_printf("state %s -> %s", host_test_state_name(from), host_test_state_name(to));
+    }
+}
+
+static void host_test_event_fire(void* context) {
+    HostTestEventType type = (HostTestEventType)(uintptr_t)context;
+    hid_record_printf("event %s", host_test_event_names[type]);
+    if(type == HostTestEventStartStop) {
+        bad_usb_script_start_stop(host_test_event_script);
+    } else if(type == HostTestEventPauseResume) {
+        bad_usb_script_pause_resume(host_test_event_script);
+    } else {
+        hid_record_set_connected(type == HostTestEventConnect);
+    }
+}
+
+BadUsbWorkerState
+    host_test_run_events(BadUsbScript* bad_usb, const HostTestEvent* events, size_t event_nb) {
+    furi_host_clock_reset();
+    furi_host_log_set_handler(host_test_log_states);
+    host_test_event_script = bad_usb;
+    FuriHostEvent host_events[event_nb];
+    for(size_t i = 0; i < event_nb; i++) {
+        host_events[i] = (FuriHostEvent){
+            .tick = events[i].tick,
+            .callback = host_test_event_fire,
+            .context = (void*)(uintptr_t)events[i].type,
+        };
+    }
+    furi_host_event_schedule(host_events, event_nb);
+    host_test_wait_idle(bad_usb);
+    furi_host_log_set_handler(NULL);
+    return bad_usb_script_get_state(bad_usb)->state;
+}
+
+static char* host_test_read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) return NULL;
+    fseek(file, 0, SEEK_END);
+    size_t len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = malloc(len + 1);
+    furi_check(fread(text, 1, len, file) == len);
+    fclose(file);
+    return text;
+}
+
+bool host_test_check_golden(const char* golden_path, const char* text, bool update) {
+    if(update) {
+        FILE* file = fopen(golden_path, "wb");
+        furi_check(file);
+        fputs(text, file);
+        fclose(file);
+        return true;
+    }
+
+    char* golden = host_test_read_file(golden_path);
+    if(golden == NULL) {
+        fprintf(stderr, "%s: missing, run with --update to create it\n", golden_path);
+        return false;
+    }
+
+    bool same = (strcmp(golden, text) == 0);
+    if(!same) {
+        // Point at the first line that differs
+        size_t line = 1;
+        size_t pos = 0;
+        size_t line_start = 0;
+        while(golden[pos] && (golden[pos] == text[pos])) {
+            if(golden[pos] == '\n') {
+                line++;
+                line_start = pos + 1;
+            }
+            pos++;
+        }
+        const char* g = &golden[line_start];
+        const char* t = &text[line_start];
+        const char* g_end = strchr(g, '\n');
+        const char* t_end = strchr(t, '\n');
+        fprintf(
+            stderr,
+            "%s:%zu: expected \"%.*s\", got \"%.*s\"\n",
+            golden_path,
+            line,
+            (int)(g_end ? (g_end - g) : (long)strlen(g)),
+            g,
+            (int)(t_end ? (t_end - t) : (long)strlen(t)),
+            t);
+    }
+    free(golden);
+    return same;
+}
+
+uint64_t host_bench_get_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool host_bench_is_quick(int argc, char* argv[]) {
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--quick") == 0) return true;
+    }
+    return false;
+}
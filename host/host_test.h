@@ -0,0 +1,59 @@
+#pragma once
+
+// Helpers shared by the host tests and benchmarks
+
+#include <furi.h>
+#include "../bad_usb/helpers/ducky_script.h"
+
+#define host_test_check(expr)                                                          \
+    do {                                                                               \
+        if(!(expr)) {                                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            exit(1);                                                                   \
+        }                                                                              \
+    } while(0)
+
+// Fresh folder for the scripts of a test, removed at exit
+const char* host_test_get_dir(void);
+
+// Writes a script into the test folder, returns its path
+FuriString* host_test_write_script(const char* name, const char* text, size_t len);
+
+// Copies a script into the test folder, the bytecode cache is written next to it
+FuriString* host_test_copy_script(const char* src_path);
+
+// Opens the script and waits until its worker settles, Idle when the script is valid
+BadUsbScript* host_test_open(FuriString* path, BadUsbHidSession* session);
+
+// Lets the worker run until nothing else can happen without a new event
+void host_test_wait_idle(BadUsbScript* bad_usb);
+
+// Starts an opened script at virtual time 0 and runs it to its end
+BadUsbWorkerState host_test_run(BadUsbScript* bad_usb);
+
+typedef enum {
+    HostTestEventStartStop,
+    HostTestEventPauseResume,
+    HostTestEventConnect,
+    HostTestEventDisconnect,
+} HostTestEventType;
+
+typedef struct {
+    uint32_t tick;
+    HostTestEventType type;
+} HostTestEvent;
+
+// Runs the opened script from virtual time 0 with each event injected at its time, until
+// nothing else can happen. Events and worker state changes are logged between the reports,
+// the recorder is left as the caller set it up. Start the script with an event at 0.
+BadUsbWorkerState
+    host_test_run_events(BadUsbScript* bad_usb, const HostTestEvent* events, size_t event_nb);
+
+// Compares text with a golden file, or rewrites the file when update is set
+bool host_test_check_golden(const char* golden_path, const char* text, bool update);
+
+// Wall clock for benchmarks, ns
+uint64_t host_bench_get_ns(void);
+
+// Benchmarks run a few iterations only when given --quick, as they do under ctest
+bool host_bench_is_quick(int argc, char* argv[]);
@@ -0,0 +1,157 @@
+#include <storage/storage.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct File {
+    int fd;
+};
+
+static char storage_host_root[256] = ".";
+
+void storage_host_set_root(const char* root) {
+    strlcpy(storage_host_root, root, sizeof(storage_host_root));
+}
+
+// /ext/x is looked up as <root>/x, host paths are used as they are
+static const char* storage_host_path(const char* path, char* host_path, size_t size) {
+    if(strncmp(path, "/ext/", 5) == 0) {
+        snprintf(host_path, size, "%s/%s", storage_host_root, &path[5]);
+        return host_path;
+    }
+    return path;
+}
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    File* file = malloc(sizeof(File));
+    file->fd = -1;
+    return file;
+}
+
+void storage_file_free(File* file) {
+    storage_file_close(file);
+    free(file);
+}
+
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode open_mode) {
+    furi_check(file->fd < 0);
+
+    int flags = 0;
+    if(access_mode == FSAM_READ_WRITE) {
+        flags = O_RDWR;
+    } else if(access_mode & FSAM_WRITE) {
+        flags = O_WRONLY;
+    } else {
+        flags = O_RDONLY;
+    }
+    if(open_mode & (FSOM_OPEN_ALWAYS | FSOM_OPEN_APPEND)) flags |= O_CREAT;
+    if(open_mode & FSOM_CREATE_NEW) flags |= O_CREAT | O_EXCL;
+    if(open_mode & FSOM_CREATE_ALWAYS) flags |= O_CREAT | O_TRUNC;
+
+    char host_path[512];
+    file->fd = open(storage_host_path(path, host_path, sizeof(host_path)), flags, 0644);
+    if((file->fd >= 0) && (open_mode & FSOM_OPEN_APPEND)) {
+        lseek(file->fd, 0, SEEK_END);
+    }
+    return file->fd >= 0;
+}
+
+bool storage_file_close(File* file) {
+    if(file->fd < 0) return false;
+    close(file->fd);
+    file->fd = -1;
+    return true;
+}
+
+bool storage_file_is_open(File* file) {
+    return file->fd >= 0;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read) {
+    if(file->fd < 0) return 0;
+    ssize_t len = read(file->fd, buff, bytes_to_read);
+    return (len > 0) ? (size_t)len : 0;
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    if(file->fd < 0) return 0;
+    ssize_t len = write(file->fd, buff, bytes_to_write);
+    return (len > 0) ? (size_t)len : 0;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+    if(file->fd < 0) return false;
+    off_t pos = lseek(file->fd, (off_t)offset, from_start ? SEEK_SET : SEEK_CUR);
+    return pos >= 0;
+}
+
+uint64_t storage_file_tell(File* file) {
+    if(file->fd < 0) return 0;
+    off_t pos = lseek(file->fd, 0, SEEK_CUR);
+    return (pos > 0) ? (uint64_t)pos : 0;
+}
+
+uint64_t storage_file_size(File* file) {
+    struct stat st;
+    if((file->fd < 0) || (fstat(file->fd, &st) != 0)) return 0;
+    return st.st_size;
+}
+
+bool storage_file_eof(File* file) {
+    return storage_file_tell(file) >= storage_file_size(file);
+}
+
+FS_Error storage_common_stat(Storage* storage, const char* path, FileInfo* fileinfo) {
+    UNUSED(storage);
+    char host_path[512];
+    struct stat st;
+    if(stat(storage_host_path(path, host_path, sizeof(host_path)), &st) != 0) {
+        return FSE_NOT_EXIST;
+    }
+    if(fileinfo) {
+        fileinfo->flags = S_ISDIR(st.st_mode) ? FSF_DIRECTORY : 0;
+        fileinfo->size = st.st_size;
+    }
+    return FSE_OK;
+}
+
+FS_Error storage_common_timestamp(Storage* storage, const char* path, uint32_t* timestamp) {
+    UNUSED(storage);
+    char host_path[512];
+    struct stat st;
+    if(stat(storage_host_path(path, host_path, sizeof(host_path)), &st) != 0) {
+        return FSE_NOT_EXIST;
+    }
+    *timestamp = (uint32_t)st.st_mtime;
+    return FSE_OK;
+}
+
+FS_Error storage_common_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host_path[512];
+    if(remove(storage_host_path(path, host_path, sizeof(host_path))) != 0) {
+        return (errno == ENOENT) ? FSE_NOT_EXIST : FSE_DENIED;
+    }
+    return FSE_OK;
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host_path[512];
+    const char* dir = storage_host_path(path, host_path, sizeof(host_path));
+    // Parents are created too, /ext always exists on the target
+    char partial[512];
+    strlcpy(partial, dir, sizeof(partial));
+    for(char* sep = strchr(&partial[1], '/'); sep != NULL; sep = strchr(sep + 1, '/')) {
+        *sep = '\0';
+        mkdir(partial, 0755);
+        *sep = '/';
+    }
+    return (mkdir(dir, 0755) == 0) || (errno == EEXIST);
+}
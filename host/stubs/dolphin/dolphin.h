@@ -0,0 +1,9 @@
+#pragma once
+
+typedef enum {
+    DolphinDeedBadUsbPlayScript,
+} DolphinDeed;
+
+static inline void dolphin_deed(DolphinDeed deed) {
+    (void)deed;
+}
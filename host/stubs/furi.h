@@ -0,0 +1,209 @@
+#pragma once
+
+// Host stand-in for the parts of the furi core used by the Bad USB interpreter.
+// Time is virtual: it only moves when the worker waits or the HID backend sends a report,
+// so runs are reproducible and a DELAY of an hour takes no time at all
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// furi heap returns zeroed memory and never fails
+#define malloc(size) furi_host_malloc(size)
+void* furi_host_malloc(size_t size);
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(x, upper, lower) (MIN(upper, MAX(x, lower)))
+#endif
+#ifndef COUNT_OF
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#endif
+#ifndef UNUSED
+#define UNUSED(x) (void)(x)
+#endif
+#define FURI_PACKED __attribute__((packed))
+
+#define EXT_PATH(path) "/ext/" path
+#define APP_DATA_PATH(path) "/ext/apps_data/bad_usb/" path
+
+size_t strlcpy(char* dst, const char* src, size_t size);
+
+// Checks
+
+void furi_crash(const char* message) __attribute__((noreturn));
+
+#define furi_check(expr)                                       \
+    do {                                                       \
+        if(!(expr)) furi_crash("furi_check failed: " #expr); \
+    } while(0)
+
+#define furi_assert(expr) furi_check(expr)
+
+// Log
+
+typedef enum {
+    FuriLogLevelDefault = 0,
+    FuriLogLevelNone = 1,
+    FuriLogLevelError = 2,
+    FuriLogLevelWarn = 3,
+    FuriLogLevelInfo = 4,
+    FuriLogLevelDebug = 5,
+    FuriLogLevelTrace = 6,
+} FuriLogLevel;
+
+typedef void (*FuriHostLogHandler)(FuriLogLevel level, const char* tag, const char* text);
+
+void furi_log_print_format(FuriLogLevel level, const char* tag, const char* format, ...);
+
+// Handler gets every log line, NULL prints to stderr when BADUSB_HOST_LOG is set
+void furi_host_log_set_handler(FuriHostLogHandler handler);
+
+#define FURI_LOG_E(tag, format, ...) \
+    furi_log_print_format(FuriLogLevelError, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_W(tag, format, ...) \
+    furi_log_print_format(FuriLogLevelWarn, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_I(tag, format, ...) \
+    furi_log_print_format(FuriLogLevelInfo, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_D(tag, format, ...) \
+    furi_log_print_format(FuriLogLevelDebug, tag, format, ##__VA_ARGS__)
+#define FURI_LOG_T(tag, format, ...) \
+    furi_log_print_format(FuriLogLevelTrace, tag, format, ##__VA_ARGS__)
+
+// Kernel
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+uint32_t furi_get_tick(void);
+
+void furi_delay_ms(uint32_t milliseconds);
+
+// Virtual clock, ms since the last reset
+void furi_host_clock_reset(void);
+
+void furi_host_clock_advance(uint32_t milliseconds);
+
+// Timed waits that run out end this much past their timeout, as a late wake up would
+void furi_host_clock_set_wake_latency(uint32_t milliseconds);
+
+// Scripted events: the callback runs on the thread following the virtual clock, when it
+// checks or waits for its flags once the clock reaches tick. A wait jumps straight to the
+// next event, so a long wait that gets interrupted ends at the event time
+typedef void (*FuriHostEventCallback)(void* context);
+
+typedef struct {
+    uint32_t tick;
+    FuriHostEventCallback callback;
+    void* context;
+} FuriHostEvent;
+
+// Events are added together, so none of them fires before the others are known
+void furi_host_event_schedule(const FuriHostEvent* events, size_t event_nb);
+
+void furi_host_event_clear(void);
+
+// Threads and thread flags
+
+typedef enum {
+    FuriFlagWaitAny = 0x00000000U,
+    FuriFlagWaitAll = 0x00000001U,
+    FuriFlagNoClear = 0x00000002U,
+    FuriFlagError = 0x80000000U,
+    FuriFlagErrorUnknown = 0xFFFFFFFFU,
+    FuriFlagErrorTimeout = 0xFFFFFFFEU,
+    FuriFlagErrorResource = 0xFFFFFFFDU,
+    FuriFlagErrorParameter = 0xFFFFFFFCU,
+    FuriFlagErrorISR = 0xFFFFFFFAU,
+} FuriFlag;
+
+typedef struct FuriThread FuriThread;
+typedef FuriThread* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+
+void furi_thread_free(FuriThread* thread);
+
+void furi_thread_start(FuriThread* thread);
+
+bool furi_thread_join(FuriThread* thread);
+
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+
+FuriThreadId furi_thread_get_current_id(void);
+
+size_t furi_thread_get_stack_space(FuriThreadId thread_id);
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+
+uint32_t furi_thread_flags_clear(uint32_t flags);
+
+uint32_t furi_thread_flags_get(void);
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+// Blocks the thread got from malloc so far, FuriString growth is not counted
+size_t furi_host_thread_get_alloc_nb(FuriThreadId thread_id);
+
+// Returns once the thread blocks with no timeout, no flag and no event to wake it, or has exited.
+// Nothing else can happen then, so the caller acts at a reproducible point of the run
+void furi_host_thread_wait_idle(FuriThread* thread);
+
+// Records
+
+void* furi_record_open(const char* name);
+
+void furi_record_close(const char* name);
+
+// Strings
+
+typedef struct FuriString FuriString;
+
+FuriString* furi_string_alloc(void);
+
+FuriString* furi_string_alloc_set_str(const char* cstr);
+
+void furi_string_free(FuriString* string);
+
+void furi_string_reset(FuriString* string);
+
+void furi_string_set(FuriString* string, FuriString* source);
+
+void furi_string_set_str(FuriString* string, const char* cstr);
+
+void furi_string_set_strn(FuriString* string, const char* cstr, size_t n);
+
+void furi_string_cat_str(FuriString* string, const char* cstr);
+
+int furi_string_printf(FuriString* string, const char format[], ...);
+
+int furi_string_cat_printf(FuriString* string, const char format[], ...);
+
+int furi_string_cat_vprintf(FuriString* string, const char format[], va_list args);
+
+const char* furi_string_get_cstr(const FuriString* string);
+
+size_t furi_string_size(const FuriString* string);
+
+bool furi_string_empty(const FuriString* string);
+
+#ifdef __cplusplus
+}
+#endif
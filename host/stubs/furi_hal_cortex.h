@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t start;
+    uint32_t value;
+} FuriHalCortexTimer;
+
+// Cycle counter driven by the virtual clock, at the target core frequency
+FuriHalCortexTimer furi_hal_cortex_timer_get(uint32_t timeout_us);
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void);
+
+#ifdef __cplusplus
+}
+#endif
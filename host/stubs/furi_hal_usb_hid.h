@@ -0,0 +1,156 @@
+#pragma once
+
+// Host stand-in for the USB HID definitions of furi_hal
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_KB_MAX_KEYS       6
+#define HID_CONSUMER_MAX_KEYS 2
+
+#define HID_KB_LED_NUM    (1 << 0)
+#define HID_KB_LED_CAPS   (1 << 1)
+#define HID_KB_LED_SCROLL (1 << 2)
+
+enum HidKeyboardMods {
+    KEY_MOD_LEFT_CTRL = (1 << 8),
+    KEY_MOD_LEFT_SHIFT = (1 << 9),
+    KEY_MOD_LEFT_ALT = (1 << 10),
+    KEY_MOD_LEFT_GUI = (1 << 11),
+    KEY_MOD_RIGHT_CTRL = (1 << 12),
+    KEY_MOD_RIGHT_SHIFT = (1 << 13),
+    KEY_MOD_RIGHT_ALT = (1 << 14),
+    KEY_MOD_RIGHT_GUI = (1 << 15),
+};
+
+enum HidKeyboardKeys {
+    HID_KEYBOARD_NONE = 0x00,
+    HID_KEYBOARD_A = 0x04,
+    HID_KEYBOARD_RETURN = 0x28,
+    HID_KEYBOARD_ESCAPE = 0x29,
+    HID_KEYBOARD_DELETE = 0x2A,
+    HID_KEYBOARD_TAB = 0x2B,
+    HID_KEYBOARD_SPACEBAR = 0x2C,
+    HID_KEYBOARD_CAPS_LOCK = 0x39,
+    HID_KEYBOARD_F1 = 0x3A,
+    HID_KEYBOARD_F2 = 0x3B,
+    HID_KEYBOARD_F3 = 0x3C,
+    HID_KEYBOARD_F4 = 0x3D,
+    HID_KEYBOARD_F5 = 0x3E,
+    HID_KEYBOARD_F6 = 0x3F,
+    HID_KEYBOARD_F7 = 0x40,
+    HID_KEYBOARD_F8 = 0x41,
+    HID_KEYBOARD_F9 = 0x42,
+    HID_KEYBOARD_F10 = 0x43,
+    HID_KEYBOARD_F11 = 0x44,
+    HID_KEYBOARD_F12 = 0x45,
+    HID_KEYBOARD_PRINT_SCREEN = 0x46,
+    HID_KEYBOARD_SCROLL_LOCK = 0x47,
+    HID_KEYBOARD_PAUSE = 0x48,
+    HID_KEYBOARD_INSERT = 0x49,
+    HID_KEYBOARD_HOME = 0x4A,
+    HID_KEYBOARD_PAGE_UP = 0x4B,
+    HID_KEYBOARD_DELETE_FORWARD = 0x4C,
+    HID_KEYBOARD_END = 0x4D,
+    HID_KEYBOARD_PAGE_DOWN = 0x4E,
+    HID_KEYBOARD_RIGHT_ARROW = 0x4F,
+    HID_KEYBOARD_LEFT_ARROW = 0x50,
+    HID_KEYBOARD_DOWN_ARROW = 0x51,
+    HID_KEYBOARD_UP_ARROW = 0x52,
+    HID_KEYPAD_NUMLOCK = 0x53,
+    HID_KEYPAD_1 = 0x59,
+    HID_KEYPAD_2 = 0x5A,
+    HID_KEYPAD_3 = 0x5B,
+    HID_KEYPAD_4 = 0x5C,
+    HID_KEYPAD_5 = 0x5D,
+    HID_KEYPAD_6 = 0x5E,
+    HID_KEYPAD_7 = 0x5F,
+    HID_KEYPAD_8 = 0x60,
+    HID_KEYPAD_9 = 0x61,
+    HID_KEYPAD_0 = 0x62,
+    HID_KEYBOARD_APPLICATION = 0x65,
+    HID_KEYBOARD_F13 = 0x68,
+    HID_KEYBOARD_F14 = 0x69,
+    HID_KEYBOARD_F15 = 0x6A,
+    HID_KEYBOARD_F16 = 0x6B,
+    HID_KEYBOARD_F17 = 0x6C,
+    HID_KEYBOARD_F18 = 0x6D,
+    HID_KEYBOARD_F19 = 0x6E,
+    HID_KEYBOARD_F20 = 0x6F,
+    HID_KEYBOARD_F21 = 0x70,
+    HID_KEYBOARD_F22 = 0x71,
+    HID_KEYBOARD_F23 = 0x72,
+    HID_KEYBOARD_F24 = 0x73,
+    HID_KEYBOARD_LOCK_NUM_LOCK = 0x83,
+};
+
+enum HidMouseButtons {
+    HID_MOUSE_BTN_LEFT = (1 << 0),
+    HID_MOUSE_BTN_RIGHT = (1 << 1),
+    HID_MOUSE_BTN_WHEEL = (1 << 2),
+};
+
+enum HidConsumerKeys {
+    HID_CONSUMER_UNASSIGNED = 0x00,
+    HID_CONSUMER_POWER = 0x30,
+    HID_CONSUMER_RESET = 0x31,
+    HID_CONSUMER_SLEEP = 0x32,
+    HID_CONSUMER_SNAPSHOT = 0x65,
+    HID_CONSUMER_BRIGHTNESS_INCREMENT = 0x6F,
+    HID_CONSUMER_BRIGHTNESS_DECREMENT = 0x70,
+    HID_CONSUMER_PLAY = 0xB0,
+    HID_CONSUMER_PAUSE = 0xB1,
+    HID_CONSUMER_SCAN_NEXT_TRACK = 0xB5,
+    HID_CONSUMER_SCAN_PREVIOUS_TRACK = 0xB6,
+    HID_CONSUMER_STOP = 0xB7,
+    HID_CONSUMER_EJECT = 0xB8,
+    HID_CONSUMER_PLAY_PAUSE = 0xCD,
+    HID_CONSUMER_MUTE = 0xE2,
+    HID_CONSUMER_VOLUME_INCREMENT = 0xE9,
+    HID_CONSUMER_VOLUME_DECREMENT = 0xEA,
+    HID_CONSUMER_AL_LOGOFF = 0x19C,
+    HID_CONSUMER_AC_EXIT = 0x204,
+    HID_CONSUMER_AC_HOME = 0x223,
+    HID_CONSUMER_AC_BACK = 0x224,
+    HID_CONSUMER_AC_FORWARD = 0x225,
+    HID_CONSUMER_AC_REFRESH = 0x227,
+    HID_CONSUMER_FN_GLOBE = 0x29D,
+};
+
+// US layout, same table as assets/layouts/en-US.kl
+static const uint16_t hid_asciimap[] = {
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x002A, 0x002B, 0x0028, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x002C, 0x021E, 0x0234, 0x0220, 0x0221, 0x0222, 0x0224, 0x0034,
+    0x0226, 0x0227, 0x0225, 0x022E, 0x0036, 0x002D, 0x0037, 0x0038,
+    0x0027, 0x001E, 0x001F, 0x0020, 0x0021, 0x0022, 0x0023, 0x0024,
+    0x0025, 0x0026, 0x0233, 0x0033, 0x0236, 0x002E, 0x0237, 0x0238,
+    0x021F, 0x0204, 0x0205, 0x0206, 0x0207, 0x0208, 0x0209, 0x020A,
+    0x020B, 0x020C, 0x020D, 0x020E, 0x020F, 0x0210, 0x0211, 0x0212,
+    0x0213, 0x0214, 0x0215, 0x0216, 0x0217, 0x0218, 0x0219, 0x021A,
+    0x021B, 0x021C, 0x021D, 0x002F, 0x0031, 0x0030, 0x0223, 0x022D,
+    0x0035, 0x0004, 0x0005, 0x0006, 0x0007, 0x0008, 0x0009, 0x000A,
+    0x000B, 0x000C, 0x000D, 0x000E, 0x000F, 0x0010, 0x0011, 0x0012,
+    0x0013, 0x0014, 0x0015, 0x0016, 0x0017, 0x0018, 0x0019, 0x001A,
+    0x001B, 0x001C, 0x001D, 0x022F, 0x0231, 0x0230, 0x0235, 0x0000,
+};
+
+// vid and pid are uint32_t on the target, where it is an unsigned long read with %lX
+typedef struct {
+    unsigned long vid;
+    unsigned long pid;
+    char manuf[32];
+    char product[32];
+} FuriHalUsbHidConfig;
+
+typedef void (*HidStateCallback)(bool state, void* context);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    StrintParseNoError,
+    StrintParseSignError,
+    StrintParseAbsentError,
+    StrintParseOverflowError,
+} StrintParseError;
+
+StrintParseError strint_to_uint32(const char* str, char** end, uint32_t* out, uint8_t base);
+
+StrintParseError strint_to_int32(const char* str, char** end, int32_t* out, uint8_t base);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+// Host stand-in for the storage service, backed by the host file system.
+// Paths under /ext are mapped to the folder set with storage_host_set_root()
+
+#include <furi.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RECORD_STORAGE "storage"
+
+typedef struct Storage Storage;
+typedef struct File File;
+
+typedef enum {
+    FSAM_READ = (1 << 0),
+    FSAM_WRITE = (1 << 1),
+    FSAM_READ_WRITE = FSAM_READ | FSAM_WRITE,
+} FS_AccessMode;
+
+typedef enum {
+    FSOM_OPEN_EXISTING = 1,
+    FSOM_OPEN_ALWAYS = 2,
+    FSOM_OPEN_APPEND = 4,
+    FSOM_CREATE_NEW = 8,
+    FSOM_CREATE_ALWAYS = 16,
+} FS_OpenMode;
+
+typedef enum {
+    FSE_OK,
+    FSE_NOT_READY,
+    FSE_EXIST,
+    FSE_NOT_EXIST,
+    FSE_INVALID_PARAMETER,
+    FSE_DENIED,
+    FSE_INVALID_NAME,
+    FSE_INTERNAL,
+    FSE_NOT_IMPLEMENTED,
+    FSE_ALREADY_OPEN,
+} FS_Error;
+
+typedef enum {
+    FSF_DIRECTORY = (1 << 0),
+} FS_Flags;
+
+typedef struct {
+    uint8_t flags;
+    uint64_t size;
+} FileInfo;
+
+File* storage_file_alloc(Storage* storage);
+
+void storage_file_free(File* file);
+
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode open_mode);
+
+bool storage_file_close(File* file);
+
+bool storage_file_is_open(File* file);
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read);
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write);
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start);
+
+uint64_t storage_file_tell(File* file);
+
+uint64_t storage_file_size(File* file);
+
+bool storage_file_eof(File* file);
+
+FS_Error storage_common_stat(Storage* storage, const char* path, FileInfo* fileinfo);
+
+FS_Error storage_common_timestamp(Storage* storage, const char* path, uint32_t* timestamp);
+
+FS_Error storage_common_remove(Storage* storage, const char* path);
+
+bool storage_simply_mkdir(Storage* storage, const char* path);
+
+// Host folder standing for /ext, the current folder by default
+void storage_host_set_root(const char* root);
+
+#ifdef __cplusplus
+}
+#endif
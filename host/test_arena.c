@@ -0,0 +1,131 @@
+// Script buffers come from one arena allocated before the worker reports Idle: background
+// compilation and runs, from text or from the bytecode cache, allocate nothing after that.
+// Runs, the profiled one included, leave a quarter of the worker stack free. The host measures
+// it against twice WORKER_STACK_SIZE, its frames being larger.
+// Usage: test_arena
+
+#include "host_test.h"
+#include "hid_record.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+
+#define ARENA_INDEX_LINE_NB 20000 // More lines than the line index holds at its first step
+#define ARENA_STACK_FREE_MIN (WORKER_STACK_SIZE / 2) // Host bytes, out of twice the stack size
+
+typedef struct {
+    const char* name;
+    const char* script; // NULL for the long script
+    BadUsbWorkerState state; // State once the run ends
+    bool profile; // Profiler allocates its table at start, allocations aren't checked
+} ArenaCase;
+
+static const ArenaCase arena_cases[] = {
+    {"plain", "DELAY 10\nSTRING hello\nCTRL-ALT DELETE\nREPEAT 3\n", BadUsbStateDone, false},
+    {"blocks",
+     "VAR $i = 0\nWHILE ($i < 3)\nSTRING a\n$i = ($i + 1)\nEND_WHILE\n",
+     BadUsbStateDone,
+     false},
+    {"string file", "STRINGFILE arena_text.txt\nENTER\n", BadUsbStateDone, false},
+    {"long line", NULL, BadUsbStateDone, false},
+    {"index", NULL, BadUsbStateScriptError, false},
+    {"profiled",
+     "VAR $i = 0\nWHILE ($i < 3)\nSTRING a\n$i = ($i + 1)\nEND_WHILE\nALTSTRING ab\n",
+     BadUsbStateDone,
+     true},
+};
+
+static size_t arena_idle_alloc_nb;
+
+// Worker blocks at the time it first reports Idle
+static void arena_log(FuriLogLevel level, const char* tag, const char* text) {
+    UNUSED(level);
+    UNUSED(tag);
+    if(strncmp(text, "State 0 -> 2 ", strlen("State 0 -> 2 ")) == 0) {
+        arena_idle_alloc_nb = furi_host_thread_get_alloc_nb(furi_thread_get_current_id());
+    }
+}
+
+static FuriString* arena_get_script(size_t index) {
+    const ArenaCase* arena_case = &arena_cases[index];
+    FuriString* text = furi_string_alloc();
+    if(arena_case->script) {
+        furi_string_set_str(text, arena_case->script);
+    } else if(strcmp(arena_case->name, "long line") == 0) {
+        furi_string_set_str(text, "STRING ");
+        while(furi_string_size(text) < DUCKY_LINE_LEN_MAX) {
+            furi_string_cat_str(text, "a");
+        }
+        furi_string_cat_str(text, "\nENTER\n");
+    } else {
+        // Error on the last line, its text is found through the sparse line index
+        for(size_t i = 0; i < ARENA_INDEX_LINE_NB; i++) {
+            furi_string_cat_str(text, "REM line\n");
+        }
+        furi_string_cat_str(text, "DELAY x\n");
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "arena_%zu.txt", index);
+    FuriString* path =
+        host_test_write_script(name, furi_string_get_cstr(text), furi_string_size(text));
+    furi_string_free(text);
+    return path;
+}
+
+static bool arena_run(size_t index, FuriString* path, size_t run) {
+    const ArenaCase* arena_case = &arena_cases[index];
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    arena_idle_alloc_nb = SIZE_MAX;
+    BadUsbScript* bad_usb = host_test_open(path, session);
+    bad_usb_script_set_profiling(bad_usb, arena_case->profile);
+    BadUsbState* st = bad_usb_script_get_state(bad_usb);
+    BadUsbWorkerState state = st->state;
+    if(state == BadUsbStateIdle) {
+        state = host_test_run(bad_usb);
+    }
+    size_t alloc_nb = furi_host_thread_get_alloc_nb(bad_usb->thread) - arena_idle_alloc_nb;
+
+    bool case_state = (state == arena_case->state) && (st->stack_free >= ARENA_STACK_FREE_MIN);
+    if(!arena_case->profile) {
+        case_state &= (alloc_nb == 0);
+    }
+    if(state == BadUsbStateScriptError) {
+        case_state &= (st->error_line == ARENA_INDEX_LINE_NB + 1) &&
+                      (strcmp(st->error_text, "DELAY x") == 0);
+    }
+    printf(
+        "%s, %s: %zu byte arena, %zu allocations once idle, %zu bytes of stack left%s\n",
+        arena_case->name,
+        (run == 0) ? "compiled" : "cached",
+        bad_usb->arena_size,
+        alloc_nb,
+        st->stack_free,
+        case_state ? "" : " FAILED");
+    if(!case_state) {
+        fprintf(stderr, "state %d, line %zu: %s\n", state, st->error_line, st->error_text);
+    }
+
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    return case_state;
+}
+
+int main(void) {
+    const char* string_text = "the quick brown fox jumps over the lazy dog\n";
+    FuriString* string_path =
+        host_test_write_script("arena_text.txt", string_text, strlen(string_text));
+    furi_host_log_set_handler(arena_log);
+
+    bool state = true;
+    for(size_t i = 0; i < COUNT_OF(arena_cases); i++) {
+        FuriString* path = arena_get_script(i);
+        // First run compiles the script in the background, the second one uses the cache
+        for(size_t run = 0; run < 2; run++) {
+            state &= arena_run(i, path, run);
+        }
+        furi_string_free(path);
+    }
+
+    furi_host_log_set_handler(NULL);
+    furi_string_free(string_path);
+    return state ? 0 : 1;
+}
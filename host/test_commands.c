@@ -0,0 +1,112 @@
+// Command parsing and execution cases, run through the worker on the host build.
+// Usage: test_commands
+
+#include "host_test.h"
+#include "hid_record.h"
+#include <sys/stat.h>
+
+typedef struct {
+    const char* name;
+    const char* script;
+    BadUsbWorkerState state;
+    const char* error; // Start of the error message, NULL to skip the check
+    size_t report_nb; // Reports sent by the run, 0 to skip the check
+} CommandCase;
+
+static const CommandCase command_cases[] = {
+    {"STRINGFILE without a path", "STRINGFILE\n", BadUsbStateScriptError, "Invalid path", 0},
+    {"STRINGFILE with a blank path", "STRINGFILE  \n", BadUsbStateScriptError, "Invalid path", 0},
+    {"STRINGFILE missing file", "STRINGFILE none.txt\n", BadUsbStateScriptError, NULL, 0},
+    // Clamped to 8192, 65 reports, then the script end releases keyboard, consumer and mouse
+    {"MOUSE_MOVE lowest int32", "MOUSE_MOVE -2147483648 0\n", BadUsbStateDone, NULL, 65 + 3},
+    {"MOUSE_MOVE both axes", "MOUSE_MOVE 100000 -9000\n", BadUsbStateDone, NULL, 65 + 3},
+    {"MOUSE_SCROLL highest int32", "MOUSE_SCROLL 2147483647\n", BadUsbStateDone, NULL, 65 + 3},
+};
+
+static bool test_commands_run(const CommandCase* command_case, size_t index) {
+    char name[32];
+    snprintf(name, sizeof(name), "commands_%zu.txt", index);
+    FuriString* path =
+        host_test_write_script(name, command_case->script, strlen(command_case->script));
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+
+    BadUsbState* st = bad_usb_script_get_state(bad_usb);
+    if(st->state == BadUsbStateIdle) {
+        host_test_run(bad_usb);
+    }
+    bool state = (st->state == command_case->state);
+    if(command_case->error) {
+        state &= (strncmp(st->error, command_case->error, strlen(command_case->error)) == 0);
+    }
+    if(command_case->report_nb) {
+        state &= (hid_record_get_report_nb() == command_case->report_nb);
+    }
+    if(!state) {
+        fprintf(
+            stderr,
+            "state %d, error \"%s\", %zu reports\n",
+            st->state,
+            st->error,
+            hid_record_get_report_nb());
+    }
+
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    return state;
+}
+
+// A directory in place of the cache makes the bytecode write fail. Plain lines still run from
+// the text, blocks are refused at open instead of failing line by line
+static bool
+    test_commands_no_cache(const char* name, const char* script, BadUsbWorkerState expect) {
+    FuriString* path = host_test_write_script(name, script, strlen(script));
+    FuriString* cache_path = furi_string_alloc();
+    furi_string_printf(cache_path, "%s/.%s.dbc", host_test_get_dir(), name);
+    furi_check(mkdir(furi_string_get_cstr(cache_path), 0700) == 0);
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+
+    BadUsbState* st = bad_usb_script_get_state(bad_usb);
+    if(st->state == BadUsbStateIdle) {
+        host_test_run(bad_usb);
+    }
+    bool state = (st->state == expect);
+    if(expect == BadUsbStateScriptError) {
+        state &= (strcmp(st->error, "Can't save compiled script") == 0) && (st->error_line == 2);
+    }
+    if(!state) {
+        fprintf(
+            stderr,
+            "state %d, error \"%s\" at line %zu\n",
+            st->state,
+            st->error,
+            st->error_line);
+    }
+
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(cache_path);
+    furi_string_free(path);
+    return state;
+}
+
+int main(void) {
+    bool state = true;
+    for(size_t i = 0; i < COUNT_OF(command_cases); i++) {
+        bool case_state = test_commands_run(&command_cases[i], i);
+        printf("%s: %s\n", command_cases[i].name, case_state ? "ok" : "FAILED");
+        state &= case_state;
+    }
+
+    bool case_state =
+        test_commands_no_cache("no_cache_text.txt", "STRING a\nENTER\n", BadUsbStateDone);
+    printf("Unwritable cache, plain lines: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+    case_state = test_commands_no_cache(
+        "no_cache_blocks.txt", "STRING a\nVAR $a = 1\nSTRING b\n", BadUsbStateScriptError);
+    printf("Unwritable cache, blocks: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+    return state ? 0 : 1;
+}
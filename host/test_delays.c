@@ -0,0 +1,199 @@
+// Delay scheduling on the virtual clock: a delay is never shortened by the time spent typing
+// before it, a run lasts the sum of its delays plus the time spent sending output, and late
+// wake ups don't add up.
+// Usage: test_delays
+
+#include "host_test.h"
+#include "hid_record.h"
+
+// Time of the first report sending key, 0 if none
+static uint32_t test_delays_find_key(const char* log, uint8_t key) {
+    char pattern[16];
+    snprintf(pattern, sizeof(pattern), " %02X ", key);
+    for(const char* line = log; *line; line = strchr(line, '\n') + 1) {
+        const char* line_end = strchr(line, '\n');
+        const char* report = strstr(line, " kb ");
+        if(report && (report < line_end)) {
+            const char* found = strstr(report + 6, pattern);
+            if(found && (found < line_end)) return strtoul(line, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+// Time from the report before the first one sending key to that report, 0 if none
+static uint32_t test_delays_gap(const char* log, uint8_t key) {
+    uint32_t key_time = test_delays_find_key(log, key);
+    uint32_t prev_time = 0;
+    for(const char* line = log; *line; line = strchr(line, '\n') + 1) {
+        uint32_t time = strtoul(line, NULL, 10);
+        if(time >= key_time) break;
+        prev_time = time;
+    }
+    return key_time ? (key_time - prev_time) : 0;
+}
+
+// Reports sent before time
+static size_t test_delays_report_nb(const char* log, uint32_t time) {
+    size_t report_nb = 0;
+    for(const char* line = log; *line && (strtoul(line, NULL, 10) < time);
+        line = strchr(line, '\n') + 1) {
+        report_nb++;
+    }
+    return report_nb;
+}
+
+// Time of the last report
+static uint32_t test_delays_last_report(const char* log) {
+    const char* line = log;
+    const char* last = log;
+    while(*line) {
+        last = line;
+        line = strchr(line, '\n') + 1;
+    }
+    return strtoul(last, NULL, 10);
+}
+
+static bool test_delays_run_state(
+    const char* name,
+    const char* script,
+    FuriString* log,
+    BadUsbState* run_st) {
+    FuriString* path = host_test_write_script(name, script, strlen(script));
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+    bool state = (host_test_run(bad_usb) == BadUsbStateDone);
+    furi_string_set_str(log, hid_record_get_log());
+    if(run_st) *run_st = *bad_usb_script_get_state(bad_usb);
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    return state;
+}
+
+static bool test_delays_run(const char* name, const char* script, FuriString* log) {
+    return test_delays_run_state(name, script, log, NULL);
+}
+
+// The string takes about 200 ms to type, the delay still runs in full after it
+static bool test_delays_after_string(FuriString* log) {
+    FuriString* script = furi_string_alloc_set_str("DELAY 50\nSTRING ");
+    for(size_t i = 0; i < 100; i++) {
+        furi_string_cat_str(script, "aa");
+    }
+    furi_string_cat_str(script, "\nDELAY 100\nENTER\n");
+    bool state = test_delays_run("after_string.txt", furi_string_get_cstr(script), log);
+    furi_string_free(script);
+
+    const char* cstr = furi_string_get_cstr(log);
+    uint32_t enter_time = test_delays_find_key(cstr, 0x28);
+    uint32_t typed_end = 0;
+    for(const char* line = cstr; *line; line = strchr(line, '\n') + 1) {
+        uint32_t time = strtoul(line, NULL, 10);
+        if(time >= enter_time) break;
+        typed_end = time;
+    }
+    printf("string typed by %u ms, ENTER at %u ms\n", typed_end, enter_time);
+    return state && (enter_time >= typed_end + 100);
+}
+
+// Delays only, the run lasts as long as their sum
+static bool test_delays_sum(FuriString* log) {
+    const char* script = "DELAY 1000\nDELAY 2500\nDEFAULT_DELAY 250\nDELAY 500\nENTER\n";
+    bool state = test_delays_run("sum.txt", script, log);
+    uint32_t enter_time = test_delays_find_key(furi_string_get_cstr(log), 0x28);
+    printf("ENTER at %u ms\n", enter_time);
+    // Default delay follows the DEFAULT_DELAY line itself and the DELAY 500 line
+    return state && (enter_time == 1000 + 2500 + 250 + 500 + 250) &&
+           (test_delays_last_report(furi_string_get_cstr(log)) > enter_time);
+}
+
+// Each DELAY starts once the report before it is sent, the output time is not taken off it
+static bool test_delays_output(FuriString* log) {
+    const char* script = "STRING ab\nDELAY 100\nSTRING cd\nDELAY 100\nENTER\n";
+    bool state = test_delays_run("output.txt", script, log);
+    const char* cstr = furi_string_get_cstr(log);
+    uint32_t c_gap = test_delays_gap(cstr, 0x06);
+    uint32_t enter_gap = test_delays_gap(cstr, 0x28);
+    uint32_t enter_time = test_delays_find_key(cstr, 0x28);
+    size_t report_nb = test_delays_report_nb(cstr, enter_time);
+    printf(
+        "c after %u ms, ENTER after %u ms at %u ms, %zu reports before\n",
+        c_gap,
+        enter_gap,
+        enter_time,
+        report_nb);
+    // A report is logged when it is sent and takes one poll interval
+    return state && (c_gap == HID_RECORD_POLL_INTERVAL + 100) &&
+           (enter_gap == HID_RECORD_POLL_INTERVAL + 100) &&
+           (enter_time == 100 + 100 + report_nb * HID_RECORD_POLL_INTERVAL);
+}
+
+// Each wait ends 3 ms late, the next delay makes up for it so only the last one shows
+static bool test_delays_wake_late(FuriString* log) {
+    FuriString* script = furi_string_alloc_set_str("ENTER\n");
+    for(size_t i = 0; i < 10; i++) {
+        furi_string_cat_str(script, "DELAY 100\n");
+    }
+    furi_string_cat_str(script, "SPACE\n");
+
+    BadUsbState run_st;
+    bool state = test_delays_run("wake_on_time.txt", furi_string_get_cstr(script), log);
+    const char* cstr = furi_string_get_cstr(log);
+    uint32_t on_time = test_delays_find_key(cstr, 0x2C) - test_delays_find_key(cstr, 0x28);
+    furi_host_clock_set_wake_latency(3);
+    state &= test_delays_run_state("wake_late.txt", furi_string_get_cstr(script), log, &run_st);
+    furi_host_clock_set_wake_latency(0);
+    furi_string_free(script);
+
+    cstr = furi_string_get_cstr(log);
+    uint32_t late = test_delays_find_key(cstr, 0x2C) - test_delays_find_key(cstr, 0x28);
+    printf(
+        "ENTER to SPACE %u ms, %u ms waking up late, %u late waits, worst %u ms\n",
+        on_time,
+        late,
+        run_st.delay_overrun_nb,
+        run_st.delay_jitter_max);
+    return state && (late == on_time + 3) && (run_st.delay_overrun_nb == 10) &&
+           (run_st.delay_jitter_max == 3);
+}
+
+// Control flow lines take no DEFAULT_DELAY, END_IF included
+static bool test_delays_end_if(FuriString* log) {
+    const char* script =
+        "DEFAULT_DELAY 100\nVAR $a = 1\nIF ($a == 1)\nENTER\nEND_IF\nSPACE\n";
+    bool state = test_delays_run("end_if.txt", script, log);
+    uint32_t enter_time = test_delays_find_key(furi_string_get_cstr(log), 0x28);
+    uint32_t space_time = test_delays_find_key(furi_string_get_cstr(log), 0x2C);
+    printf("ENTER at %u ms, SPACE at %u ms\n", enter_time, space_time);
+    // One default delay after ENTER, none after END_IF
+    return state && (enter_time == 100) && (space_time >= 200) && (space_time < 300);
+}
+
+int main(void) {
+    FuriString* log = furi_string_alloc();
+    bool state = true;
+
+    bool case_state = test_delays_after_string(log);
+    printf("delay after string: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+
+    case_state = test_delays_sum(log);
+    printf("delays add up: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+
+    case_state = test_delays_output(log);
+    printf("delays between output: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+
+    case_state = test_delays_wake_late(log);
+    printf("late wake ups made up for: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+
+    case_state = test_delays_end_if(log);
+    printf("END_IF without delay: %s\n", case_state ? "ok" : "FAILED");
+    state &= case_state;
+
+    furi_string_free(log);
+    return state ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// Runs the bundled scripts and compares every HID report they send, with its virtual time,
+// against golden/<script>.txt. Each script is run twice: compiled from its text on the first
+// run, loaded from the bytecode cache on the second one, and both must send the same reports.
+// Usage: test_golden <scripts folder> <golden folder> <script>... [--update]
+
+#include "host_test.h"
+#include "hid_record.h"
+
+static bool test_golden_script(
+    const char* script_dir,
+    const char* golden_dir,
+    const char* name,
+    bool update) {
+    char src_path[512];
+    char golden_path[512];
+    snprintf(src_path, sizeof(src_path), "%s/%s", script_dir, name);
+    snprintf(golden_path, sizeof(golden_path), "%s/%s", golden_dir, name);
+
+    FuriString* path = host_test_copy_script(src_path);
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    bool state = true;
+
+    for(size_t run = 0; run < 2; run++) {
+        BadUsbScript* bad_usb = host_test_open(path, session);
+        host_test_check(bad_usb_script_get_state(bad_usb)->state == BadUsbStateIdle);
+        BadUsbWorkerState end_state = host_test_run(bad_usb);
+        if(end_state != BadUsbStateDone) {
+            fprintf(
+                stderr,
+                "%s: run %zu ended in state %d: %s\n",
+                name,
+                run,
+                end_state,
+                bad_usb_script_get_state(bad_usb)->error);
+            state = false;
+        }
+        bad_usb_script_close(bad_usb);
+
+        state &= host_test_check_golden(golden_path, hid_record_get_log(), update && (run == 0));
+    }
+
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    return state;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 4) {
+        fprintf(stderr, "usage: %s <scripts> <golden> <script>... [--update]\n", argv[0]);
+        return 2;
+    }
+
+    bool update = (strcmp(argv[argc - 1], "--update") == 0);
+    int script_end = update ? (argc - 1) : argc;
+    bool state = true;
+    for(int i = 3; i < script_end; i++) {
+        bool script_state = test_golden_script(argv[1], argv[2], argv[i], update);
+        printf("%s: %s\n", argv[i], script_state ? "ok" : "FAILED");
+        state &= script_state;
+    }
+    return state ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Report sequences sent for STRING payloads: distinct keys sharing modifiers are packed into
+// one 6KRO report, a repeated key or a modifier change starts a new one. Long payloads are
+// typed in steps short enough to stop or pause them within REPORTS_LATENCY_MAX.
+// Usage: test_reports
+
+#include "host_test.h"
+#include "hid_record.h"
+#include "../bad_usb/helpers/ducky_script_i.h"
+
+#define REPORTS_LATENCY_MAX 20 // ms from a stop or pause to the worker acting on it
+
+#define END "kb 00 00 00 00 00 00 00\nconsumer 0000 0000\nmouse 00 0 0 0\n" // Script end
+
+typedef struct {
+    const char* name;
+    const char* script;
+    const char* reports;
+} ReportCase;
+
+static const ReportCase report_cases[] = {
+    {
+        "distinct keys share a report",
+        "STRING abc\n",
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 04 05 00 00 00 00\n"
+        "kb 00 04 05 06 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "repeated key starts a new report",
+        "STRING aab\n",
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n"
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 04 05 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "modifier change starts a new report",
+        "STRING aB\n",
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n"
+        "kb 02 05 00 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "STRINGLN newline joins the last report",
+        "STRINGLN hi\n",
+        "kb 00 0B 00 00 00 00 00\n"
+        "kb 00 0B 0C 00 00 00 00\n"
+        "kb 00 0B 0C 28 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "report holds six keys at most",
+        "STRING abcdefgh\n",
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 04 05 00 00 00 00\n"
+        "kb 00 04 05 06 00 00 00\n"
+        "kb 00 04 05 06 07 00 00\n"
+        "kb 00 04 05 06 07 08 00\n"
+        "kb 00 04 05 06 07 08 09\n"
+        "kb 00 00 00 00 00 00 00\n"
+        "kb 00 0A 00 00 00 00 00\n"
+        "kb 00 0A 0B 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "held keys keep their slots, one key per report",
+        "HOLD CTRL\nSTRING ab\nRELEASE CTRL\n",
+        "kb 01 00 00 00 00 00 00\n"
+        "kb 01 04 00 00 00 00 00\n"
+        "kb 01 00 00 00 00 00 00\n"
+        "kb 01 05 00 00 00 00 00\n"
+        "kb 01 00 00 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "STRINGDELAY types one key at a time",
+        "STRINGDELAY 5\nSTRING ab\n",
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n"
+        "kb 00 05 00 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+    {
+        "unmapped characters are skipped",
+        "STRING a\x01" "b\n",
+        "kb 00 04 00 00 00 00 00\n"
+        "kb 00 04 05 00 00 00 00\n"
+        "kb 00 00 00 00 00 00 00\n" END,
+    },
+};
+
+// Log without the timestamps
+static void test_reports_strip_time(const char* log, FuriString* reports) {
+    furi_string_reset(reports);
+    while(*log) {
+        while(*log == ' ') log++;
+        while((*log >= '0') && (*log <= '9')) log++;
+        log++;
+        const char* line_end = strchr(log, '\n');
+        size_t len = line_end ? (size_t)(line_end - log + 1) : strlen(log);
+        char line[128];
+        snprintf(line, sizeof(line), "%.*s", (int)len, log);
+        furi_string_cat_str(reports, line);
+        log += len;
+    }
+}
+
+static bool test_reports_run(const char* script, FuriString* reports) {
+    // Each script gets its own name, the bytecode cache can't tell apart same sized scripts
+    // written within the same second
+    static size_t script_nb = 0;
+    char name[32];
+    snprintf(name, sizeof(name), "reports_%zu.txt", script_nb++);
+    FuriString* path = host_test_write_script(name, script, strlen(script));
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+    BadUsbWorkerState state = host_test_run(bad_usb);
+    test_reports_strip_time(hid_record_get_log(), reports);
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    return state == BadUsbStateDone;
+}
+
+// Lowercase prose is mostly runs of distinct keys, it needs well under two reports per char
+static bool test_reports_throughput(void) {
+    const char* text = "the quick brown fox jumps over the lazy dog while sixty zebras quietly "
+                       "watch from behind a wooden fence ";
+    FuriString* script = furi_string_alloc_set_str("STRING ");
+    while(furi_string_size(script) < (DUCKY_LINE_LEN_MAX - strlen(text))) {
+        furi_string_cat_str(script, text);
+    }
+    size_t char_nb = furi_string_size(script) - strlen("STRING ");
+    furi_string_cat_str(script, "\n");
+
+    FuriString* reports = furi_string_alloc();
+    bool state = test_reports_run(furi_string_get_cstr(script), reports);
+    size_t report_nb = hid_record_get_report_nb();
+    uint32_t time_ms = furi_get_tick();
+    printf(
+        "%zu chars: %zu reports (%zu one key at a time), %.0f chars/s at 1 ms polling\n",
+        char_nb,
+        report_nb,
+        char_nb * 2,
+        char_nb * 1000.0 / time_ms);
+    state &= (report_nb < (char_nb * 3 / 2));
+
+    furi_string_free(reports);
+    furi_string_free(script);
+    return state;
+}
+
+// Time of the first line containing needle after the event fired at or after tick
+static uint32_t test_reports_find_after(
+    const char* log,
+    const char* event,
+    uint32_t tick,
+    const char* needle) {
+    bool event_found = false;
+    for(const char* line = log; *line; line = strchr(line, '\n') + 1) {
+        const char* line_end = strchr(line, '\n');
+        const char* found = strstr(line, event_found ? needle : event);
+        if(found && (found < line_end)) {
+            uint32_t line_tick = strtoul(line, NULL, 10);
+            if(event_found) return line_tick;
+            event_found = (line_tick >= tick);
+        }
+    }
+    return UINT32_MAX;
+}
+
+// 10 KB STRINGFILE stopped or paused at every ms of a 30 ms window, with a host polling every
+// 1 and every 4 ms: the keys are released, or the run paused, soon after the event whatever
+// the report being sent
+static bool test_reports_latency(void) {
+    const char* text = "the quick brown fox jumps over the lazy dog while sixty zebras quietly "
+                       "watch from behind a wooden fence ";
+    FuriString* string = furi_string_alloc();
+    while(furi_string_size(string) < 10 * 1024) {
+        furi_string_cat_str(string, text);
+    }
+    FuriString* string_path = host_test_write_script(
+        "latency_10k.txt", furi_string_get_cstr(string), furi_string_size(string));
+    const char* script = "STRINGFILE latency_10k.txt\n";
+    FuriString* path = host_test_write_script("latency.txt", script, strlen(script));
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+
+    static const uint32_t poll_intervals[] = {1, 4};
+    uint32_t stop_max = 0;
+    uint32_t pause_max = 0;
+    for(size_t p = 0; p < COUNT_OF(poll_intervals); p++) {
+        for(uint32_t tick = 500; tick < 530; tick++) {
+            hid_record_reset();
+            hid_record_set_poll_interval(poll_intervals[p]);
+            const HostTestEvent stop_events[] = {
+                {0, HostTestEventStartStop},
+                {tick, HostTestEventStartStop},
+            };
+            host_test_check(host_test_run_events(bad_usb, stop_events, 2) == BadUsbStateIdle);
+            uint32_t stop_tick = test_reports_find_after(
+                hid_record_get_log(), "event start/stop", tick, "kb 00 00 00 00 00 00 00");
+            stop_max = MAX(stop_max, stop_tick - tick);
+
+            hid_record_reset();
+            hid_record_set_poll_interval(poll_intervals[p]);
+            const HostTestEvent pause_events[] = {
+                {0, HostTestEventStartStop},
+                {tick, HostTestEventPauseResume},
+                {tick + 100, HostTestEventStartStop},
+            };
+            host_test_check(host_test_run_events(bad_usb, pause_events, 3) == BadUsbStateIdle);
+            uint32_t pause_tick = test_reports_find_after(
+                hid_record_get_log(), "event pause/resume", tick, "state Running -> Paused");
+            pause_max = MAX(pause_max, pause_tick - tick);
+        }
+    }
+    printf(
+        "%zu chars: stopped within %u ms, paused within %u ms\n",
+        furi_string_size(string),
+        stop_max,
+        pause_max);
+
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+    furi_string_free(path);
+    furi_string_free(string_path);
+    furi_string_free(string);
+    return (stop_max < REPORTS_LATENCY_MAX) && (pause_max < REPORTS_LATENCY_MAX);
+}
+
+int main(void) {
+    bool state = true;
+    FuriString* reports = furi_string_alloc();
+    for(size_t i = 0; i < COUNT_OF(report_cases); i++) {
+        const ReportCase* report_case = &report_cases[i];
+        bool case_state = test_reports_run(report_case->script, reports);
+        if(strcmp(furi_string_get_cstr(reports), report_case->reports) != 0) {
+            fprintf(
+                stderr,
+                "expected:\n%sgot:\n%s",
+                report_case->reports,
+                furi_string_get_cstr(reports));
+            case_state = false;
+        }
+        printf("%s: %s\n", report_case->name, case_state ? "ok" : "FAILED");
+        state &= case_state;
+    }
+    furi_string_free(reports);
+
+    bool throughput_state = test_reports_throughput();
+    printf("throughput: %s\n", throughput_state ? "ok" : "FAILED");
+    state &= throughput_state;
+
+    bool latency_state = test_reports_latency();
+    printf("stop and pause latency: %s\n", latency_state ? "ok" : "FAILED");
+    state &= latency_state;
+    return state ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Worker timing on the virtual clock with scripted events: every case is run twice and must
+// give the same timeline of reports, events and state changes both times, which is compared
+// against golden/timeline_<case>.txt.
+// Usage: test_timeline <golden folder> [--update]
+
+#include "host_test.h"
+#include "hid_record.h"
+
+#define TIMELINE_EVENT_MAX 4
+
+typedef struct {
+    const char* name;
+    const char* script;
+    uint32_t ready_delay; // ms, HID_RECORD_NEVER_READY when the host never polls
+    HostTestEvent events[TIMELINE_EVENT_MAX];
+    size_t event_nb;
+    BadUsbWorkerState state; // State at the end of the run
+} TimelineCase;
+
+static const TimelineCase timeline_cases[] = {
+    {
+        .name = "hour",
+        .script = "STRING a\nDELAY 3600000\nSTRING b\n",
+        .events = {{0, HostTestEventStartStop}},
+        .event_nb = 1,
+        .state = BadUsbStateDone,
+    },
+    {
+        // Started while unplugged, the host polls the keyboard 200 ms after connecting
+        .name = "will_run",
+        .script = "STRING a\n",
+        .ready_delay = 200,
+        .events =
+            {{0, HostTestEventDisconnect},
+             {0, HostTestEventStartStop},
+             {2000, HostTestEventConnect}},
+        .event_nb = 3,
+        .state = BadUsbStateDone,
+    },
+    {
+        // Host never polls, the script starts after the connect wait
+        .name = "will_run_no_poll",
+        .script = "STRING a\n",
+        .ready_delay = HID_RECORD_NEVER_READY,
+        .events =
+            {{0, HostTestEventDisconnect},
+             {0, HostTestEventStartStop},
+             {2000, HostTestEventConnect}},
+        .event_nb = 3,
+        .state = BadUsbStateDone,
+    },
+    {
+        // Stop is served while waiting for a host that never polls
+        .name = "will_run_no_poll_stop",
+        .script = "STRING a\n",
+        .ready_delay = HID_RECORD_NEVER_READY,
+        .events =
+            {{0, HostTestEventDisconnect},
+             {0, HostTestEventStartStop},
+             {2000, HostTestEventConnect},
+             {2700, HostTestEventStartStop}},
+        .event_nb = 4,
+        .state = BadUsbStateIdle,
+    },
+    {
+        // Time spent paused doesn't count toward the delay
+        .name = "pause_delay",
+        .script = "STRING a\nDELAY 5000\nSTRING b\n",
+        .events =
+            {{0, HostTestEventStartStop},
+             {1200, HostTestEventPauseResume},
+             {4000, HostTestEventPauseResume}},
+        .event_nb = 3,
+        .state = BadUsbStateDone,
+    },
+    {
+        .name = "pause_string_delay",
+        .script = "STRINGDELAY 100\nSTRING abcdef\n",
+        .events =
+            {{0, HostTestEventStartStop},
+             {250, HostTestEventPauseResume},
+             {1000, HostTestEventPauseResume}},
+        .event_nb = 3,
+        .state = BadUsbStateDone,
+    },
+    {
+        .name = "stop_string_delay",
+        .script = "STRINGDELAY 100\nSTRING abcdefghij\nSTRING z\n",
+        .events = {{0, HostTestEventStartStop}, {450, HostTestEventStartStop}},
+        .event_nb = 2,
+        .state = BadUsbStateIdle,
+    },
+    {
+        .name = "disconnect",
+        .script = "DELAY 1000\nSTRING a\n",
+        .events =
+            {{0, HostTestEventStartStop},
+             {500, HostTestEventDisconnect},
+             {800, HostTestEventConnect}},
+        .event_nb = 3,
+        .state = BadUsbStateIdle,
+    },
+    {
+        .name = "wait_for_button",
+        .script = "STRING a\nWAIT_FOR_BUTTON_PRESS\nSTRING b\n",
+        .events = {{0, HostTestEventStartStop}, {3000, HostTestEventStartStop}},
+        .event_nb = 2,
+        .state = BadUsbStateDone,
+    },
+};
+
+static bool timeline_run(const TimelineCase* timeline_case, FuriString* path, FuriString* log) {
+    BadUsbHidSession* session = bad_usb_hid_session_alloc();
+    BadUsbScript* bad_usb = host_test_open(path, session);
+    hid_record_reset();
+    hid_record_set_ready_delay(timeline_case->ready_delay);
+
+    BadUsbWorkerState state =
+        host_test_run_events(bad_usb, timeline_case->events, timeline_case->event_nb);
+    furi_string_set_str(log, hid_record_get_log());
+    bad_usb_script_close(bad_usb);
+    bad_usb_hid_session_free(session);
+
+    if(state != timeline_case->state) {
+        fprintf(stderr, "%s: ended in state %d\n", timeline_case->name, state);
+        return false;
+    }
+    return true;
+}
+
+static bool timeline_check(const TimelineCase* timeline_case, const char* golden_dir, bool update) {
+    char name[64];
+    snprintf(name, sizeof(name), "timeline_%s.txt", timeline_case->name);
+    FuriString* path =
+        host_test_write_script(name, timeline_case->script, strlen(timeline_case->script));
+    FuriString* log = furi_string_alloc();
+    FuriString* log_again = furi_string_alloc();
+
+    uint64_t start = host_bench_get_ns();
+    bool state = timeline_run(timeline_case, path, log);
+    double run_ms = (host_bench_get_ns() - start) / 1e6;
+    // Second run loads the bytecode cache, the timeline must not change
+    state &= timeline_run(timeline_case, path, log_again);
+    if(strcmp(furi_string_get_cstr(log), furi_string_get_cstr(log_again)) != 0) {
+        fprintf(stderr, "%s: timeline differs between runs\n", timeline_case->name);
+        state = false;
+    }
+
+    char golden_path[512];
+    snprintf(golden_path, sizeof(golden_path), "%s/%s", golden_dir, name);
+    state &= host_test_check_golden(golden_path, furi_string_get_cstr(log), update);
+    printf(
+        "%s: %s, %u ms of virtual time in %.1f ms\n",
+        timeline_case->name,
+        state ? "ok" : "FAILED",
+        furi_get_tick(),
+        run_ms);
+
+    furi_string_free(log_again);
+    furi_string_free(log);
+    furi_string_free(path);
+    return state;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s <golden> [--update]\n", argv[0]);
+        return 2;
+    }
+
+    bool update = (argc > 2) && (strcmp(argv[2], "--update") == 0);
+    bool state = true;
+    for(size_t i = 0; i < COUNT_OF(timeline_cases); i++) {
+        state &= timeline_check(&timeline_cases[i], argv[1], update);
+    }
+    return state ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <furi.h>
+#include <lib/toolbox/strint.h>
+#include <toolbox/path.h>
+
+// Same rules as the firmware parser: leading blanks and a sign are accepted, parsing stops at
+// the first character that isn't a digit
+static StrintParseError
+    strint_parse(const char* str, char** end, uint64_t* out, bool* negative, uint64_t max) {
+    while((*str == ' ') || ((*str >= '\t') && (*str <= '\r'))) {
+        str++;
+    }
+    *negative = false;
+    if((*str == '+') || (*str == '-')) {
+        *negative = (*str == '-');
+        str++;
+    }
+    if((*str == '+') || (*str == '-')) return StrintParseSignError;
+
+    uint64_t value = 0;
+    size_t digit_nb = 0;
+    for(; (*str >= '0') && (*str <= '9'); str++, digit_nb++) {
+        value = value * 10 + (*str - '0');
+        if(value > max) return StrintParseOverflowError;
+    }
+    if(end) *end = (char*)str;
+    if(digit_nb == 0) return StrintParseAbsentError;
+    *out = value;
+    return StrintParseNoError;
+}
+
+StrintParseError strint_to_uint32(const char* str, char** end, uint32_t* out, uint8_t base) {
+    furi_check(base == 10);
+    uint64_t value = 0;
+    bool negative = false;
+    StrintParseError error = strint_parse(str, end, &value, &negative, UINT32_MAX);
+    if(error != StrintParseNoError) return error;
+    if(negative) return StrintParseSignError;
+    if(out) *out = (uint32_t)value;
+    return StrintParseNoError;
+}
+
+StrintParseError strint_to_int32(const char* str, char** end, int32_t* out, uint8_t base) {
+    furi_check(base == 10);
+    uint64_t value = 0;
+    bool negative = false;
+    StrintParseError error = strint_parse(str, end, &value, &negative, (uint64_t)INT32_MAX + 1);
+    if(error != StrintParseNoError) return error;
+    if(!negative && (value > INT32_MAX)) return StrintParseOverflowError;
+    if(out) *out = negative ? (int32_t)(-(int64_t)value) : (int32_t)value;
+    return StrintParseNoError;
+}
+
+void path_extract_filename(FuriString* path, FuriString* filename, bool trim_ext) {
+    const char* path_cstr = furi_string_get_cstr(path);
+    const char* name = strrchr(path_cstr, '/');
+    name = name ? (name + 1) : path_cstr;
+    size_t len = strlen(name);
+    if(trim_ext) {
+        const char* ext = strrchr(name, '.');
+        if(ext && (ext != name)) len = ext - name;
+    }
+    furi_string_set_strn(filename, name, len);
+}
+
+void path_extract_dirname(const char* path, FuriString* dirname) {
+    const char* sep = strrchr(path, '/');
+    if(sep) {
+        furi_string_set_strn(dirname, path, sep - path);
+    } else {
+        furi_string_set_str(dirname, path);
+    }
+}
@@ -8,102 +8,53 @@
 #include "bsp/board.h"
 #include "tusb.h"
 
-#include "badusb2_protocol.h"
-
-// --- Configuration ---
-#define SPI_PORT spi0
-#define PIN_MISO 16
-#define PIN_CS   17
-#define PIN_SCK  18
-#define PIN_MOSI 19
-
-// Handshake Pin: High = Request Attention from Flipper
-#define PIN_HANDSHAKE 20
-
-// We need a buffer to hold the packet
-static SpiPacket spi_packet;
+#include "badusb2_spi_slave.h"
+
+// CMD_HID_STRING being typed, kept apart from spi_frame which MSC reuses meanwhile
+static BadUsb2HidKey hid_string[BADUSB2_STRING_KEY_MAX];
+static uint16_t hid_string_len = 0;
+static uint16_t hid_string_pos = 0;
+static bool hid_string_released = true;
+static uint8_t hid_string_seq = 0;
 static bool pending_usb_read = false;
 static bool pending_usb_write = false;
 
 // TinyUSB Descriptors (Minimal placeholders for logic demonstration)
 // In a real project, usb_descriptors.c would define the Composite HID + MSC device
 
-// --- SPI Helpers ---
-
-void spi_slave_init() {
-    spi_init(SPI_PORT, 1000 * 1000); // 1 MHz
-    spi_set_slave(SPI_PORT, true);
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_CS,   GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SCK,  GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
-    
-    // Handshake
-    gpio_init(PIN_HANDSHAKE);
-    gpio_set_dir(PIN_HANDSHAKE, GPIO_OUT);
-    gpio_put(PIN_HANDSHAKE, 0);
-}
-
-void notify_flipper() {
-    gpio_put(PIN_HANDSHAKE, 1);
-    sleep_us(10); // Pulse
-    gpio_put(PIN_HANDSHAKE, 0);
-}
-
-void spi_transfer_packet(SpiPacket* tx, SpiPacket* rx) {
-    // Blocking transfer of the whole structure size
-    spi_write_read_blocking(SPI_PORT, (uint8_t*)tx, (uint8_t*)rx, sizeof(SpiPacket));
-}
-
 // --- MSC Handlers (TinyUSB Callbacks) ---
 
 // Invoked when received SCSI_CMD_READ_10
+// bufsize is up to CFG_TUD_MSC_EP_BUFSIZE, all of its sectors are asked for in one frame
 int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
     (void)lun; (void)offset;
 
-    // Prepare Request
-    spi_packet.magic = BADUSB2_PROTOCOL_MAGIC;
-    spi_packet.type = CMD_MSC_READ;
-    spi_packet.address = lba;
-    
-    // 1. Wake Flipper
-    notify_flipper();
-    
-    // 2. Transmit Request & Receive Data
-    // Note: In real SPI Slave mode, we might need to wait for the Master (Flipper) to start clocking.
-    // Ideally, the Master sees the Handshake, asserts CS, and clocks out the data.
-    // For simplicity here, we assume one large transfer transaction initiated by Master after Handshake.
-    
-    SpiPacket rx_packet;
-    spi_transfer_packet(&spi_packet, &rx_packet);
-    
-    // 3. Copy received data to USB buffer
-    if (rx_packet.magic == BADUSB2_PROTOCOL_MAGIC) {
-        memcpy(buffer, rx_packet.data, bufsize);
-        return bufsize;
+    uint16_t sector_nb = bufsize / BADUSB2_SECTOR_SIZE;
+    if (sector_nb == 0 || sector_nb > BADUSB2_SECTOR_MAX) {
+        return -1;
+    }
+
+    // The Master sees the Handshake, clocks the request out, then clocks the response in
+    if (!spi_msc_read(lba, sector_nb, buffer)) {
+        return -1; // Error
     }
-    
-    return -1; // Error
+    return sector_nb * BADUSB2_SECTOR_SIZE;
 }
 
 // Invoked when received SCSI_CMD_WRITE_10
 int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
     (void)lun; (void)offset;
 
-    // Prepare Write Packet
-    spi_packet.magic = BADUSB2_PROTOCOL_MAGIC;
-    spi_packet.type = CMD_MSC_WRITE;
-    spi_packet.address = lba;
-    memcpy(spi_packet.data, buffer, bufsize);
-
-    // 1. Wake Flipper
-    notify_flipper();
+    uint16_t sector_nb = bufsize / BADUSB2_SECTOR_SIZE;
+    if (sector_nb == 0 || sector_nb > BADUSB2_SECTOR_MAX) {
+        return -1;
+    }
 
-    // 2. Send Data to Flipper
-    SpiPacket rx_packet;
-    spi_transfer_packet(&spi_packet, &rx_packet);
-    
-    return bufsize;
+    // The host only hears of success once the Flipper has checked the CRC and stored the sectors
+    if (!spi_msc_write(lba, sector_nb, buffer)) {
+        return -1; // Error
+    }
+    return sector_nb * BADUSB2_SECTOR_SIZE;
 }
 
 // --- HID Logic ---
@@ -123,6 +74,71 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t*
 // Problem: If Flipper wants to send a HID press, it just asserts CS and sends it.
 // RP2040 must be ready to receive.
 
+// Queues a CMD_HID_STRING, typing happens in hid_string_task()
+void hid_string_start(BadUsb2Frame* frame) {
+    if (hid_string_len > 0 && frame->header.seq == hid_string_seq) {
+        // Sent again after an ack timeout: ack what was typed, a chunk still typing acks on its own
+        if (hid_string_pos == hid_string_len) {
+            spi_send_response(CMD_HID_STRING, hid_string_seq, NULL, 0);
+        }
+        return;
+    }
+    hid_string_len = frame->header.length / sizeof(BadUsb2HidKey);
+    memcpy(hid_string, frame->payload, hid_string_len * sizeof(BadUsb2HidKey));
+    hid_string_pos = 0;
+    hid_string_released = true;
+    hid_string_seq = frame->header.seq;
+}
+
+// One report per USB poll: press, then release, then the next key
+void hid_string_task() {
+    if (hid_string_pos >= hid_string_len || !tud_hid_ready()) {
+        return;
+    }
+
+    if (hid_string_released) {
+        uint8_t keycode[6] = {0};
+        keycode[0] = hid_string[hid_string_pos].keycode;
+        tud_hid_keyboard_report(0, hid_string[hid_string_pos].modifier, keycode);
+        hid_string_released = false;
+    } else {
+        tud_hid_keyboard_report(0, 0, NULL);
+        hid_string_released = true;
+        hid_string_pos++;
+        if (hid_string_pos == hid_string_len) {
+            // Let the Flipper go on with the script
+            spi_send_response(CMD_HID_STRING, hid_string_seq, NULL, 0);
+        }
+    }
+}
+
+// Serves the Flipper's HID requests, the link layer handles the rest
+void hid_dispatch_frame(BadUsb2Frame* frame) {
+    if (frame->header.type == CMD_HID_PRESS &&
+        frame->header.length >= sizeof(BadUsb2HidKey)) {
+        // Send HID Report
+        BadUsb2HidKey key;
+        memcpy(&key, frame->payload, sizeof(key));
+        uint8_t keycode[6] = {0};
+        keycode[0] = key.keycode;
+        tud_hid_keyboard_report(0, key.modifier, keycode);
+    }
+    else if (frame->header.type == CMD_HID_RELEASE) {
+        tud_hid_keyboard_report(0, 0, NULL);
+    }
+    else if (frame->header.type == CMD_HID_STRING) {
+        hid_string_start(frame);
+    }
+    else if (frame->header.type == CMD_HID_CANCEL) {
+        // Script stopped on the Flipper: drop the rest of the STRING and let go of every key
+        hid_string_len = 0;
+        hid_string_pos = 0;
+        hid_string_released = true;
+        tud_hid_keyboard_report(0, 0, NULL);
+        spi_send_response(CMD_HID_CANCEL, frame->header.seq, NULL, 0);
+    }
+}
+
 // --- Main ---
 
 int main() {
@@ -132,45 +148,24 @@ int main() {
 
     while (1) {
         tud_task(); // USB Device Task
-
-        // Check if SPI is active (CS Low)
-        // In a robust implementation, we'd use interrupts (irq_set_enabled IO_IRQ_BANK0).
-        // For this proof of concept, we assume the hardware buffer or blocking call handles it if we are fast enough,
-        // or we use `spi_is_readable` to check for incoming data.
-        
-        if (spi_is_readable(SPI_PORT)) {
-            SpiPacket rx_packet;
-            // Read header first or full packet? 
-            // We define fixed size packets for simplicity.
-            spi_read_blocking(SPI_PORT, 0, (uint8_t*)&rx_packet, sizeof(SpiPacket));
-
-            if (rx_packet.magic == BADUSB2_PROTOCOL_MAGIC) {
-                if (rx_packet.type == CMD_HID_PRESS) {
-                    // Send HID Report
-                     uint8_t keycode[6] = {0};
-                     keycode[0] = (uint8_t)rx_packet.address; // Using address field for keycode
-                     tud_hid_keyboard_report(0, 0, keycode);
-                }
-                else if (rx_packet.type == CMD_HID_RELEASE) {
-                    tud_hid_keyboard_report(0, 0, NULL);
-                }
-                // MSC commands are usually initiated by Host (PC), so they trigger the callbacks above.
-                // However, the callbacks need to talk to Flipper.
-                // This creates a bi-directional complexity:
-                // 1. PC asks RP2040 (Master) -> RP2040 asks Flipper (Slave? No Flipper is Master).
-                //
-                // ARCHITECTURE CORRECTION:
-                // RP2040 cannot easily "Ask" Flipper if Flipper is SPI Master.
-                // RP2040 can only signal "Attention" via GPIO.
-                // Flipper sees GPIO IRQ -> Initiates SPI Transfer.
-                //
-                // So inside `tud_msc_read10_cb`:
-                // 1. Set global state "WAITING_FOR_FLIPPER_DATA".
-                // 2. Assert Signal Pin.
-                // 3. Busy wait (or yield) until SPI transfer completes (filled by Flipper).
-                // 4. Return data.
-            }
-        }
+        hid_string_task();
+
+        // MSC commands are usually initiated by Host (PC), so they trigger the callbacks above.
+        // However, the callbacks need to talk to Flipper.
+        // This creates a bi-directional complexity:
+        // 1. PC asks RP2040 (Master) -> RP2040 asks Flipper (Slave? No Flipper is Master).
+        //
+        // ARCHITECTURE CORRECTION:
+        // RP2040 cannot easily "Ask" Flipper if Flipper is SPI Master.
+        // RP2040 can only signal "Attention" via GPIO.
+        // Flipper sees GPIO IRQ -> Initiates SPI Transfer.
+        //
+        // So inside `tud_msc_read10_cb`:
+        // 1. Set global state "WAITING_FOR_FLIPPER_DATA".
+        // 2. Assert Signal Pin.
+        // 3. Busy wait (or yield) until SPI transfer completes (filled by Flipper).
+        // 4. Return data.
+        spi_slave_task();
     }
 
     return 0;
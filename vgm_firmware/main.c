@@ -5,13 +5,13 @@
 #include "hardware/spi.h"
 #include "hardware/gpio.h"
 #include "tusb.h"
+#include "badusb2_spi_slave.h"
 
-#define SPI_PORT spi0
-#define PIN_MISO 16
-#define PIN_CS   17
-#define PIN_SCK  18
-#define PIN_MOSI 19
-#define PIN_HANDSHAKE 20 
+// CMD_HID_STRING being typed, one report per USB poll
+static BadUsb2HidKey hid_string[BADUSB2_STRING_KEY_MAX];
+static uint16_t hid_string_len = 0, hid_string_pos = 0;
+static bool hid_string_released = true;
+static uint8_t hid_string_seq = 0;
 
 tusb_desc_device_t const desc_device = {
     .bLength = sizeof(tusb_desc_device_t), .bDescriptorType = TUSB_DESC_DEVICE,
@@ -27,7 +27,7 @@ uint8_t const desc_configuration[] = {
     0x09, TUSB_DESC_CONFIGURATION, 0x4A, 0x00, ITF_NUM_TOTAL, 0x01, 0x00, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 0x32,
     0x09, TUSB_DESC_INTERFACE, ITF_NUM_HID, 0x00, 0x01, TUSB_CLASS_HID, 0x01, 0x01, 0x00,
     0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, sizeof(desc_hid_report), 0x00,
-    0x07, TUSB_DESC_ENDPOINT, 0x81, TUSB_XFER_INTERRUPT, 16, 0x0A,
+    0x07, TUSB_DESC_ENDPOINT, 0x81, TUSB_XFER_INTERRUPT, 16, 0x01,
     0x09, TUSB_DESC_INTERFACE, ITF_NUM_MSC, 0x00, 0x02, TUSB_CLASS_MSC, 0x06, 0x50, 0x00,
     0x07, TUSB_DESC_ENDPOINT, 0x02, TUSB_XFER_BULK, 64, 0x00,
     0x07, TUSB_DESC_ENDPOINT, 0x82, TUSB_XFER_BULK, 64, 0x00
@@ -37,24 +37,19 @@ uint8_t const * tud_descriptor_configuration_cb(uint8_t index) { return desc_con
 uint16_t const* tud_descriptor_string_cb(uint8_t index, uint16_t langid) { return NULL; }
 uint8_t const * tud_hid_descriptor_report_cb(uint8_t itf) { return desc_hid_report; }
 
-void spi_init_slave() {
-    spi_init(SPI_PORT, 4000000); 
-    spi_set_slave(SPI_PORT, true);
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_CS,   GPIO_FUNC_SPI);
-    gpio_set_function(PIN_SCK,  GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
-    gpio_init(PIN_HANDSHAKE); gpio_set_dir(PIN_HANDSHAKE, GPIO_OUT); gpio_put(PIN_HANDSHAKE, 0);
-}
-
 void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, uint8_t report_type, uint8_t const* buffer, uint16_t bufsize) { }
 uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, uint8_t report_type, uint8_t* buffer, uint16_t reqlen) { return 0; }
 int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, uint16_t bufsize) { return -1; }
 int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
-    gpio_put(PIN_HANDSHAKE, 1); spi_read_blocking(SPI_PORT, 0, buffer, bufsize); gpio_put(PIN_HANDSHAKE, 0); return bufsize;
+    uint16_t sector_nb = bufsize / BADUSB2_SECTOR_SIZE;
+    if (sector_nb == 0 || sector_nb > BADUSB2_SECTOR_MAX) return -1;
+    return spi_msc_read(lba, sector_nb, buffer) ? sector_nb * BADUSB2_SECTOR_SIZE : -1;
 }
 int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
-    gpio_put(PIN_HANDSHAKE, 1); spi_write_blocking(SPI_PORT, buffer, bufsize); gpio_put(PIN_HANDSHAKE, 0); return bufsize;
+    uint16_t sector_nb = bufsize / BADUSB2_SECTOR_SIZE;
+    if (sector_nb == 0 || sector_nb > BADUSB2_SECTOR_MAX) return -1;
+    // Success only once the Flipper has checked the CRC and stored the sectors
+    return spi_msc_write(lba, sector_nb, buffer) ? sector_nb * BADUSB2_SECTOR_SIZE : -1;
 }
 void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]) {
     memcpy(vendor_id, "Flipper", 7); memcpy(product_id, "BadUSB2", 7); memcpy(product_rev, "1.0", 3);
@@ -62,8 +57,46 @@ void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16
 bool tud_msc_test_unit_ready_cb(uint8_t lun) { return true; }
 void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size) { *block_count = 1024*1024*1024; *block_size = 512; }
 
+void hid_string_start(BadUsb2Frame* frame) { // Typing happens in hid_string_task()
+    if (hid_string_len > 0 && frame->header.seq == hid_string_seq) { // Sent again after an ack timeout
+        if (hid_string_pos == hid_string_len) spi_send_response(CMD_HID_STRING, hid_string_seq, NULL, 0);
+        return; // A chunk still typing acks on its own
+    }
+    hid_string_len = frame->header.length / sizeof(BadUsb2HidKey);
+    memcpy(hid_string, frame->payload, hid_string_len * sizeof(BadUsb2HidKey));
+    hid_string_pos = 0; hid_string_released = true; hid_string_seq = frame->header.seq;
+}
+void hid_string_task() {
+    if (hid_string_pos >= hid_string_len || !tud_hid_ready()) return;
+    if (hid_string_released) {
+        uint8_t keycode[6] = {hid_string[hid_string_pos].keycode};
+        tud_hid_keyboard_report(0, hid_string[hid_string_pos].modifier, keycode); hid_string_released = false;
+    } else {
+        tud_hid_keyboard_report(0, 0, NULL); hid_string_released = true;
+        if (++hid_string_pos == hid_string_len) { // Ack lets the Flipper go on with the script
+            spi_send_response(CMD_HID_STRING, hid_string_seq, NULL, 0);
+        }
+    }
+}
+
+void hid_dispatch_frame(BadUsb2Frame* frame) { // Flipper's HID requests, the link layer handles the rest
+    if (frame->header.type == CMD_HID_PRESS && frame->header.length >= sizeof(BadUsb2HidKey)) {
+        BadUsb2HidKey key; memcpy(&key, frame->payload, sizeof(key));
+        uint8_t keycode[6] = {key.keycode}; tud_hid_keyboard_report(0, key.modifier, keycode);
+    } else if (frame->header.type == CMD_HID_RELEASE) tud_hid_keyboard_report(0, 0, NULL);
+    else if (frame->header.type == CMD_HID_STRING) hid_string_start(frame);
+    else if (frame->header.type == CMD_HID_CANCEL) { // Script stopped: drop the STRING, let go of every key
+        hid_string_len = hid_string_pos = 0; hid_string_released = true; tud_hid_keyboard_report(0, 0, NULL);
+        spi_send_response(CMD_HID_CANCEL, frame->header.seq, NULL, 0);
+    }
+}
+
 int main() {
-    stdio_init_all(); spi_init_slave(); tusb_init();
-    while (1) { tud_task(); }
+    stdio_init_all(); spi_slave_init(); tusb_init();
+    while (1) {
+        tud_task();
+        hid_string_task();
+        spi_slave_task();
+    }
     return 0;
 }
@@ -4,6 +4,6 @@
 #define CFG_TUD_ENABLED         1
 #define CFG_TUD_MSC             1
 #define CFG_TUD_HID             1
-#define CFG_TUD_MSC_EP_BUFSIZE  512
+#define CFG_TUD_MSC_EP_BUFSIZE  4096 // BADUSB2_SECTOR_MAX sectors per SPI frame
 #define CFG_TUD_HID_EP_BUFSIZE  16
 #endif